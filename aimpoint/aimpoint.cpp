@@ -1,11 +1,15 @@
 #include "aimpoint.h"
 
 #include "log.h"
+#include "startup_profile.h"
+#include "conjunction.h"
 
 #include <thread>
 #include <chrono>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "imgui.h"
 #include "implot.h"
@@ -13,6 +17,9 @@
 // TMP for KEY_CODES!
 #include <GLFW/glfw3.h>
 
+static const float camera_fov = 75.0f; // deg, vertical
+static const float path_pixel_error = 0.5f; // how far orbit paths may stray from the conic on screen
+
 static char* pretty_time(double time, double* value) {
     double abs_time = laml::abs(time);
     double sign = laml::sign(time);
@@ -37,32 +44,77 @@ static char* pretty_time(double time, double* value) {
 }
 
 int aimpoint::init() {
+    // scenario start, J2000
+    sim_epoch = epoch::from_calendar(2000, 1, 1, 12, 0, 0.0, TIME_SCALE_TT);
+
     // Load mesh from file
     //mesh.load_from_mesh_file("data/t_bar.mesh");
-    mesh.load_from_mesh_file("data/blahaj.mesh", 0.01f);
-    dot.load_from_mesh_file("data/unit_sphere.mesh", 100000.0f);
-    grid_tex.load_texture_file("data/grid.png");
+    renderer.assets.load_mesh(&mesh, "data/blahaj.bmesh", 0.01f);
+    renderer.assets.load_mesh(&dot, "data/unit_sphere.bmesh", 100000.0f);
+    renderer.assets.load_texture(&grid_tex, "data/grid.png");
 
-    red_tex.load_texture_file("data/red.png");
-    green_tex.load_texture_file("data/green.png");
-    blue_tex.load_texture_file("data/blue.png");
+    renderer.assets.load_texture(&red_tex, "data/red.png");
+    renderer.assets.load_texture(&green_tex, "data/green.png");
+    renderer.assets.load_texture(&blue_tex, "data/blue.png");
 
-    earth.load_mesh();
+    earth.load_mesh(&renderer.assets);
+
+    // precession/nutation for the sim epoch, with polar motion and UT1 if available
+    startup_timer orientation_timer("earth orientation");
+    if (!eop.load_finals("data/finals2000A.all")) {
+        spdlog::info("No EOP file found, ignoring polar motion and UT1-UTC");
+    }
+    lunisolar.set_epoch(sim_epoch);
+    orientation.init(sim_epoch, 366.0, &eop);
+    orientation_timer.stop();
+    earth.orientation = &orientation;
+    earth.update(0.0, 0.0);
 
     //satellite.set_orbit_circ(&earth, 28.627023, -80.620856, 480000, 40);
     satellite.set_orbit_circ(&earth, 69.099597, 49.092329, 250000, 75);
-    constant_orbit.create_from_state_vectors(satellite.state.position, satellite.state.velocity, 0.0);
+    satellite.third_bodies = use_lunisolar ? &lunisolar : nullptr;
+
+    // use the JPL ephemeris for Sun/Moon if it's available locally
+    if (de_file.open("data/linux_p1550p2650.440")) {
+        lunisolar.de_file = &de_file;
+    } else {
+        spdlog::info("No DE440 file found, using analytic Sun/Moon positions");
+    }
+
+    // object catalog, as TLEs or OMM CSV
+    {
+        startup_timer timer("element catalog");
+        if (!catalog.load_tle("data/catalog.tle") && !catalog.load_omm_csv("data/catalog.csv")) {
+            spdlog::info("No element catalog found");
+        }
+    }
+
+    atmo.init(&earth, ATMOSPHERE_HARRIS_PRIESTER, &lunisolar);
+    satellite.drag_model = use_drag ? &atmo : nullptr;
+    srp.init(&earth, &lunisolar);
+    satellite.srp_model = use_srp ? &srp : nullptr;
+    eclipses.resize(1);
+    constant_orbit.create_from_state_vectors(satellite.state.position, satellite.state.velocity, sim_epoch);
     //constant_orbit.create_from_kep_elements(0.0, 7000000, 30, 0, 0, 0, 0);
     constant_orbit.calc_path_mesh();
-    J2_perturbations.create_from_state_vectors(satellite.state.position, satellite.state.velocity, 0.0);
+    J2_perturbations.create_from_state_vectors(satellite.state.position, satellite.state.velocity, sim_epoch);
     J2_perturbations.calc_path_mesh();
+    J2_mean_valid = J2_mean.create_from_state_vectors(satellite.state.position, satellite.state.velocity, sim_epoch);
+    if (!J2_mean_valid) {
+        spdlog::warn("Could not create Brouwer mean elements, hiding the mean orbit");
+    }
+
+    ground_tracks.init(3, ground_track_length);
+    ground_tracks.set_color(0, vec3f(1.0f, 0.0f, 0.0f), 0.8f);
+    ground_tracks.set_color(1, vec3f(1.0f, 1.0f, 0.0f), 0.8f);
+    ground_tracks.set_color(2, vec3f(0.3f, 0.5f, 1.0f), J2_mean_valid ? 0.8f : 0.0f);
 
     //hmm.launch(&earth);
     //lci2eci = hmm.LCI2ECI;
     //eci2lci = laml::transpose(lci2eci);
 
     mat4f projection_matrix;
-    laml::transform::create_projection_perspective(projection_matrix, 75.0f, renderer.get_AR(), 1000.0f, 50'000'000.0f);
+    laml::transform::create_projection_perspective(projection_matrix, camera_fov, renderer.get_AR(), 1000.0f, 50'000'000.0f);
     renderer.set_projection(projection_matrix);
     cam_orbit_distance = 2.0f*earth.equatorial_radius;
 
@@ -87,7 +139,42 @@ void aimpoint::step(double dt) {
 
     earth.update(sim_time, dt);
     satellite.integrate_states(sim_time, dt);
-    constant_orbit.advance(dt);
+
+    // eclipse entry/exit of the integrated satellite
+    satellite_shadow = srp.shadow(satellite.state.position, sim_time + dt);
+    if (eclipses.update(0, sim_time + dt, satellite_shadow)) {
+        for (const eclipse_event& e : eclipses.events) {
+            bool entering = e.to > e.from;
+            eclipse_state region = entering ? e.to : e.from;
+            spdlog::info("[{0:.1f}] satellite {1} {2}", e.t, entering ? "entered" : "left",
+                         region == ECLIPSE_UMBRA ? "umbra" : "penumbra");
+        }
+        eclipses.events.clear();
+    }
+    constant_orbit.propagate_to(sim_clock + dt);
+
+    if (sim_time + dt >= next_ground_track_time) {
+        vec3d pos[3], vel;
+        pos[0] = satellite.state.position;
+        if (!constant_orbit.state_at(sim_clock + dt, &pos[1], &vel))
+            pos[1] = pos[0]; // don't plot a point that didn't converge
+        if (J2_mean_valid)
+            J2_mean.state_at(sim_clock + dt, &pos[2], nullptr);
+        else
+            pos[2] = pos[0]; // hidden track, keep it in step with the others
+
+        float lat[3], lon[3];
+        for (int n = 0; n < 3; n++) {
+            double lat_deg, lon_deg, alt;
+            earth.fixed_to_lla(earth.inertial_to_fixed(pos[n], sim_time + dt), &lat_deg, &lon_deg, &alt);
+            lat[n] = (float)lat_deg;
+            lon[n] = (float)lon_deg;
+        }
+        ground_tracks.append(lat, lon);
+        next_ground_track_time += ground_track_interval;
+        if (next_ground_track_time < sim_time + dt) // steps longer than the interval
+            next_ground_track_time = sim_time + dt + ground_track_interval;
+    }
 
     if (sim_frame % frames_per_min == 0) {
         t.add_point(sim_time);
@@ -99,16 +186,26 @@ void aimpoint::step(double dt) {
 
 void aimpoint::render2D() {
     //renderer.start_2D_render(earth.diffuse);
+    renderer.draw_ground_tracks(ground_tracks);
+
     vec3d pos_ecef = earth.inertial_to_fixed(satellite.state.position);
     double lat, lon, alt;
     earth.fixed_to_lla(pos_ecef, &lat, &lon, &alt);
     renderer.draw_dot(lat, lon, vec3f(1.0f, 0.0f, 0.0f), 1.0f);
 
     vec3d pos_kep, vel_kep;
-    constant_orbit.get_state_vectors(&pos_kep, &vel_kep);
-    pos_ecef = earth.inertial_to_fixed(pos_kep);
-    earth.fixed_to_lla(pos_ecef, &lat, &lon, &alt);
-    renderer.draw_dot(lat, lon, vec3f(1.0f, 1.0f, 0.0f), 1.0f);
+    if (constant_orbit.state_at(sim_clock, &pos_kep, &vel_kep)) {
+        pos_ecef = earth.inertial_to_fixed(pos_kep);
+        earth.fixed_to_lla(pos_ecef, &lat, &lon, &alt);
+        renderer.draw_dot(lat, lon, vec3f(1.0f, 1.0f, 0.0f), 1.0f);
+    }
+
+    if (J2_mean_valid) {
+        vec3d pos_mean;
+        J2_mean.state_at(sim_clock, &pos_mean, nullptr);
+        earth.fixed_to_lla(earth.inertial_to_fixed(pos_mean), &lat, &lon, &alt);
+        renderer.draw_dot(lat, lon, vec3f(0.3f, 0.5f, 1.0f), 1.0f);
+    }
 
     //renderer.end_2D_render();
 }
@@ -161,6 +258,12 @@ void aimpoint::render3D() {
                             laml::cosd(pitch)*laml::cosd(yaw));
 
     renderer.setup_frame(cam_pos, yaw, pitch, render_coord_frame);
+    renderer.begin_draw_list();
+
+    // size of a pixel at the camera's distance from Earth, which orbit paths
+    // are roughly at too, sets their level of detail
+    double pixel_size = laml::length(cam_pos) * 2.0*laml::tand(0.5*camera_fov) / renderer.get_height();
+    double path_error = path_pixel_error*pixel_size;
     
     renderer.bind_texture(earth.diffuse);
     renderer.draw_mesh(earth.mesh, laml::Vec3(0.0f), laml::transform::quat_from_mat(earth.mat_fixed_to_inertial));
@@ -174,6 +277,11 @@ void aimpoint::render3D() {
     renderer.draw_vector(laml::transform::transform_point(earth.mat_fixed_to_inertial, vec3f(1.0f, 0.0f, 0.0f)), 8000000, vec3f(1.0f, 0.3f, 0.3f));
     renderer.draw_vector(laml::transform::transform_point(earth.mat_fixed_to_inertial, vec3f(0.0f, 1.0f, 0.0f)), 8000000, vec3f(0.3f, 1.0f, 0.3f));
     //renderer.draw_vector(laml::transform::transform_point(earth.mat_fixed_to_inertial, vec3f(0.0f, 0.0f, 1.0f)), 8000000, vec3f(0.3f, 0.3f, 1.0f));
+
+    // sun/moon directions
+    const ephemeris_state& bodies = lunisolar.at(sim_time);
+    renderer.draw_vector(vec3f(laml::normalize(bodies.sun_position)),  12000000, vec3f(1.0f, 0.85f, 0.3f));
+    renderer.draw_vector(vec3f(laml::normalize(bodies.moon_position)),  9000000, vec3f(0.7f, 0.7f, 0.7f));
     
     // dot at launch site
     renderer.bind_texture(red_tex);
@@ -184,15 +292,55 @@ void aimpoint::render3D() {
     renderer.bind_texture(grid_tex);
     renderer.draw_mesh(dot, satellite.state.position, satellite.state.orientation);
     J2_perturbations.create_from_state_vectors(satellite.state.position, satellite.state.velocity, sim_time);
-    J2_perturbations.calc_path_mesh();
-    renderer.draw_path(J2_perturbations.path_handle, 100, vec3f(.3333f, 0.4588f, .5418f));
+    J2_perturbations.calc_path_mesh(path_error);
+    renderer.draw_path(J2_perturbations.path_handle, J2_perturbations.path_vertex_count, vec3f(.3333f, 0.4588f, .5418f));
     
     // Orbit from orbit integrator
     vec3d pos_kep, vel_kep;
-    constant_orbit.get_state_vectors(&pos_kep, &vel_kep);
-    renderer.bind_texture(red_tex);
-    renderer.draw_mesh(dot, pos_kep, satellite.state.orientation);
-    renderer.draw_path(constant_orbit.path_handle,  100, vec3f(.3333f, 0.4588f, .5418f));
+    if (constant_orbit.state_at(sim_clock, &pos_kep, &vel_kep)) {
+        renderer.bind_texture(red_tex);
+        renderer.draw_mesh(dot, pos_kep, satellite.state.orientation);
+    }
+    constant_orbit.calc_path_mesh(path_error);
+    renderer.draw_path(constant_orbit.path_handle,  constant_orbit.path_vertex_count, vec3f(.3333f, 0.4588f, .5418f));
+
+    // Orbit from Brouwer mean elements
+    if (J2_mean_valid) {
+        vec3d pos_mean;
+        J2_mean.state_at(sim_clock, &pos_mean, nullptr);
+        renderer.bind_texture(blue_tex);
+        renderer.draw_mesh(dot, pos_mean, satellite.state.orientation);
+    }
+
+    // element catalog, TEME taken as ECI which is plenty for display
+    if (draw_catalog && catalog.size() > 0) {
+        // only when sim time has moved, not every frame (paused, or several frames per step)
+        if (!catalog_current || sim_clock - catalog_clock != 0.0) {
+            catalog.propagate_to(sim_clock);
+            catalog_instances.clear();
+            catalog_instances.add_soa(catalog.position, catalog.status.data());
+            catalog_clock = sim_clock;
+            catalog_current = true;
+
+            // shadow of the whole catalog in one pass, failed objects count as sunlit
+            const size_t count = catalog.size();
+            catalog_shadow.resize(count);
+            shadow_function_batch(catalog.position[0].data(), catalog.position[1].data(), catalog.position[2].data(), count,
+                                  bodies.sun_position, earth.equatorial_radius, catalog_shadow.data());
+            catalog_eclipsed[0] = catalog_eclipsed[1] = catalog_eclipsed[2] = 0;
+            for (size_t n = 0; n < count; n++) {
+                if (catalog.status[n] != 0) {
+                    catalog_shadow[n] = 1.0;
+                    continue;
+                }
+                catalog_eclipsed[eclipse_state_from_shadow(catalog_shadow[n])]++;
+            }
+            catalog_eclipse_events += catalog_eclipses.update_batch(sim_time, catalog_shadow.data(), (uint32)count);
+            catalog_eclipses.events.clear();
+        }
+        renderer.bind_texture(green_tex);
+        renderer.draw_mesh_instanced(dot, catalog_instances, 3.0f, vec3f(0.4f, 0.9f, 0.4f));
+    }
     
     // draw orbit/equatorial planes
     if (draw_planes) {
@@ -205,6 +353,8 @@ void aimpoint::render3D() {
         renderer.draw_plane(vec3f(0.0f, 0.0f, 1.0f), 30000000, vec3f(0.8f, 0.70f, 0.80f), 0.3f);
         renderer.draw_plane(J2_perturbations.specific_ang_momentum_unit, 20000000, vec3f(1.0f, 0.96f, 0.68f), 0.7f);
     }
+
+    renderer.end_draw_list();
 }
 
 void aimpoint::renderUI() {
@@ -249,8 +399,27 @@ void aimpoint::renderUI() {
         ImGui::Text("Arg. of Periapsis: %.2f deg", J2_perturbations.argument_of_periapsis);
         ImGui::Text("Mean Anomaly (Epoch): %.2f deg", J2_perturbations.mean_anomaly_at_epoch);
         ImGui::Text("Period: %.3f min", J2_perturbations.period / 60.0);
+        ImGui::Text("Sunlit Fraction: %.3f", satellite_shadow);
+        if (draw_catalog && catalog.size() > 0) {
+            ImGui::Text("Catalog: %u sunlit, %u penumbra, %u umbra (%llu transitions)",
+                        catalog_eclipsed[ECLIPSE_SUNLIT], catalog_eclipsed[ECLIPSE_PENUMBRA], catalog_eclipsed[ECLIPSE_UMBRA],
+                        (unsigned long long)catalog_eclipse_events);
+        }
         ImGui::Separator();
 
+        if (J2_mean_valid) {
+            double mean_raan, mean_argp, mean_M;
+            J2_mean.mean_elements_at(sim_clock, &mean_raan, &mean_argp, &mean_M);
+            ImGui::Text("Brouwer Mean Elements (J2-J4)");
+            ImGui::Text("Eccentricity: %.5f", J2_mean.eccentricity);
+            ImGui::Text("Semimajor Axis: %.1f km", J2_mean.semimajor_axis/1000.0);
+            ImGui::Text("Inclination: %.2f deg", J2_mean.inclination);
+            ImGui::Text("RAAN: %.2f deg (%.3f deg/day)", mean_raan, J2_mean.right_ascension_rate*86400.0);
+            ImGui::Text("Arg. of Periapsis: %.2f deg (%.3f deg/day)", mean_argp, J2_mean.argument_of_periapsis_rate*86400.0);
+            ImGui::Text("Mean Anomaly: %.2f deg", mean_M);
+            ImGui::Separator();
+        }
+
         ImGui::End();
 
         if (show_anomoly_panel) {
@@ -280,6 +449,50 @@ void aimpoint::renderUI() {
         }
     }
 
+    if (show_porkchop_panel) {
+        ImGui::Begin("Earth-Mars Transfers");
+
+        if (!de_file.is_open()) {
+            ImGui::Text("Needs a DE440 file for the planet positions");
+        } else {
+            int revs = (int)transfer.max_revolutions;
+            if (ImGui::SliderInt("Max revolutions", &revs, 0, 3))
+                transfer.max_revolutions = (uint32)revs;
+            ImGui::SameLine();
+            if (ImGui::Button("Solve"))
+                solve_transfers();
+
+            if (!transfer.total_vinf.empty()) {
+                size_t best = transfer.cell(transfer.best_departure, transfer.best_arrival);
+                ImGui::Text("%llu solves in %.1f ms", (unsigned long long)transfer.num_solves, transfer.solve_ms);
+                ImGui::Text("Best: C3 %.2f km^2/s^2, arrival v_inf %.2f km/s, departure +%.0f days, flight %.0f days",
+                            transfer.departure_c3[best]*1.0e-6, transfer.arrival_vinf[best]*1.0e-3,
+                            (transfer.departure_time(transfer.best_departure) - transfer.departure_start) / 86400.0,
+                            (transfer.arrival_time(transfer.best_arrival) - transfer.departure_time(transfer.best_departure)) / 86400.0);
+
+                // days from the first departure on both axes, colored by total v_inf
+                double scale_min = transfer.best_total_vinf;
+                double scale_max = transfer.best_total_vinf + 10000.0;
+                double arrival_first = (transfer.arrival_start - transfer.departure_start) / 86400.0;
+                ImPlotPoint bounds_min(0.0, arrival_first);
+                ImPlotPoint bounds_max(transfer.departure_span / 86400.0, arrival_first + transfer.arrival_span / 86400.0);
+
+                ImPlot::PushColormap(ImPlotColormap_Viridis);
+                if (ImPlot::BeginPlot("##porkchop", ImVec2(-80, -1))) {
+                    ImPlot::SetupAxes("departure [days]", "arrival [days]");
+                    ImPlot::PlotHeatmap("total v_inf", transfer.total_vinf.data(), transfer.arrival_steps, transfer.departure_steps,
+                                        scale_min, scale_max, nullptr, bounds_min, bounds_max);
+                    ImPlot::EndPlot();
+                }
+                ImGui::SameLine();
+                ImPlot::ColormapScale("m/s", scale_min, scale_max, ImVec2(70, -1));
+                ImPlot::PopColormap();
+            }
+        }
+
+        ImGui::End();
+    }
+
     //ImGui::SetNextWindowBgAlpha(0.0f);
     ImGui::Begin("Render Frame", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
     switch(render_frame_enum) {
@@ -309,6 +522,16 @@ void aimpoint::renderUI() {
     ImGui::End();
 }
 
+// Earth-Mars porkchop over one synodic period from the current sim time
+void aimpoint::solve_transfers() {
+    transfer.departure_start = sim_clock;
+    transfer.departure_span = 780.0*86400.0;
+    transfer.arrival_start = sim_clock + 90.0*86400.0;
+    transfer.arrival_span = (780.0 + 400.0)*86400.0;
+    if (transfer.sample_endpoints(de_file, DE_EMB, DE_MARS))
+        transfer.run();
+}
+
 void aimpoint::shutdown() {
 }
 
@@ -356,6 +579,13 @@ void aimpoint::key_callback(int key, int scancode, int action, int mods) {
         draw_ground_tracks = !draw_ground_tracks;
     }
 
+    // Earth-Mars porkchop plot
+    if (key == GLFW_KEY_T && action == GLFW_RELEASE) {
+        show_porkchop_panel = !show_porkchop_panel;
+        if (show_porkchop_panel && transfer.total_vinf.empty() && de_file.is_open())
+            solve_transfers();
+    }
+
     // toggle orbital param displays
     if (key == GLFW_KEY_K && action == GLFW_RELEASE) {
         show_keplerian_panel = !show_keplerian_panel;
@@ -364,10 +594,36 @@ void aimpoint::key_callback(int key, int scancode, int action, int mods) {
         show_anomoly_panel = !show_anomoly_panel;
     }
 
+    // element catalog
+    if (key == GLFW_KEY_O && action == GLFW_RELEASE) {
+        draw_catalog = !draw_catalog;
+    }
+
     // orbital planes
     if (key == GLFW_KEY_P && action == GLFW_RELEASE) {
         draw_planes = !draw_planes;
     }
+
+    // lunisolar perturbations on the integrated satellite
+    if (key == GLFW_KEY_L && action == GLFW_RELEASE) {
+        use_lunisolar = !use_lunisolar;
+        satellite.third_bodies = use_lunisolar ? &lunisolar : nullptr;
+        spdlog::info("Lunisolar perturbations {0}", use_lunisolar ? "enabled" : "disabled");
+    }
+
+    // atmospheric drag on the integrated satellite
+    if (key == GLFW_KEY_D && action == GLFW_RELEASE) {
+        use_drag = !use_drag;
+        satellite.drag_model = use_drag ? &atmo : nullptr;
+        spdlog::info("Atmospheric drag {0}", use_drag ? "enabled" : "disabled");
+    }
+
+    // solar radiation pressure on the integrated satellite
+    if (key == GLFW_KEY_S && action == GLFW_RELEASE) {
+        use_srp = !use_srp;
+        satellite.srp_model = use_srp ? &srp : nullptr;
+        spdlog::info("Solar radiation pressure {0}", use_srp ? "enabled" : "disabled");
+    }
 }
 
 void aimpoint::mouse_pos_callback(double xpos, double ypos) {
@@ -390,15 +646,66 @@ void aimpoint::mouse_scroll_callback(double xoffset, double yoffset) {
 
 
 // Entry point
+// screens the element catalog from its newest element epoch and prints the
+// conjunctions, without opening a window
+static int screen_conjunctions(double days) {
+    tle_catalog catalog;
+    if (!catalog.load_tle("data/catalog.tle") && !catalog.load_omm_csv("data/catalog.csv")) {
+        spdlog::error("No element catalog found");
+        return 1;
+    }
+    if (catalog.size() < 2) {
+        spdlog::error("Need at least two objects to screen");
+        return 1;
+    }
+
+    epoch start = catalog.elements[0].element_epoch;
+    for (const sgp4_elements& e : catalog.elements) {
+        if (e.element_epoch - start > 0.0)
+            start = e.element_epoch;
+    }
+
+    conjunction_screening screening;
+    screening.run(catalog, start, days*86400.0);
+
+    printf("%-10s %-10s %-24s %12s %12s\n", "primary", "secondary", "TCA (UTC)", "miss [km]", "speed [km/s]");
+    for (const conjunction& c : screening.conjunctions) {
+        int32 year, month, day, hour, minute;
+        double second;
+        c.tca.to_calendar(TIME_SCALE_UTC, &year, &month, &day, &hour, &minute, &second);
+        printf("%-10u %-10u %04d-%02d-%02d %02d:%02d:%06.3f %12.3f %12.3f\n",
+               catalog.elements[c.primary].catalog_number, catalog.elements[c.secondary].catalog_number,
+               year, month, day, hour, minute, second, c.miss_distance / 1000.0, c.relative_speed / 1000.0);
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
 
     set_terminal_log_level(log_level::info);
     spdlog::info("Creating application...");
 
     aimpoint app;
-    app.run();
+    for (int n = 1; n < argc; n++) {
+        if (strcmp(argv[n], "--startup-benchmark") == 0) {
+            app.startup_benchmark = true;
+        } else if (strcmp(argv[n], "--startup-trace") == 0 && n + 1 < argc) {
+            set_startup_trace_file(argv[++n]);
+        } else if (strcmp(argv[n], "--screen-conjunctions") == 0) {
+            // optional duration in days
+            double days = 1.0;
+            if (n + 1 < argc && argv[n+1][0] != '-')
+                days = atof(argv[++n]);
+            return screen_conjunctions(days);
+        } else {
+            spdlog::warn("Unknown argument '{0}'", argv[n]);
+        }
+    }
 
-    system("pause");
+    int result = app.run();
 
-    return 0;
+    if (!app.startup_benchmark)
+        system("pause");
+
+    return result;
 }
\ No newline at end of file
@@ -6,11 +6,19 @@
 
 #include "planet.h"
 #include "orbit.h"
+#include "brouwer_orbit.h"
+#include "ephemeris.h"
+#include "atmosphere.h"
+#include "solar_radiation.h"
+#include "tle_catalog.h"
+#include "porkchop.h"
 
 const size_t num_seconds_history = 5;
 const size_t buffer_length = num_seconds_history * 60;
 const size_t orbit_buffer_length = (200) * 60;
 const size_t frames_per_min = 60*60;
+const double ground_track_interval = 30.0; // s between ground track samples
+const uint32 ground_track_length = 2880;   // samples kept per track (one day)
 
 enum coordinate_frame : int {
     ECI = 0,
@@ -22,7 +30,7 @@ enum coordinate_frame : int {
 
 struct aimpoint : public base_app {
 public:
-    aimpoint() : constant_orbit(earth), J2_perturbations(earth) {}
+    aimpoint() : constant_orbit(earth), J2_perturbations(earth), J2_mean(earth) {}
 
     void key_callback(int key, int scancode, int action, int mods) override;
     void mouse_pos_callback(double xpos, double ypos) override;
@@ -37,10 +45,17 @@ private:
     void renderUI() override;
     void shutdown() override;
 
+    void solve_transfers();
+
     bool show_keplerian_panel = false;
     bool show_anomoly_panel = false;
     bool draw_planes = false;
     bool draw_ground_tracks = false;
+    bool show_porkchop_panel = false;
+    bool draw_catalog = true;
+    bool use_lunisolar = false; // extra forces are opt-in, so the baseline stays a J2 comparison
+    bool use_drag = false;
+    bool use_srp = false;
 
     triangle_mesh mesh, dot;
     texture grid_tex, red_tex, green_tex, blue_tex;
@@ -49,11 +64,34 @@ private:
     double launch_lat, launch_lon, launch_az;
 
     planet earth;
+    earth_orientation orientation;
+    eop_table eop;
+    ephemeris lunisolar;
+    jpl_ephemeris de_file;
+    atmosphere atmo;
+    solar_radiation srp;
+    eclipse_monitor eclipses;
+    double satellite_shadow = 1.0;
     orbit constant_orbit, J2_perturbations;
+    brouwer_orbit J2_mean;
+    bool J2_mean_valid = false; // blue dot, track and panel only when the mean elements were created
+    tle_catalog catalog;
+    instance_batch catalog_instances;
+    epoch catalog_clock;          // instant catalog_instances were propagated to
+    bool catalog_current = false;
+    std::vector<double> catalog_shadow;
+    eclipse_monitor catalog_eclipses;
+    uint32 catalog_eclipsed[3] = {};  // objects sunlit, in penumbra, in umbra
+    uint64 catalog_eclipse_events = 0;
+    porkchop transfer;
     satellite_body satellite;
 
     mat3d lci2eci, eci2lci;
 
+    // ground tracks of the integrated satellite, constant orbit and mean element orbit
+    ground_track_history ground_tracks;
+    double next_ground_track_time = 0.0;
+
     // plotting
     plot_signal<double, orbit_buffer_length> t;
     plot_signal<double, orbit_buffer_length> M;
@@ -0,0 +1,190 @@
+#include "atmosphere.h"
+
+#include "log.h"
+
+#include <cmath>
+
+struct exponential_band {
+    double base_alt;     // km
+    double base_density; // kg/m^3
+    double scale_height; // km
+};
+
+// Vallado, Fundamentals of Astrodynamics, table 8-4
+static const exponential_band exponential_table[] = {
+    {   0.0, 1.225,     7.249 }, {  25.0, 3.899e-2,  6.349 }, {  30.0, 1.774e-2,  6.682 },
+    {  40.0, 3.972e-3,  7.554 }, {  50.0, 1.057e-3,  8.382 }, {  60.0, 3.206e-4,  7.714 },
+    {  70.0, 8.770e-5,  6.549 }, {  80.0, 1.905e-5,  5.799 }, {  90.0, 3.396e-6,  5.382 },
+    { 100.0, 5.297e-7,  5.877 }, { 110.0, 9.661e-8,  7.263 }, { 120.0, 2.438e-8,  9.473 },
+    { 130.0, 8.484e-9, 12.636 }, { 140.0, 3.845e-9, 16.149 }, { 150.0, 2.070e-9, 22.523 },
+    { 180.0, 5.464e-10, 29.740 }, { 200.0, 2.789e-10, 37.105 }, { 250.0, 7.248e-11, 45.546 },
+    { 300.0, 2.418e-11, 53.628 }, { 350.0, 9.518e-12, 53.298 }, { 400.0, 3.725e-12, 58.515 },
+    { 450.0, 1.585e-12, 60.828 }, { 500.0, 6.967e-13, 63.822 }, { 600.0, 1.454e-13, 71.835 },
+    { 700.0, 3.614e-14, 88.667 }, { 800.0, 1.170e-14, 124.64 }, { 900.0, 5.245e-15, 181.05 },
+    { 1000.0, 3.019e-15, 268.00 },
+};
+
+struct density_node {
+    double alt;     // km
+    double density; // kg/m^3
+};
+
+// U.S. Standard Atmosphere 1976, tabulated densities
+static const density_node us76_table[] = {
+    {   0.0, 1.225 },     {  10.0, 4.135e-1 },  {  20.0, 8.891e-2 },  {  30.0, 1.841e-2 },
+    {  40.0, 3.996e-3 },  {  50.0, 1.027e-3 },  {  60.0, 3.097e-4 },  {  70.0, 8.283e-5 },
+    {  80.0, 1.846e-5 },  {  90.0, 3.416e-6 },  { 100.0, 5.604e-7 },  { 110.0, 9.708e-8 },
+    { 120.0, 2.222e-8 },  { 130.0, 8.152e-9 },  { 140.0, 3.831e-9 },  { 150.0, 2.076e-9 },
+    { 160.0, 1.233e-9 },  { 170.0, 7.815e-10 }, { 180.0, 5.194e-10 }, { 190.0, 3.581e-10 },
+    { 200.0, 2.541e-10 }, { 250.0, 6.073e-11 }, { 300.0, 1.916e-11 }, { 350.0, 7.014e-12 },
+    { 400.0, 2.803e-12 }, { 450.0, 1.184e-12 }, { 500.0, 5.215e-13 }, { 600.0, 1.137e-13 },
+    { 700.0, 3.070e-14 }, { 800.0, 1.136e-14 }, { 900.0, 5.759e-15 }, { 1000.0, 3.561e-15 },
+};
+
+struct harris_priester_node {
+    double alt;         // km
+    double density_min; // g/km^3 (= 1e-12 kg/m^3)
+    double density_max; // g/km^3
+};
+
+// Montenbruck & Gill, Satellite Orbits, table 3.8 (mean solar activity)
+static const harris_priester_node harris_priester_table[] = {
+    { 100.0, 497400.0, 497400.0 }, { 120.0, 24900.0, 24900.0 }, { 130.0, 8377.0, 8710.0 },
+    { 140.0, 3899.0, 4059.0 }, { 150.0, 2122.0, 2215.0 }, { 160.0, 1263.0, 1344.0 },
+    { 170.0, 800.8, 875.8 },   { 180.0, 528.3, 601.0 },   { 190.0, 361.7, 429.7 },
+    { 200.0, 255.7, 316.2 },   { 210.0, 183.9, 239.6 },   { 220.0, 134.1, 185.3 },
+    { 230.0, 99.49, 145.5 },   { 240.0, 74.88, 115.7 },   { 250.0, 57.09, 93.08 },
+    { 260.0, 44.03, 75.55 },   { 270.0, 34.30, 61.82 },   { 280.0, 26.97, 50.95 },
+    { 290.0, 21.39, 42.26 },   { 300.0, 17.08, 35.26 },   { 320.0, 10.99, 25.11 },
+    { 340.0, 7.214, 18.19 },   { 360.0, 4.824, 13.37 },   { 380.0, 3.274, 9.955 },
+    { 400.0, 2.249, 7.492 },   { 420.0, 1.558, 5.684 },   { 440.0, 1.091, 4.355 },
+    { 460.0, 0.7701, 3.362 },  { 480.0, 0.5474, 2.612 },  { 500.0, 0.3915, 2.042 },
+    { 520.0, 0.2813, 1.605 },  { 540.0, 0.2042, 1.267 },  { 560.0, 0.1488, 1.005 },
+    { 580.0, 0.1092, 0.7997 }, { 600.0, 0.08070, 0.6390 }, { 620.0, 0.06012, 0.5123 },
+    { 640.0, 0.04519, 0.4121 }, { 660.0, 0.03430, 0.3325 }, { 680.0, 0.02632, 0.2691 },
+    { 700.0, 0.02043, 0.2185 }, { 720.0, 0.01607, 0.1779 }, { 740.0, 0.01281, 0.1452 },
+    { 760.0, 0.01036, 0.1190 }, { 780.0, 0.008496, 0.09776 }, { 800.0, 0.007069, 0.08059 },
+    { 840.0, 0.004680, 0.05741 }, { 880.0, 0.003200, 0.04210 }, { 920.0, 0.002210, 0.03130 },
+    { 960.0, 0.001560, 0.02360 }, { 1000.0, 0.001150, 0.01810 },
+};
+
+// log-linear interpolation between tabulated nodes (extrapolates off the ends)
+template<typename node_type, typename get_density>
+static double interp_log_density(const node_type* nodes, size_t num_nodes, double alt_km, get_density density_of) {
+    size_t k = 0;
+    while (k + 2 < num_nodes && alt_km >= nodes[k + 1].alt)
+        k++;
+
+    double f = (alt_km - nodes[k].alt) / (nodes[k + 1].alt - nodes[k].alt);
+    double l0 = log(density_of(nodes[k]));
+    double l1 = log(density_of(nodes[k + 1]));
+    return l0 + f*(l1 - l0);
+}
+
+atmosphere::atmosphere() : model(ATMOSPHERE_EXPONENTIAL), body(nullptr), sun(nullptr),
+                           rotation_rate(0.0) {
+    for (uint32 n = 0; n < table_size; n++) {
+        log_rho[n] = log_rho_max[n] = -700.0; // ~vacuum until initialized
+    }
+}
+
+void atmosphere::init(planet* new_body, atmosphere_model new_model, ephemeris* sun_source) {
+    body = new_body;
+    model = new_model;
+    sun = sun_source;
+
+    rotation_rate = body->rotation_rate;
+
+    const size_t num_exp = sizeof(exponential_table) / sizeof(exponential_table[0]);
+    const size_t num_us76 = sizeof(us76_table) / sizeof(us76_table[0]);
+    const size_t num_hp = sizeof(harris_priester_table) / sizeof(harris_priester_table[0]);
+
+    for (uint32 n = 0; n < table_size; n++) {
+        double alt_km = n * (table_step / 1000.0);
+
+        switch (model) {
+            case ATMOSPHERE_EXPONENTIAL: {
+                size_t k = 0;
+                while (k + 1 < num_exp && alt_km >= exponential_table[k + 1].base_alt)
+                    k++;
+                const exponential_band& band = exponential_table[k];
+                log_rho[n] = log(band.base_density) - (alt_km - band.base_alt) / band.scale_height;
+                log_rho_max[n] = log_rho[n];
+            } break;
+            case ATMOSPHERE_US76: {
+                log_rho[n] = interp_log_density(us76_table, num_us76, alt_km,
+                                                [](const density_node& node) { return node.density; });
+                log_rho_max[n] = log_rho[n];
+            } break;
+            case ATMOSPHERE_HARRIS_PRIESTER: {
+                // below the table, blend into US76 so launches still see an atmosphere
+                if (alt_km < harris_priester_table[0].alt) {
+                    log_rho[n] = interp_log_density(us76_table, num_us76, alt_km,
+                                                    [](const density_node& node) { return node.density; });
+                    log_rho_max[n] = log_rho[n];
+                } else {
+                    log_rho[n] = interp_log_density(harris_priester_table, num_hp, alt_km,
+                                                    [](const harris_priester_node& node) { return node.density_min*1.0e-12; });
+                    log_rho_max[n] = interp_log_density(harris_priester_table, num_hp, alt_km,
+                                                        [](const harris_priester_node& node) { return node.density_max*1.0e-12; });
+                }
+            } break;
+        }
+    }
+
+    if (model == ATMOSPHERE_HARRIS_PRIESTER && sun == nullptr) {
+        spdlog::warn("Harris-Priester atmosphere without a Sun ephemeris, using mean of min/max density");
+    }
+}
+
+double atmosphere::lookup(const double* table, double alt) {
+    // clamp into the table without branching (minsd/maxsd), extrapolate above the top
+    double x = alt * (1.0 / table_step);
+    x = x < 0.0 ? 0.0 : x;
+    x = x > 1.0e6 ? 1.0e6 : x;
+    uint32 i = (uint32)x;
+    i = i < (table_size - 2) ? i : (table_size - 2);
+    double f = x - (double)i;
+
+    return exp(table[i] + f*(table[i + 1] - table[i]));
+}
+
+double atmosphere::density(double alt) const {
+    return lookup(log_rho, alt);
+}
+
+double atmosphere::density(vec3d pos_inertial, double t) {
+    double alt = body->geocentric_altitude(pos_inertial);
+
+    double rho = lookup(log_rho, alt);
+    if (model != ATMOSPHERE_HARRIS_PRIESTER)
+        return rho;
+
+    double rho_max = lookup(log_rho_max, alt);
+    if (sun == nullptr)
+        return 0.5*(rho + rho_max);
+
+    // bulge apex lags the sub-solar point by 30 deg in right ascension
+    vec3d sun_unit = laml::normalize(sun->at(t).sun_position);
+    const double c_lag = 0.86602540378443865; // cos(30)
+    const double s_lag = 0.5;                 // sin(30)
+    vec3d apex(c_lag*sun_unit.x - s_lag*sun_unit.y, s_lag*sun_unit.x + c_lag*sun_unit.y, sun_unit.z);
+
+    double cos_psi = laml::dot(pos_inertial, apex) / laml::length(pos_inertial);
+    double c = 0.5 + 0.5*cos_psi; // cos^2(psi/2)
+    double weight = pow(c > 0.0 ? c : 0.0, 0.5*harris_priester_exponent);
+
+    return rho + (rho_max - rho)*weight;
+}
+
+vec3d atmosphere::drag_accel(vec3d pos_inertial, vec3d vel_inertial, double t, double ballistic_coeff) {
+    double rho = density(pos_inertial, t);
+
+    // velocity relative to an atmosphere co-rotating with the planet
+    vec3d v_rel(vel_inertial.x + rotation_rate*pos_inertial.y,
+                vel_inertial.y - rotation_rate*pos_inertial.x,
+                vel_inertial.z);
+    double v_mag = laml::length(v_rel);
+
+    return (-0.5*rho*ballistic_coeff*v_mag) * v_rel;
+}
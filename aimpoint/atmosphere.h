@@ -0,0 +1,46 @@
+#pragma once
+#include "defines.h"
+
+#include "planet.h"
+#include "ephemeris.h"
+
+enum atmosphere_model : int {
+    ATMOSPHERE_EXPONENTIAL = 0,     // piecewise exponential (Vallado, table 8-4)
+    ATMOSPHERE_US76 = 1,            // U.S. Standard Atmosphere 1976
+    ATMOSPHERE_HARRIS_PRIESTER = 2, // mean solar activity, with diurnal bulge
+};
+
+// Density models precomputed into a log-density table on a uniform 1 km grid,
+// so a lookup is one multiply, a lerp and an exp with no searching or branches.
+struct atmosphere {
+    atmosphere();
+
+    void init(planet* body, atmosphere_model new_model, ephemeris* sun_source = nullptr);
+
+    // density at a given altitude, kg/m^3. For Harris-Priester this is the
+    // night-side (minimum) density.
+    double density(double alt) const;
+    // density at a position, including the Harris-Priester diurnal bulge
+    double density(vec3d pos_inertial, double t);
+
+    // drag acceleration relative to the co-rotating atmosphere.
+    // ballistic_coeff = Cd*A/m [m^2/kg]
+    vec3d drag_accel(vec3d pos_inertial, vec3d vel_inertial, double t, double ballistic_coeff);
+
+    atmosphere_model model;
+    uint32 harris_priester_exponent = 4; // 2 for low inclination, up to 6 for polar orbits
+
+    static const uint32 table_size = 1001; // 0 to 1000 km
+    static constexpr double table_step = 1000.0; // m
+
+private:
+    planet* body;
+    ephemeris* sun;
+
+    double rotation_rate; // cached from body
+
+    double log_rho[table_size];
+    double log_rho_max[table_size]; // Harris-Priester bulge apex densities
+
+    static double lookup(const double* table, double alt);
+};
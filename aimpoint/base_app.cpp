@@ -1,6 +1,7 @@
 #include "base_app.h"
 
 #include "log.h"
+#include "startup_profile.h"
 
 #include <thread>
 #include <chrono>
@@ -42,6 +43,7 @@ int base_app::run(int32 window_width, int32 window_heigt) {
         return 1;
     }
 
+    sim_clock = sim_epoch;
     sim_time = 0.0;
     const double step_time = 1.0 / simulation_rate;
 
@@ -81,7 +83,25 @@ int base_app::run(int32 window_width, int32 window_heigt) {
             }
         }
 
-        base_render();
+        if (render_frame == 0) {
+            {
+                startup_timer timer("first frame");
+                base_render();
+            }
+            startup_profile_mark("first frame presented");
+
+            if (startup_benchmark) {
+                {
+                    startup_timer timer("remaining assets");
+                    renderer.assets.wait_idle();
+                }
+                startup_profile_mark("assets loaded");
+                done = true;
+            }
+            startup_profile_report();
+        } else {
+            base_render();
+        }
     }
 
     base_shutdown();
@@ -105,9 +125,12 @@ int base_app::base_init(int32 window_width, int32 window_heigt) {
     yaw = 0.0;
     pitch = 0.0;
 
-    renderer.init_gl_glfw(this, window_width, window_heigt);
+    {
+        startup_timer timer("renderer");
+        renderer.init_gl_glfw(this, window_width, window_heigt);
+    }
 
-    blank_tex.load_texture_file("data/blank.png");
+    renderer.assets.load_texture(&blank_tex, "data/blank.png");
 
     spdlog::info("Application intitialized");
 
@@ -115,6 +138,7 @@ int base_app::base_init(int32 window_width, int32 window_heigt) {
         spdlog::info("Recording...");
     }
 
+    startup_timer timer("app init");
     return init();
 }
 
@@ -123,11 +147,17 @@ void base_app::base_step(double dt) {
 
     step(dt);
     
-    sim_time += dt;
+    // accumulate in the two-part clock, so sim_time doesn't pick up rounding
+    // from adding a small dt to a large value every step
+    sim_clock += dt;
+    sim_time = sim_clock - sim_epoch;
     sim_frame++;
 }
 
 void base_app::base_render() {
+    // hand off anything the loader finished since last frame
+    renderer.assets.finalize();
+
     if (input.mouse2) {
         yaw   -= input.xvel * frame_time * 0.75f;
         pitch -= input.yvel * frame_time * 0.50f;
@@ -192,6 +222,10 @@ void base_app::base_render() {
     double value = 0.0f;
     char* unit = pretty_time(sim_time, &value);
     ImGui::Text("T: %.1f %s", value, unit);
+    int32 year, month, day, hour, minute;
+    double second;
+    sim_clock.to_calendar(TIME_SCALE_UTC, &year, &month, &day, &hour, &minute, &second);
+    ImGui::Text("%04d-%02d-%02d %02d:%02d:%02d UTC", year, month, day, hour, minute, (int32)second);
     ImGui::End();
 
     renderer.end_debug_UI();
@@ -3,10 +3,15 @@
 
 #include "render/renderer.h"
 #include "physics.h"
+#include "epoch.h"
 
 struct base_app {
     int run(int32 window_width = 1280, int32 window_heigt = 720);
 
+    // quit once the first frame is presented and every asset has loaded,
+    // for timing startup
+    bool startup_benchmark = false;
+
     // base functions
     void base_key_callback(int key, int scancode, int action, int mods);
     void base_mouse_pos_callback(double xpos, double ypos);
@@ -41,7 +46,9 @@ protected:
     uint64 sim_frame;
     uint64 render_frame;
 
-    double sim_time;
+    epoch sim_epoch; // instant at sim_time = 0, J2000 TT unless init() sets it
+    epoch sim_clock; // current instant
+    double sim_time; // seconds since sim_epoch, derived from sim_clock
     double wall_time;
     double frame_time;
 
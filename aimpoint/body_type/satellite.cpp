@@ -33,7 +33,15 @@ void satellite_body::set_orbit_circ(planet* p, double lat, double lon, double al
 
 laml::Vec3_highp satellite_body::force_func(const rigid_body_state* at_state, double t) {
     //return grav_body->gravity(at_state->position)*mass;
-    return grav_body->gravity_J2(at_state->position)*mass;
+    vec3d accel = grav_body->gravity_J2(at_state->position);
+    if (third_bodies)
+        accel = accel + third_bodies->third_body_accel(at_state->position, t);
+    if (drag_model)
+        accel = accel + drag_model->drag_accel(at_state->position, at_state->velocity, t, drag_coefficient*drag_area*inv_mass);
+    if (srp_model)
+        accel = accel + srp_model->srp_accel(at_state->position, t, reflectivity*srp_area*inv_mass);
+
+    return accel*mass;
 }
 
 //laml::Vec3_highp satellite_body::moment_func(const rigid_body_state& at_state, double t) {
@@ -1,6 +1,9 @@
 #include "physics.h"
 
 #include "planet.h"
+#include "ephemeris.h"
+#include "atmosphere.h"
+#include "solar_radiation.h"
 
 struct satellite_body : public simulation_body {
     void set_orbit_circ(planet* p, double lat, double lon, double alt, double inc);
@@ -8,4 +11,12 @@ struct satellite_body : public simulation_body {
     virtual laml::Vec3_highp force_func(const rigid_body_state* at_state, double t) override;
 
     planet* grav_body;
+    ephemeris* third_bodies = nullptr; // optional lunisolar perturbations
+    atmosphere* drag_model = nullptr;  // optional atmospheric drag
+    solar_radiation* srp_model = nullptr; // optional solar radiation pressure
+
+    double drag_coefficient = 2.2;
+    double drag_area = 0.01; // m^2
+    double reflectivity = 1.3;
+    double srp_area = 0.01;  // m^2
 };
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "brouwer_orbit.h"
+
+#include "log.h"
+
+#include <cmath>
+
+static const double two_pi = 6.283185307179586476925287;
+
+// mean state iterations when fitting an osculating state
+static const uint32 max_fit_iterations = 50;
+static const double fit_tolerance = 1.0e-13; // equatorial radii
+
+brouwer_orbit::brouwer_orbit(const planet& set_body) : body(set_body) {}
+
+// two-body elements of a canonical state (gm = 1), rad. The node falls back to
+// the x axis for equatorial orbits and periapsis to the node for circular ones.
+static bool state_to_elements(const double* r, const double* v, double* a, double* e, double* i,
+                              double* node, double* argp, double* m) {
+    double h[3] = { r[1]*v[2] - r[2]*v[1], r[2]*v[0] - r[0]*v[2], r[0]*v[1] - r[1]*v[0] };
+    double hn = sqrt(h[0]*h[0] + h[1]*h[1] + h[2]*h[2]);
+    double rn = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);
+    double v2 = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+    double rv = r[0]*v[0] + r[1]*v[1] + r[2]*v[2];
+    double energy2 = 2.0/rn - v2;
+    if (hn == 0.0 || energy2 <= 0.0)
+        return false;
+
+    *a = 1.0 / energy2;
+    double ev[3];
+    for (int c = 0; c < 3; c++)
+        ev[c] = (v2 - 1.0/rn)*r[c] - rv*v[c];
+    *e = sqrt(ev[0]*ev[0] + ev[1]*ev[1] + ev[2]*ev[2]);
+    if (*e >= 1.0)
+        return false;
+    *i = acos(fmax(-1.0, fmin(1.0, h[2] / hn)));
+
+    // node line and the in-plane axis 90 deg ahead of it
+    double nx = -h[1], ny = h[0];
+    double nn = sqrt(nx*nx + ny*ny);
+    if (nn > 1.0e-12*hn) {
+        nx /= nn; ny /= nn;
+        *node = atan2(ny, nx);
+    } else {
+        nx = 1.0; ny = 0.0;
+        *node = 0.0;
+    }
+    double mx[3] = { -h[2]*ny / hn, h[2]*nx / hn, (h[0]*ny - h[1]*nx) / hn };
+
+    double u = atan2(r[0]*mx[0] + r[1]*mx[1] + r[2]*mx[2], r[0]*nx + r[1]*ny);
+    if (*e > 1.0e-12) {
+        *argp = atan2(ev[0]*mx[0] + ev[1]*mx[1] + ev[2]*mx[2], ev[0]*nx + ev[1]*ny);
+    } else {
+        *argp = 0.0;
+    }
+
+    double nu = u - *argp;
+    double E = atan2(sqrt(1.0 - (*e)*(*e))*sin(nu), *e + cos(nu));
+    *m = E - (*e)*sin(E);
+    return true;
+}
+
+void brouwer_orbit::set_mean_elements(double a, double e, double i, double node, double argp, double m, double n) {
+    a0 = a; e0 = e; i0 = i; node0 = node; argp0 = argp; m0 = m;
+    n0 = n;
+
+    double cosio = cos(i);
+    double sinio = sin(i);
+    double cosio2 = cosio*cosio;
+    double cosio4 = cosio2*cosio2;
+    double omeosq = 1.0 - e*e;
+    double rteosq = sqrt(omeosq);
+    double j4 = use_J4 ? J4 : 0.0;
+
+    con41 = 3.0*cosio2 - 1.0;
+    x1mth2 = 1.0 - cosio2;
+    x7thm1 = 7.0*cosio2 - 1.0;
+
+    // Brouwer secular rates, J2 to second order and J4 to first
+    double pinvsq = 1.0 / (a*a*omeosq*omeosq);
+    double temp1 = 1.5*j2*pinvsq*n0;
+    double temp2 = 0.5*temp1*j2*pinvsq;
+    double temp3 = -0.46875*j4*pinvsq*pinvsq*n0;
+    m_dot = n0 + 0.5*temp1*rteosq*con41 + 0.0625*temp2*rteosq*(13.0 - 78.0*cosio2 + 137.0*cosio4);
+    argp_dot = -0.5*temp1*(1.0 - 5.0*cosio2) + 0.0625*temp2*(7.0 - 114.0*cosio2 + 395.0*cosio4)
+             + temp3*(3.0 - 36.0*cosio2 + 49.0*cosio4);
+    node_dot = -temp1*cosio + (0.5*temp2*(4.0 - 19.0*cosio2) + 2.0*temp3*(3.0 - 7.0*cosio2))*cosio;
+
+    // J3 long periodics
+    double j3oj2 = use_J3 ? J3 / j2 : 0.0;
+    double denom = 1.0 + cosio;
+    if (fabs(denom) < 1.5e-12) denom = 1.5e-12;
+    aycof = -0.5*j3oj2*sinio;
+    xlcof = -0.25*j3oj2*sinio*(3.0 + 5.0*cosio) / denom;
+
+    const double rad2deg = laml::constants::rad2deg<double>;
+    eccentricity = e;
+    semimajor_axis = a*body.equatorial_radius;
+    inclination = i*rad2deg;
+    right_ascension = fmod(node + two_pi, two_pi)*rad2deg;
+    argument_of_periapsis = fmod(argp + two_pi, two_pi)*rad2deg;
+    mean_anomaly_at_epoch = fmod(m + two_pi, two_pi)*rad2deg;
+    right_ascension_rate = node_dot / time_unit * rad2deg;
+    argument_of_periapsis_rate = argp_dot / time_unit * rad2deg;
+    mean_anomaly_rate = m_dot / time_unit * rad2deg;
+}
+
+// osculating canonical state tau time units after reference_epoch
+void brouwer_orbit::osculating(double tau, double* r, double* v) const {
+    double mm = m0 + m_dot*tau;
+    double argpm = argp0 + argp_dot*tau;
+    double nodem = node0 + node_dot*tau;
+
+    // long periodics, in Lyddane's nonsingular variables
+    double axnl = e0*cos(argpm);
+    double temp = 1.0 / (a0*(1.0 - e0*e0));
+    double aynl = e0*sin(argpm) + temp*aycof;
+    double xl = mm + argpm + nodem + temp*xlcof*axnl;
+
+    // Kepler's equation for the eccentric longitude
+    double u = fmod(xl - nodem, two_pi);
+    double eo1 = u;
+    double sineo1 = 0.0, coseo1 = 1.0;
+    for (uint32 n = 0; n < 30; n++) {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        double step = (u - aynl*coseo1 + axnl*sineo1 - eo1) / (1.0 - coseo1*axnl - sineo1*aynl);
+        if (fabs(step) >= 0.95) step = step > 0.0 ? 0.95 : -0.95;
+        eo1 += step;
+        if (fabs(step) < 1.0e-12)
+            break;
+    }
+    sineo1 = sin(eo1);
+    coseo1 = cos(eo1);
+
+    double ecose = axnl*coseo1 + aynl*sineo1;
+    double esine = axnl*sineo1 - aynl*coseo1;
+    double el2 = axnl*axnl + aynl*aynl;
+    double pl = a0*(1.0 - el2);
+    double rl = a0*(1.0 - ecose);
+    double rdotl = sqrt(a0)*esine / rl;
+    double rvdotl = sqrt(pl) / rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = a0 / rl * (sineo1 - aynl - axnl*temp);
+    double cosu = a0 / rl * (coseo1 - axnl + aynl*temp);
+    double su = atan2(sinu, cosu);
+
+    double mrt = rl, mvt = rdotl, rvdot = rvdotl;
+    double xnode = nodem, xinc = i0;
+    if (use_short_periodics) {
+        double sin2u = 2.0*cosu*sinu;
+        double cos2u = 1.0 - 2.0*sinu*sinu;
+        temp = 1.0 / pl;
+        double temp1 = 0.5*j2*temp;
+        double temp2 = temp1*temp;
+        double cosio = cos(i0);
+        double sinio = sin(i0);
+
+        mrt = rl*(1.0 - 1.5*temp2*betal*con41) + 0.5*temp1*x1mth2*cos2u;
+        su = su - 0.25*temp2*x7thm1*sin2u;
+        xnode = nodem + 1.5*temp2*cosio*sin2u;
+        xinc = i0 + 1.5*temp2*cosio*sinio*cos2u;
+        mvt = rdotl - n0*temp1*x1mth2*sin2u;
+        rvdot = rvdotl + n0*temp1*(x1mth2*cos2u + 1.5*con41);
+    }
+
+    double sinsu = sin(su), cossu = cos(su);
+    double snod = sin(xnode), cnod = cos(xnode);
+    double sini = sin(xinc), cosi = cos(xinc);
+    double xmx = -snod*cosi;
+    double xmy = cnod*cosi;
+    double ux = xmx*sinsu + cnod*cossu;
+    double uy = xmy*sinsu + snod*cossu;
+    double uz = sini*sinsu;
+    double vx = xmx*cossu - cnod*sinsu;
+    double vy = xmy*cossu - snod*sinsu;
+    double vz = sini*cossu;
+
+    r[0] = mrt*ux; r[1] = mrt*uy; r[2] = mrt*uz;
+    v[0] = mvt*ux + rvdot*vx;
+    v[1] = mvt*uy + rvdot*vy;
+    v[2] = mvt*uz + rvdot*vz;
+}
+
+bool brouwer_orbit::create_from_state_vectors(const vec3d& pos_eci, const vec3d& vel_eci, const epoch& at) {
+    const double R = body.equatorial_radius;
+    time_unit = sqrt(R*R*R / body.gm);
+    j2 = body.J2 / (body.gm*R*R);
+    reference_epoch = at;
+
+    const double vel_unit = R / time_unit;
+    double target_r[3] = { pos_eci.x / R, pos_eci.y / R, pos_eci.z / R };
+    double target_v[3] = { vel_eci.x / vel_unit, vel_eci.y / vel_unit, vel_eci.z / vel_unit };
+
+    // adjust a mean two-body state until its periodic corrections land on the target
+    double mean_r[3] = { target_r[0], target_r[1], target_r[2] };
+    double mean_v[3] = { target_v[0], target_v[1], target_v[2] };
+    for (uint32 n = 0; n < max_fit_iterations; n++) {
+        double a, e, i, node, argp, m;
+        if (!state_to_elements(mean_r, mean_v, &a, &e, &i, &node, &argp, &m)) {
+            spdlog::warn("Brouwer mean elements need an elliptic orbit");
+            return false;
+        }
+        set_mean_elements(a, e, i, node, argp, m, 1.0 / (a*sqrt(a)));
+
+        double r[3], v[3];
+        osculating(0.0, r, v);
+        double err = 0.0;
+        for (int c = 0; c < 3; c++) {
+            mean_r[c] += target_r[c] - r[c];
+            mean_v[c] += target_v[c] - v[c];
+            err = fmax(err, fmax(fabs(target_r[c] - r[c]), fabs(target_v[c] - v[c])));
+        }
+        if (err < fit_tolerance) {
+            // The truncated short periodics leave a0 off by O(J2 e), which
+            // would show up as along-track drift. The mean motion comes from
+            // the energy integral instead, averaging the J2 potential over
+            // the mean orbit.
+            double rn = sqrt(target_r[0]*target_r[0] + target_r[1]*target_r[1] + target_r[2]*target_r[2]);
+            double v2 = target_v[0]*target_v[0] + target_v[1]*target_v[1] + target_v[2]*target_v[2];
+            double sin_lat = target_r[2] / rn;
+            double sini = sin(i0);
+            double eta = sqrt(1.0 - e0*e0);
+            double inv_a = 2.0/rn - v2 - j2*(3.0*sin_lat*sin_lat - 1.0)/(rn*rn*rn)
+                         - j2*(1.0 - 1.5*sini*sini)/(a0*a0*a0*eta*eta*eta);
+            if (inv_a > 0.0)
+                set_mean_elements(a0, e0, i0, node0, argp0, m0, inv_a*sqrt(inv_a));
+            return true;
+        }
+    }
+
+    spdlog::warn("Brouwer mean elements did not converge");
+    return false;
+}
+
+void brouwer_orbit::state_at(const epoch& when, vec3d* pos_eci, vec3d* vel_eci) const {
+    double r[3], v[3];
+    osculating((when - reference_epoch) / time_unit, r, v);
+
+    const double R = body.equatorial_radius;
+    const double vel_unit = R / time_unit;
+    if (pos_eci)
+        *pos_eci = vec3d(r[0]*R, r[1]*R, r[2]*R);
+    if (vel_eci)
+        *vel_eci = vec3d(v[0]*vel_unit, v[1]*vel_unit, v[2]*vel_unit);
+}
+
+void brouwer_orbit::mean_elements_at(const epoch& when, double* right_ascension_deg, double* argument_of_periapsis_deg,
+                                     double* mean_anomaly_deg) const {
+    double dt = when - reference_epoch;
+    if (right_ascension_deg)
+        *right_ascension_deg = fmod(fmod(right_ascension + right_ascension_rate*dt, 360.0) + 360.0, 360.0);
+    if (argument_of_periapsis_deg)
+        *argument_of_periapsis_deg = fmod(fmod(argument_of_periapsis + argument_of_periapsis_rate*dt, 360.0) + 360.0, 360.0);
+    if (mean_anomaly_deg)
+        *mean_anomaly_deg = fmod(fmod(mean_anomaly_at_epoch + mean_anomaly_rate*dt, 360.0) + 360.0, 360.0);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "defines.h"
+
+#include "planet.h"
+#include "epoch.h"
+
+// Analytic orbit about an oblate body from Brouwer mean elements.
+//
+// The mean elements drift at constant secular rates from J2 (to second
+// order) and J4, so the node, argument of periapsis and mean anomaly at any
+// epoch are a multiply-add. Osculating states add the J3 long periodic and
+// the first order J2 short periodic terms in Lyddane's form (the same set
+// SGP4 uses), which stays regular for circular and equatorial orbits.
+// Evaluating any epoch is O(1) with no accumulated state.
+//
+// Mean elements are found from an osculating state by iterating the
+// periodic corrections until they reproduce it.
+struct brouwer_orbit {
+    brouwer_orbit(const planet& set_body);
+
+    // false if the state is not elliptic or the mean elements don't converge
+    bool create_from_state_vectors(const vec3d& pos_eci, const vec3d& vel_eci, const epoch& at);
+
+    // osculating state at any time
+    void state_at(const epoch& when, vec3d* pos_eci, vec3d* vel_eci) const;
+    // mean angles at any time, deg
+    void mean_elements_at(const epoch& when, double* right_ascension_deg, double* argument_of_periapsis_deg,
+                          double* mean_anomaly_deg) const;
+
+    // terms included; change before create_from_state_vectors
+    bool use_J3 = true;
+    bool use_J4 = true;
+    bool use_short_periodics = true;
+    double J3 = -2.53241e-6; // unnormalized zonal harmonics (EGM2008)
+    double J4 = -1.61989e-6;
+
+    // mean elements at reference_epoch, deg like orbit
+    double eccentricity;
+    double semimajor_axis; // m
+    double inclination;
+    double right_ascension;
+    double argument_of_periapsis;
+    double mean_anomaly_at_epoch;
+    epoch reference_epoch;
+
+    // secular rates, deg/s
+    double right_ascension_rate;
+    double argument_of_periapsis_rate;
+    double mean_anomaly_rate;
+
+private:
+    const planet& body;
+
+    // canonical units: lengths in equatorial radii, gm = 1
+    double time_unit; // s
+    double j2;
+    double n0, a0, e0, i0, node0, argp0, m0; // rad, rad per time unit
+    double node_dot, argp_dot, m_dot;
+    double con41, x1mth2, x7thm1, aycof, xlcof;
+
+    void set_mean_elements(double a, double e, double i, double node, double argp, double m, double n);
+    void osculating(double tau, double* r, double* v) const;
+};
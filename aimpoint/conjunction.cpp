@@ -0,0 +1,490 @@
+#include "conjunction.h"
+
+#include "parallel.h"
+#include "log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+static const double mu_earth = 3.986008e14;         // m^3/s^2, WGS-72 to match SGP4
+static const double min_filter_radius = 6.0e6;      // m, floor for gravity bounds
+static const double interpolation_pad = 1000.0;     // m, Hermite vs SGP4
+static const double perturbation_pad = 2000.0;      // m, path vs osculating ellipse over one sample step
+static const double max_window_ratio = 0.7;         // geometry filter gives up on windows wider than ~45 deg
+static const size_t object_chunk_size = 1024;
+static const size_t candidate_chunk_size = 8;
+
+// osculating orbit of one object at the start of a sample interval
+struct screening_orbit {
+    double p, e;              // m
+    double perigee, apogee;   // m
+    double h[3], P[3], Q[3];  // unit normal, periapsis and in-plane perpendicular
+    double gravity_bound;     // m/s^2, max two-body acceleration along the orbit
+};
+
+// interpolated state of one object, gathered into hash bucket order so
+// neighbour scans read contiguous memory
+struct screening_entry {
+    double r[3], v[3];
+    double perigee, apogee, gravity_bound;
+    int32 cell[3];
+    uint32 index;
+    uint32 near_upper; // bit per axis, nearer the upper face of the cell
+};
+
+struct screening_candidate {
+    uint32 i, j;
+    double t; // s from start
+};
+
+static inline double dot3(const double* a, const double* b) {
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline void cross3(const double* a, const double* b, double* out) {
+    out[0] = a[1]*b[2] - a[2]*b[1];
+    out[1] = a[2]*b[0] - a[0]*b[2];
+    out[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static void osculating_orbit(const double* r, const double* v, screening_orbit* o) {
+    double h[3];
+    cross3(r, v, h);
+    double h_mag = sqrt(dot3(h, h));
+    double r_mag = sqrt(dot3(r, r));
+
+    double vxh[3];
+    cross3(v, h, vxh);
+    double e_vec[3];
+    for (int c = 0; c < 3; c++) {
+        e_vec[c] = vxh[c] / mu_earth - r[c] / r_mag;
+        o->h[c] = h[c] / h_mag;
+    }
+
+    o->p = h_mag*h_mag / mu_earth;
+    o->e = sqrt(dot3(e_vec, e_vec));
+    o->perigee = o->p / (1.0 + o->e);
+    o->apogee = o->e < 1.0 ? o->p / (1.0 - o->e) : 1.0e30;
+
+    // any in-plane direction works as periapsis for a circular orbit
+    const double* periapsis = o->e > 1.0e-9 ? e_vec : r;
+    double scale = o->e > 1.0e-9 ? o->e : r_mag;
+    for (int c = 0; c < 3; c++)
+        o->P[c] = periapsis[c] / scale;
+    cross3(o->h, o->P, o->Q);
+
+    double r_min = o->perigee > min_filter_radius ? o->perigee : min_filter_radius;
+    o->gravity_bound = 1.01 * mu_earth / (r_min*r_min);
+}
+
+// radius range of an orbit within 'half_width' of the in-plane direction u.
+// Returns false if the window is too wide to be useful.
+static bool radius_range_near(const screening_orbit& o, const double* u, double sin_rel_incl, double distance,
+                              double* r_min, double* r_max) {
+    double ratio = distance / (o.perigee*sin_rel_incl);
+    if (ratio >= max_window_ratio)
+        return false;
+    double half_width = asin(ratio);
+    double nu = atan2(dot3(u, o.Q), dot3(u, o.P));
+
+    double r0 = o.p / (1.0 + o.e*cos(nu - half_width));
+    double r1 = o.p / (1.0 + o.e*cos(nu + half_width));
+    *r_min = r0 < r1 ? r0 : r1;
+    *r_max = r0 > r1 ? r0 : r1;
+
+    // perigee (nu = 0) or apogee (nu = pi) inside the window
+    const double pi = 3.14159265358979323846;
+    double to_perigee = fabs(remainder(nu, 2.0*pi));
+    double to_apogee = fabs(remainder(nu - pi, 2.0*pi));
+    if (to_perigee <= half_width) *r_min = o.perigee;
+    if (to_apogee <= half_width) *r_max = o.apogee;
+    return true;
+}
+
+// Orbit path filter (after Hoots et al.): points of one orbit within
+// 'distance' of the other lie near the line of nodes, so compare the radii
+// the two orbits can reach around each node.
+static bool orbits_can_meet(const screening_orbit& a, const screening_orbit& b, double distance) {
+    double k[3];
+    cross3(a.h, b.h, k);
+    double s = sqrt(dot3(k, k));
+    if (s < 1.0e-3)
+        return true; // near coplanar, no line of nodes to speak of
+
+    for (int sign = -1; sign <= 1; sign += 2) {
+        double u[3] = { sign*k[0]/s, sign*k[1]/s, sign*k[2]/s };
+        double a_min, a_max, b_min, b_max;
+        if (!radius_range_near(a, u, s, distance, &a_min, &a_max) ||
+            !radius_range_near(b, u, s, distance, &b_min, &b_max))
+            return true;
+        if (a_min - distance <= b_max && b_min - distance <= a_max)
+            return true;
+    }
+    return false;
+}
+
+static inline uint32 hash_cell(int32 x, int32 y, int32 z, uint32 mask) {
+    return (((uint32)x*73856093u) ^ ((uint32)y*19349663u) ^ ((uint32)z*83492791u)) & mask;
+}
+
+// state arrays for one instant, SoA
+struct screening_states {
+    std::vector<double> r[3];
+    std::vector<double> v[3];
+    std::vector<uint8> valid;
+
+    void resize(size_t n) {
+        for (int c = 0; c < 3; c++) {
+            r[c].resize(n);
+            v[c].resize(n);
+        }
+        valid.resize(n);
+    }
+};
+
+// SGP4 state of one object, m and m/s
+static bool sgp4_state(sgp4_record& record, double tsince_s, double* r, double* v) {
+    double rk[3], vk[3];
+    if (record.propagate(tsince_s / 60.0, rk, vk) != SGP4_OK)
+        return false;
+    for (int c = 0; c < 3; c++) {
+        r[c] = rk[c]*1000.0;
+        v[c] = vk[c]*1000.0;
+    }
+    return true;
+}
+
+// Newton iteration on d.w = 0 with SGP4 states, from the sieve's estimate.
+// Fails when it doesn't converge to a minimum inside [t_min, t_max].
+static bool refine_tca(sgp4_record record_i, sgp4_record record_j, double offset_i, double offset_j,
+                       double t, double t_min, double t_max, double* tca, double* miss, double* speed) {
+    t = t < t_min ? t_min : (t > t_max ? t_max : t);
+    double ri[3], vi[3], rj[3], vj[3];
+    for (int iter = 0; iter < 10; iter++) {
+        if (!sgp4_state(record_i, offset_i + t, ri, vi) || !sgp4_state(record_j, offset_j + t, rj, vj))
+            return false;
+
+        double d[3], w[3], da[3];
+        double ri_mag = sqrt(dot3(ri, ri));
+        double rj_mag = sqrt(dot3(rj, rj));
+        for (int c = 0; c < 3; c++) {
+            d[c] = rj[c] - ri[c];
+            w[c] = vj[c] - vi[c];
+            da[c] = -mu_earth*(rj[c] / (rj_mag*rj_mag*rj_mag) - ri[c] / (ri_mag*ri_mag*ri_mag));
+        }
+
+        double f = dot3(d, w);
+        double df = dot3(w, w) + dot3(d, da);
+        if (df <= 0.0)
+            return false; // heading for a maximum
+
+        double next = t - f / df;
+        if (next < t_min || next > t_max) {
+            next = next < t_min ? t_min : t_max;
+            if (next == t)
+                return false; // minimum is outside the window
+        }
+        if (fabs(next - t) < 1.0e-4) {
+            *tca = t;
+            *miss = sqrt(dot3(d, d));
+            *speed = sqrt(dot3(w, w));
+            return true;
+        }
+        t = next;
+    }
+    return false;
+}
+
+void conjunction_screening::run(const tle_catalog& catalog, const epoch& start, double duration) {
+    auto wall_start = std::chrono::steady_clock::now();
+
+    conjunctions.clear();
+    num_neighbours = num_after_apsides = num_after_distance = num_after_geometry = num_refined = 0;
+
+    const size_t n = catalog.size();
+    if (n < 2 || duration <= 0.0)
+        return;
+
+    // records are stepped forward through the run, keep our own copies
+    std::vector<sgp4_record> records = catalog.records;
+    std::vector<double> offset(n);
+    for (size_t k = 0; k < n; k++)
+        offset[k] = start - catalog.elements[k].element_epoch;
+
+    const uint32 num_substeps = (uint32)(sample_step / sieve_step + 0.5) > 0 ? (uint32)(sample_step / sieve_step + 0.5) : 1;
+    const double h = sample_step / num_substeps;
+    const uint32 num_intervals = (uint32)ceil(duration / sample_step);
+    const double filter_distance = screening_distance + perturbation_pad + interpolation_pad;
+
+    screening_states samples[2];
+    samples[0].resize(n);
+    samples[1].resize(n);
+    screening_states mid;
+    mid.resize(n);
+    std::vector<screening_orbit> orbits(n);
+
+    uint32 num_buckets = 1;
+    while (num_buckets < 2*n) num_buckets <<= 1;
+    const uint32 bucket_mask = num_buckets - 1;
+    std::vector<uint32> bucket_of(n);
+    std::vector<uint32> bucket_start(num_buckets + 1);
+    std::vector<uint32> sorted(n);
+    std::vector<screening_entry> entries(n);
+
+    const size_t num_object_chunks = (n + object_chunk_size - 1) / object_chunk_size;
+    std::vector<std::vector<screening_candidate>> chunk_candidates(num_object_chunks);
+    std::vector<screening_candidate> candidates;
+    std::vector<conjunction> found;
+    std::vector<std::vector<conjunction>> chunk_found;
+
+    std::atomic<uint64> count_neighbours{0}, count_apsides{0}, count_distance{0}, count_geometry{0};
+
+    auto sample = [&](screening_states& s, double t) {
+        parallel_for(n, object_chunk_size, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                double r[3], v[3];
+                s.valid[k] = sgp4_state(records[k], offset[k] + t, r, v);
+                for (int c = 0; c < 3; c++) {
+                    s.r[c][k] = r[c];
+                    s.v[c][k] = v[c];
+                }
+            }
+        });
+    };
+
+    sample(samples[0], 0.0);
+
+    for (uint32 interval = 0; interval < num_intervals; interval++) {
+        const double t_a = interval*sample_step;
+        screening_states& A = samples[interval & 1];
+        screening_states& B = samples[(interval + 1) & 1];
+        sample(B, t_a + sample_step);
+
+        // osculating orbits for the filters, and the fastest anything moves
+        std::vector<double> chunk_speed(num_object_chunks, 0.0);
+        std::vector<double> chunk_gravity(num_object_chunks, 0.0);
+        parallel_for(n, object_chunk_size, [&](size_t begin, size_t end) {
+            double max_speed = 0.0, max_gravity = 0.0;
+            for (size_t k = begin; k < end; k++) {
+                if (!A.valid[k] || !B.valid[k])
+                    continue;
+                double r[3] = { A.r[0][k], A.r[1][k], A.r[2][k] };
+                double v[3] = { A.v[0][k], A.v[1][k], A.v[2][k] };
+                osculating_orbit(r, v, &orbits[k]);
+                double perigee_speed = (1.0 + orbits[k].e)*sqrt(mu_earth / orbits[k].p);
+                max_speed = perigee_speed > max_speed ? perigee_speed : max_speed;
+                max_gravity = orbits[k].gravity_bound > max_gravity ? orbits[k].gravity_bound : max_gravity;
+            }
+            chunk_speed[begin / object_chunk_size] = max_speed;
+            chunk_gravity[begin / object_chunk_size] = max_gravity;
+        });
+        double v_max = 1.01 * *std::max_element(chunk_speed.begin(), chunk_speed.end());
+        double a_max = *std::max_element(chunk_gravity.begin(), chunk_gravity.end());
+
+        // pairs that can get within the screening distance during a sieve step
+        // are within 'reach' of each other at its midpoint
+        const double reach = screening_distance + interpolation_pad + 2.0*v_max*(0.5*h) + 2.0*a_max*(0.125*h*h);
+        const double cell_size = 2.0*reach;
+
+        for (uint32 sub = 0; sub < num_substeps; sub++) {
+            const double t_mid = t_a + (sub + 0.5)*h;
+            const double s = (sub + 0.5) / num_substeps;
+
+            // Hermite interpolation to the midpoint, and hash cells
+            const double h00 = 2.0*s*s*s - 3.0*s*s + 1.0, h10 = (s*s*s - 2.0*s*s + s)*sample_step;
+            const double h01 = -2.0*s*s*s + 3.0*s*s,      h11 = (s*s*s - s*s)*sample_step;
+            const double d00 = (6.0*s*s - 6.0*s) / sample_step, d10 = 3.0*s*s - 4.0*s + 1.0;
+            const double d01 = (-6.0*s*s + 6.0*s) / sample_step, d11 = 3.0*s*s - 2.0*s;
+            parallel_for(n, object_chunk_size, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++) {
+                    mid.valid[k] = A.valid[k] && B.valid[k];
+                    for (int c = 0; c < 3; c++) {
+                        double r = h00*A.r[c][k] + h10*A.v[c][k] + h01*B.r[c][k] + h11*B.v[c][k];
+                        mid.r[c][k] = r;
+                        mid.v[c][k] = d00*A.r[c][k] + d10*A.v[c][k] + d01*B.r[c][k] + d11*B.v[c][k];
+                    }
+                    bucket_of[k] = hash_cell((int32)floor(mid.r[0][k] / cell_size), (int32)floor(mid.r[1][k] / cell_size),
+                                             (int32)floor(mid.r[2][k] / cell_size), bucket_mask);
+                }
+            });
+
+            // counting sort into buckets
+            std::fill(bucket_start.begin(), bucket_start.end(), 0);
+            for (size_t k = 0; k < n; k++) {
+                if (mid.valid[k])
+                    bucket_start[bucket_of[k] + 1]++;
+            }
+            for (uint32 b = 0; b < num_buckets; b++)
+                bucket_start[b + 1] += bucket_start[b];
+            for (size_t k = 0; k < n; k++) {
+                if (mid.valid[k])
+                    sorted[bucket_start[bucket_of[k]]++] = (uint32)k;
+            }
+            // the starts were used as write cursors and now hold the ends
+            for (uint32 b = num_buckets; b > 0; b--)
+                bucket_start[b] = bucket_start[b - 1];
+            bucket_start[0] = 0;
+            const size_t num_valid = bucket_start[num_buckets];
+
+            parallel_for(num_valid, object_chunk_size, [&](size_t begin, size_t end) {
+                for (size_t pos = begin; pos < end; pos++) {
+                    uint32 k = sorted[pos];
+                    screening_entry& e = entries[pos];
+                    e.near_upper = 0;
+                    for (int c = 0; c < 3; c++) {
+                        e.r[c] = mid.r[c][k];
+                        e.v[c] = mid.v[c][k];
+                        double f = e.r[c] / cell_size;
+                        double fl = floor(f);
+                        e.cell[c] = (int32)fl;
+                        e.near_upper |= ((f - fl) >= 0.5) ? (1u << c) : 0u;
+                    }
+                    e.perigee = orbits[k].perigee;
+                    e.apogee = orbits[k].apogee;
+                    e.gravity_bound = orbits[k].gravity_bound;
+                    e.index = k;
+                }
+            });
+
+            // neighbour queries. With cells twice the reach, everything within
+            // reach is in the object's cell or the adjacent one on the near side
+            // of each axis: 8 cells.
+            // pairs are taken once, from the entry that comes first in bucket order
+            parallel_for(num_valid, object_chunk_size, [&](size_t begin, size_t end) {
+                std::vector<screening_candidate>& out = chunk_candidates[begin / object_chunk_size];
+                out.clear();
+                uint64 neighbours = 0, apsides = 0, distance = 0, geometry = 0;
+
+                for (size_t p = begin; p < end; p++) {
+                    const screening_entry& ei = entries[p];
+
+                    uint32 buckets[8];
+                    uint32 num_cells = 0;
+                    for (int corner = 0; corner < 8; corner++) {
+                        int32 xyz[3];
+                        for (int c = 0; c < 3; c++) {
+                            int32 step = (ei.near_upper & (1u << c)) ? 1 : -1;
+                            xyz[c] = ei.cell[c] + ((corner & (1 << c)) ? step : 0);
+                        }
+                        uint32 b = hash_cell(xyz[0], xyz[1], xyz[2], bucket_mask);
+                        bool seen = false;
+                        for (uint32 m = 0; m < num_cells; m++) seen |= (buckets[m] == b);
+                        if (!seen) buckets[num_cells++] = b;
+                    }
+
+                    for (uint32 m = 0; m < num_cells; m++) {
+                        uint32 first = bucket_start[buckets[m]];
+                        uint32 last = bucket_start[buckets[m] + 1];
+                        for (uint32 q = first > p + 1 ? first : (uint32)p + 1; q < last; q++) {
+                            const screening_entry& ej = entries[q];
+                            neighbours++;
+
+                            // apogee/perigee
+                            if (ei.perigee > ej.apogee + filter_distance || ej.perigee > ei.apogee + filter_distance)
+                                continue;
+                            apsides++;
+
+                            // distance: how far can the gap close in half a step
+                            double d[3], w[3];
+                            for (int c = 0; c < 3; c++) {
+                                d[c] = ej.r[c] - ei.r[c];
+                                w[c] = ej.v[c] - ei.v[c];
+                            }
+                            double dd = dot3(d, d);
+                            double ww = dot3(w, w);
+                            double rel_accel = ei.gravity_bound + ej.gravity_bound;
+                            double closing = screening_distance + interpolation_pad + sqrt(ww)*0.5*h + rel_accel*0.125*h*h;
+                            if (dd > closing*closing)
+                                continue;
+                            distance++;
+
+                            // orbit geometry
+                            if (!orbits_can_meet(orbits[ei.index], orbits[ej.index], filter_distance))
+                                continue;
+                            geometry++;
+
+                            // time: linear relative motion over the step, plus the gravity bound
+                            double tau = ww > 0.0 ? -dot3(d, w) / ww : 0.0;
+                            tau = tau < -0.5*h ? -0.5*h : (tau > 0.5*h ? 0.5*h : tau);
+                            double miss[3] = { d[0] + w[0]*tau, d[1] + w[1]*tau, d[2] + w[2]*tau };
+                            double bound = screening_distance + interpolation_pad + 0.5*rel_accel*0.25*h*h;
+                            if (dot3(miss, miss) > bound*bound)
+                                continue;
+
+                            uint32 i = ei.index < ej.index ? ei.index : ej.index;
+                            uint32 j = ei.index < ej.index ? ej.index : ei.index;
+                            out.push_back({ i, j, t_mid + tau });
+                        }
+                    }
+                }
+
+                count_neighbours += neighbours;
+                count_apsides += apsides;
+                count_distance += distance;
+                count_geometry += geometry;
+            });
+
+            candidates.clear();
+            for (const auto& chunk : chunk_candidates)
+                candidates.insert(candidates.end(), chunk.begin(), chunk.end());
+            if (candidates.empty())
+                continue;
+            num_refined += candidates.size();
+
+            // TCA refinement with SGP4
+            chunk_found.resize((candidates.size() + candidate_chunk_size - 1) / candidate_chunk_size);
+            parallel_for(candidates.size(), candidate_chunk_size, [&](size_t begin, size_t end) {
+                std::vector<conjunction>& out = chunk_found[begin / candidate_chunk_size];
+                out.clear();
+                for (size_t c = begin; c < end; c++) {
+                    const screening_candidate& cand = candidates[c];
+                    double tca, miss, speed;
+                    if (!refine_tca(records[cand.i], records[cand.j], offset[cand.i], offset[cand.j], cand.t,
+                                    0.0, duration, &tca, &miss, &speed))
+                        continue;
+                    if (miss > screening_distance)
+                        continue;
+                    out.push_back({ cand.i, cand.j, start + tca, miss, speed });
+                }
+            });
+            for (const auto& chunk : chunk_found)
+                found.insert(found.end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    num_neighbours = count_neighbours;
+    num_after_apsides = count_apsides;
+    num_after_distance = count_distance;
+    num_after_geometry = count_geometry;
+
+    // the same approach is usually caught from neighbouring sieve steps,
+    // keep one per pair per pass
+    std::sort(found.begin(), found.end(), [](const conjunction& a, const conjunction& b) {
+        if (a.primary != b.primary) return a.primary < b.primary;
+        if (a.secondary != b.secondary) return a.secondary < b.secondary;
+        return (a.tca - b.tca) < 0.0;
+    });
+    const double same_pass = 60.0 > 2.0*sieve_step ? 60.0 : 2.0*sieve_step;
+    for (const conjunction& c : found) {
+        if (!conjunctions.empty()) {
+            conjunction& last = conjunctions.back();
+            if (last.primary == c.primary && last.secondary == c.secondary && fabs(c.tca - last.tca) < same_pass) {
+                if (c.miss_distance < last.miss_distance)
+                    last = c;
+                continue;
+            }
+        }
+        conjunctions.push_back(c);
+    }
+    std::sort(conjunctions.begin(), conjunctions.end(), [](const conjunction& a, const conjunction& b) {
+        return (a.tca - b.tca) < 0.0;
+    });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    spdlog::info("Screened {0} objects over {1:.1f} days in {2:.1f} s: {3} conjunctions within {4:.1f} km",
+                 n, duration / 86400.0, elapsed, conjunctions.size(), screening_distance / 1000.0);
+    spdlog::info("  pairs: {0} neighbours, {1} after apsides, {2} after distance, {3} after geometry, {4} refined",
+                 num_neighbours, num_after_apsides, num_after_distance, num_after_geometry, num_refined);
+}
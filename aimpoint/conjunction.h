@@ -0,0 +1,44 @@
+#pragma once
+#include "defines.h"
+
+#include "tle_catalog.h"
+
+#include <vector>
+
+struct conjunction {
+    uint32 primary;   // catalog indices, primary < secondary
+    uint32 secondary;
+    epoch tca;
+    double miss_distance;  // m
+    double relative_speed; // m/s
+};
+
+// All-vs-all close approach screening of an SGP4 catalog.
+//
+// SGP4 is sampled every sample_step and treated as cubic Hermite dense
+// output in between. Every sieve_step a uniform spatial hash is rebuilt
+// from the interpolated positions and each object is checked against its
+// neighbours. Pairs then go through, cheapest first:
+//   - apogee/perigee: radial shells that never come within reach
+//   - distance: can't close the gap within half a sieve step
+//   - orbit geometry: the orbits don't come close near their mutual nodes
+//   - time: linear relative motion plus a gravity bound misses
+// Survivors get their time of closest approach refined with SGP4 itself.
+// Sampling, hashing, queries and refinement all run on parallel_for.
+struct conjunction_screening {
+    double screening_distance = 10000.0; // m
+    double sample_step = 120.0;          // s between SGP4 samples
+    double sieve_step = 10.0;            // s between spatial hash rebuilds
+
+    // screens every pair over [start, start + duration]
+    void run(const tle_catalog& catalog, const epoch& start, double duration);
+
+    std::vector<conjunction> conjunctions; // sorted by TCA
+
+    // pairs that reached each stage in the last run
+    uint64 num_neighbours = 0;
+    uint64 num_after_apsides = 0;
+    uint64 num_after_distance = 0;
+    uint64 num_after_geometry = 0;
+    uint64 num_refined = 0;
+};
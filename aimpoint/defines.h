@@ -64,4 +64,10 @@ struct plot_signal {
 // Disable by default
 #ifndef USE_DTV
 #define USE_DTV 0
+#endif
+
+// Frames between reading back a recorded frame and handing it to the
+// encoder. More hides slower GPUs, at the cost of a buffer per frame.
+#ifndef DTV_CAPTURE_LATENCY
+#define DTV_CAPTURE_LATENCY 2
 #endif
\ No newline at end of file
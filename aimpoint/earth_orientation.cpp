@@ -0,0 +1,325 @@
+#include "earth_orientation.h"
+
+#include "log.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const double two_pi = 6.283185307179586476925287;
+static const double arcsec_to_rad = 4.848136811095359935899141e-6;
+
+struct nutation_term {
+    int8 l, lp, f, d, om;   // multipliers of the Delaunay arguments
+    double ps, pst, pc;     // dpsi: (ps + pst*t)*sin + pc*cos, 0.1 uas
+    double ec, ect, es;     // deps: (ec + ect*t)*cos + es*sin, 0.1 uas
+};
+
+// IAU 2000B (McCarthy & Luzum 2003), the 20 largest of its 77 lunisolar terms
+static const nutation_term nutation_terms[] = {
+    { 0, 0, 0, 0, 1, -172064161.0, -174666.0,  33386.0, 92052331.0,  9086.0, 15377.0 },
+    { 0, 0, 2,-2, 2,  -13170906.0,   -1675.0, -13696.0,  5730336.0, -3015.0, -4587.0 },
+    { 0, 0, 2, 0, 2,   -2276413.0,    -234.0,   2796.0,   978459.0,  -485.0,  1374.0 },
+    { 0, 0, 0, 0, 2,    2074554.0,     207.0,   -698.0,  -897492.0,   470.0,  -291.0 },
+    { 0, 1, 0, 0, 0,    1475877.0,   -3633.0,  11817.0,    73871.0,  -184.0, -1924.0 },
+    { 0, 1, 2,-2, 2,    -516821.0,    1226.0,   -524.0,   224386.0,  -677.0,  -174.0 },
+    { 1, 0, 0, 0, 0,     711159.0,      73.0,   -872.0,    -6750.0,     0.0,   358.0 },
+    { 0, 0, 2, 0, 1,    -387298.0,    -367.0,    380.0,   200728.0,    18.0,   318.0 },
+    { 1, 0, 2, 0, 2,    -301461.0,     -36.0,    816.0,   129025.0,   -63.0,   367.0 },
+    { 0,-1, 2,-2, 2,     215829.0,    -494.0,    111.0,   -95929.0,   299.0,   132.0 },
+    { 0, 0, 2,-2, 1,     128227.0,     137.0,    181.0,   -68982.0,    -9.0,    39.0 },
+    {-1, 0, 2, 0, 2,     123457.0,      11.0,     19.0,   -53311.0,    32.0,    -4.0 },
+    {-1, 0, 0, 2, 0,     156994.0,      10.0,   -168.0,    -1235.0,     0.0,    82.0 },
+    { 1, 0, 0, 0, 1,      63110.0,      63.0,     27.0,   -33228.0,     0.0,    -9.0 },
+    {-1, 0, 0, 0, 1,     -57976.0,     -63.0,   -189.0,    31429.0,     0.0,   -75.0 },
+    {-1, 0, 2, 2, 2,     -59641.0,     -11.0,    149.0,    25543.0,   -11.0,    66.0 },
+    { 1, 0, 2, 0, 1,     -51613.0,     -42.0,    129.0,    26366.0,     0.0,    78.0 },
+    {-2, 0, 2, 0, 1,      45893.0,      50.0,     31.0,   -24236.0,   -10.0,    20.0 },
+    { 0, 0, 0, 2, 0,      63384.0,      11.0,   -150.0,    -1220.0,     0.0,    29.0 },
+    { 0, 0, 2, 2, 2,     -38571.0,      -1.0,    158.0,    16452.0,   -11.0,    68.0 },
+};
+
+// rotation matrices about x and z (frame rotations, as in the IERS conventions)
+static void rot_x(double angle, double m[3][3]) {
+    double c = cos(angle), s = sin(angle);
+    m[0][0] = 1; m[0][1] = 0;  m[0][2] = 0;
+    m[1][0] = 0; m[1][1] = c;  m[1][2] = s;
+    m[2][0] = 0; m[2][1] = -s; m[2][2] = c;
+}
+static void rot_y(double angle, double m[3][3]) {
+    double c = cos(angle), s = sin(angle);
+    m[0][0] = c; m[0][1] = 0; m[0][2] = -s;
+    m[1][0] = 0; m[1][1] = 1; m[1][2] = 0;
+    m[2][0] = s; m[2][1] = 0; m[2][2] = c;
+}
+static void rot_z(double angle, double m[3][3]) {
+    double c = cos(angle), s = sin(angle);
+    m[0][0] = c;  m[0][1] = s; m[0][2] = 0;
+    m[1][0] = -s; m[1][1] = c; m[1][2] = 0;
+    m[2][0] = 0;  m[2][1] = 0; m[2][2] = 1;
+}
+static void mat_mul(const double a[3][3], const double b[3][3], double out[3][3]) {
+    double tmp[3][3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            tmp[r][c] = a[r][0]*b[0][c] + a[r][1]*b[1][c] + a[r][2]*b[2][c];
+        }
+    }
+    memcpy(out, tmp, sizeof(tmp));
+}
+
+void earth_orientation::nutation(double jd_tt, double* dpsi, double* deps) {
+    double t = (jd_tt - 2451545.0) / 36525.0;
+
+    // Delaunay arguments (Simon et al. 1994), linear terms only as in 2000B
+    double el  = fmod(485868.249036  + 1717915923.2178*t, 1296000.0) * arcsec_to_rad;
+    double elp = fmod(1287104.79305  +  129596581.0481*t, 1296000.0) * arcsec_to_rad;
+    double f   = fmod(335779.526232  + 1739527262.8478*t, 1296000.0) * arcsec_to_rad;
+    double d   = fmod(1072260.70369  + 1602961601.2090*t, 1296000.0) * arcsec_to_rad;
+    double om  = fmod(450160.398036  -    6962890.5431*t, 1296000.0) * arcsec_to_rad;
+
+    double sum_psi = 0.0, sum_eps = 0.0;
+    const size_t num_terms = sizeof(nutation_terms) / sizeof(nutation_terms[0]);
+    for (size_t n = num_terms; n > 0; n--) { // smallest first
+        const nutation_term& term = nutation_terms[n - 1];
+        double arg = term.l*el + term.lp*elp + term.f*f + term.d*d + term.om*om;
+        double s = sin(arg), c = cos(arg);
+        sum_psi += (term.ps + term.pst*t)*s + term.pc*c;
+        sum_eps += (term.ec + term.ect*t)*c + term.es*s;
+    }
+
+    // 0.1 uas -> rad, plus the fixed offset standing in for the planetary terms
+    const double scale = 1.0e-7 * arcsec_to_rad;
+    *dpsi = sum_psi*scale - 0.135e-3*arcsec_to_rad;
+    *deps = sum_eps*scale + 0.388e-3*arcsec_to_rad;
+}
+
+double earth_orientation::earth_rotation_angle(double du) {
+    // IERS 2010 eq. 5.15, with the whole days split off for precision
+    double whole = floor(du);
+    double frac = du - whole;
+    double era = two_pi * (frac + 0.7790572732640 + 0.00273781191135448*du);
+    era = fmod(era, two_pi);
+    return era < 0.0 ? era + two_pi : era;
+}
+
+void earth_orientation::precession_nutation(double jd_tt, double np[3][3], double* gast_minus_era) {
+    double t = (jd_tt - 2451545.0) / 36525.0;
+
+    // IAU 2006 precession angles (Capitaine et al. 2003), arcsec
+    double zeta  = ( 2.650545 + (2306.083227 + (0.2988499 + (0.01801828 + (-0.000005971 - 0.0000003173*t)*t)*t)*t)*t) * arcsec_to_rad;
+    double z     = (-2.650545 + (2306.077181 + (1.0927348 + (0.01826837 + (-0.000028596 - 0.0000002904*t)*t)*t)*t)*t) * arcsec_to_rad;
+    double theta = ((2004.191903 + (-0.4294934 + (-0.04182264 + (-0.000007089 - 0.0000001274*t)*t)*t)*t)*t) * arcsec_to_rad;
+
+    // IAU 2006 mean obliquity
+    double eps_a = (84381.406 + (-46.836769 + (-0.0001831 + (0.00200340 + (-0.000000576 - 0.0000000434*t)*t)*t)*t)*t) * arcsec_to_rad;
+
+    double dpsi, deps;
+    nutation(jd_tt, &dpsi, &deps);
+
+    // P = R3(-z) R2(theta) R3(-zeta)
+    double p[3][3], tmp[3][3];
+    rot_z(-zeta, p);
+    rot_y(theta, tmp);  mat_mul(tmp, p, p);
+    rot_z(-z, tmp);     mat_mul(tmp, p, p);
+
+    // N = R1(-(eps_a + deps)) R3(-dpsi) R1(eps_a)
+    double n[3][3];
+    rot_x(eps_a, n);
+    rot_z(-dpsi, tmp);          mat_mul(tmp, n, n);
+    rot_x(-(eps_a + deps), tmp); mat_mul(tmp, n, n);
+
+    mat_mul(n, p, np);
+
+    // GMST (IAU 2006) - ERA, plus the equation of the equinoxes with its two
+    // largest complementary terms
+    double om = fmod(450160.398036 - 6962890.5431*t, 1296000.0) * arcsec_to_rad;
+    double gmst_minus_era = (0.014506 + (4612.156534 + (1.3915817 + (-0.00000044 + (-0.000029956 - 0.0000000368*t)*t)*t)*t)*t) * arcsec_to_rad;
+    double eq_equinoxes = dpsi*cos(eps_a) + (0.00264096*sin(om) + 0.00006352*sin(2.0*om)) * arcsec_to_rad;
+    *gast_minus_era = gmst_minus_era + eq_equinoxes;
+}
+
+void earth_orientation::init(const epoch& new_start, double span_days, const eop_table* new_eop) {
+    start = new_start;
+    epoch_jd = start.to_jd(TIME_SCALE_TT);
+    eop = new_eop;
+
+    num_nodes = (uint32)ceil(span_days / table_step) + 1;
+    values.resize((size_t)num_nodes * num_values);
+    derivatives.resize((size_t)num_nodes * num_values);
+
+    // derivatives by central difference, small enough that the ~7 day
+    // nutation terms are resolved to well below the series truncation
+    const double h = 0.01; // days
+    for (uint32 k = 0; k < num_nodes; k++) {
+        double jd = epoch_jd + k*table_step;
+
+        double np[3][3], np_lo[3][3], np_hi[3][3];
+        double g, g_lo, g_hi;
+        precession_nutation(jd, np, &g);
+        precession_nutation(jd - h, np_lo, &g_lo);
+        precession_nutation(jd + h, np_hi, &g_hi);
+
+        double* v = &values[(size_t)k * num_values];
+        double* dv = &derivatives[(size_t)k * num_values];
+        for (int i = 0; i < 9; i++) {
+            v[i] = np[i / 3][i % 3];
+            dv[i] = (np_hi[i / 3][i % 3] - np_lo[i / 3][i % 3]) / (2.0*h);
+        }
+        v[9] = g;
+        dv[9] = (g_hi - g_lo) / (2.0*h);
+    }
+
+    spdlog::info("Earth orientation tabulated: {0} nodes over {1:.0f} days{2}", num_nodes, span_days,
+                 (eop && !eop->entries.empty()) ? ", with EOP" : "");
+}
+
+void earth_orientation::interpolate(double t, double np[3][3], double* gast_minus_era) const {
+    double x = t / (86400.0 * table_step);
+    if (num_nodes < 2 || x < 0.0 || x >= (double)(num_nodes - 1)) {
+        precession_nutation(epoch_jd + t/86400.0, np, gast_minus_era);
+        return;
+    }
+
+    uint32 k = (uint32)x;
+    double u = x - k;
+
+    // cubic Hermite basis, derivatives scaled from per-day to per-interval
+    double u2 = u*u, u3 = u2*u;
+    double h00 = 2*u3 - 3*u2 + 1;
+    double h10 = (u3 - 2*u2 + u) * table_step;
+    double h01 = -2*u3 + 3*u2;
+    double h11 = (u3 - u2) * table_step;
+
+    const double* v0 = &values[(size_t)k * num_values];
+    const double* v1 = v0 + num_values;
+    const double* d0 = &derivatives[(size_t)k * num_values];
+    const double* d1 = d0 + num_values;
+
+    double out[num_values];
+    for (uint32 i = 0; i < num_values; i++) {
+        out[i] = h00*v0[i] + h10*d0[i] + h01*v1[i] + h11*d1[i];
+    }
+
+    for (int i = 0; i < 9; i++) {
+        np[i / 3][i % 3] = out[i];
+    }
+    *gast_minus_era = out[9];
+}
+
+mat3d earth_orientation::inertial_to_fixed(double t) const {
+    return inertial_to_fixed(start + t);
+}
+
+mat3d earth_orientation::inertial_to_fixed(const epoch& when) const {
+    double np[3][3], gast_minus_era;
+    interpolate(when - start, np, &gast_minus_era);
+
+    // UT1 from the two-part UTC date, so the rotation angle keeps full precision
+    double utc_whole, utc_frac;
+    when.to_jd(TIME_SCALE_UTC, &utc_whole, &utc_frac);
+    double x_pole = 0.0, y_pole = 0.0, ut1_utc = 0.0;
+    if (eop) {
+        eop->get((utc_whole - 2400000.5) + utc_frac, &x_pole, &y_pole, &ut1_utc);
+    }
+    double du = (utc_whole - 2451545.0) + (utc_frac + ut1_utc/86400.0);
+    double gast = earth_rotation_angle(du) + gast_minus_era;
+
+    double m[3][3], r[3][3];
+    rot_z(gast, r);
+    mat_mul(r, np, m);
+
+    // polar motion, first order in the (sub-arcsecond) pole offsets
+    double xp = x_pole*arcsec_to_rad;
+    double yp = y_pole*arcsec_to_rad;
+    double w[3][3] = {
+        {  1.0, 0.0,  xp },
+        {  0.0, 1.0, -yp },
+        {  -xp,  yp, 1.0 },
+    };
+    mat_mul(w, m, m);
+
+    // column-major
+    return mat3d(m[0][0], m[1][0], m[2][0],
+                 m[0][1], m[1][1], m[2][1],
+                 m[0][2], m[1][2], m[2][2]);
+}
+
+bool eop_table::load_finals(const char* filename) {
+    FILE* fid = fopen(filename, "r");
+    if (fid == nullptr) {
+        spdlog::warn("Could not open EOP file '{0}'", filename);
+        return false;
+    }
+
+    entries.clear();
+
+    // columns (1-based): MJD 8-15, PM-x 19-27, PM-y 38-46, UT1-UTC 59-68
+    char line[256];
+    char field[16];
+    auto read_field = [&](const char* src, size_t len, size_t start, size_t end, double* out) -> bool {
+        if (len < end)
+            return false;
+        memcpy(field, src + start, end - start);
+        field[end - start] = 0;
+        char* endptr;
+        *out = strtod(field, &endptr);
+        return endptr != field;
+    };
+
+    while (fgets(line, sizeof(line), fid)) {
+        size_t len = strlen(line);
+        eop_entry entry;
+        if (!read_field(line, len, 7, 15, &entry.mjd))
+            continue;
+        // predictions run out before the end of the file
+        if (!read_field(line, len, 18, 27, &entry.x_pole) ||
+            !read_field(line, len, 37, 46, &entry.y_pole) ||
+            !read_field(line, len, 58, 68, &entry.ut1_utc))
+            break;
+        entries.push_back(entry);
+    }
+    fclose(fid);
+
+    if (entries.empty()) {
+        spdlog::error("No EOP entries found in '{0}'", filename);
+        return false;
+    }
+
+    spdlog::info("Loaded {0} EOP entries, MJD {1:.0f} to {2:.0f}", entries.size(),
+                 entries.front().mjd, entries.back().mjd);
+    return true;
+}
+
+void eop_table::get(double mjd_utc, double* x_pole, double* y_pole, double* ut1_utc) const {
+    if (entries.empty()) {
+        *x_pole = *y_pole = *ut1_utc = 0.0;
+        return;
+    }
+
+    // daily entries, so index directly
+    double x = mjd_utc - entries.front().mjd;
+    if (x <= 0.0) {
+        *x_pole = entries.front().x_pole; *y_pole = entries.front().y_pole; *ut1_utc = entries.front().ut1_utc;
+        return;
+    }
+    size_t k = (size_t)x;
+    if (k + 1 >= entries.size()) {
+        *x_pole = entries.back().x_pole; *y_pole = entries.back().y_pole; *ut1_utc = entries.back().ut1_utc;
+        return;
+    }
+
+    const eop_entry& a = entries[k];
+    const eop_entry& b = entries[k + 1];
+    double f = (mjd_utc - a.mjd) / (b.mjd - a.mjd);
+
+    // don't interpolate across a leap second
+    double dut = b.ut1_utc - a.ut1_utc;
+    if (dut > 0.5) dut -= 1.0;
+    if (dut < -0.5) dut += 1.0;
+
+    *x_pole = a.x_pole + f*(b.x_pole - a.x_pole);
+    *y_pole = a.y_pole + f*(b.y_pole - a.y_pole);
+    *ut1_utc = a.ut1_utc + f*dut;
+}
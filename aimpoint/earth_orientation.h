@@ -0,0 +1,60 @@
+#pragma once
+#include "defines.h"
+
+#include "epoch.h"
+
+#include <vector>
+
+// One day of IERS Earth orientation parameters
+struct eop_entry {
+    double mjd;     // UTC
+    double x_pole;  // arcsec
+    double y_pole;  // arcsec
+    double ut1_utc; // s
+};
+
+struct eop_table {
+    // IERS finals2000A.all / finals.data (fixed-width, rapid service values)
+    bool load_finals(const char* filename);
+
+    // linear interpolation, clamped to the ends. Zeros if no table is loaded.
+    void get(double mjd_utc, double* x_pole, double* y_pole, double* ut1_utc) const;
+
+    std::vector<eop_entry> entries;
+};
+
+// Inertial (GCRS, frame bias ignored) to Earth-fixed (ITRS) rotation.
+// Equinox based: IAU 2006 precession, IAU 2000B nutation truncated to its
+// 20 largest terms (~1 mas), GAST from the Earth rotation angle, and polar
+// motion/UT1 from an optional EOP table.
+//
+// Precession-nutation and the GAST-ERA offset only change over days, so they
+// are tabulated at startup and evaluated with cubic Hermite interpolation.
+// Per step that leaves ten interpolants, one sin/cos for the Earth rotation
+// angle, and a couple of 3x3 products.
+struct earth_orientation {
+    void init(const epoch& start, double span_days = 366.0, const eop_table* eop = nullptr);
+
+    // t is sim time [s] since the start epoch
+    mat3d inertial_to_fixed(double t) const;
+    mat3d inertial_to_fixed(const epoch& when) const;
+
+    // full series evaluation, rows of the precession-nutation matrix (mean J2000 ->
+    // true of date) and GAST - ERA [rad]. Used to build the table and outside its span.
+    static void precession_nutation(double jd_tt, double np[3][3], double* gast_minus_era);
+    static void nutation(double jd_tt, double* dpsi, double* deps); // IAU 2000B, rad
+    static double earth_rotation_angle(double jd_ut1_minus_j2000);   // rad
+
+private:
+    void interpolate(double t, double np[3][3], double* gast_minus_era) const;
+
+    epoch start;
+    double epoch_jd = 2451545.0; // TT
+    const eop_table* eop = nullptr;
+
+    static const uint32 num_values = 10;      // 9 matrix elements + GAST-ERA
+    static constexpr double table_step = 0.25; // days
+    uint32 num_nodes = 0;
+    std::vector<double> values;      // [node][value]
+    std::vector<double> derivatives; // per day
+};
@@ -0,0 +1,142 @@
+#include "ephemeris.h"
+
+#include "log.h"
+
+// obliquity of the ecliptic at J2000
+static const double obliquity_j2000 = 23.43929111; // deg
+static const double arcsec = 1.0 / 3600.0;        // deg
+
+static vec3d ecliptic_to_equatorial(double lambda, double beta, double r) {
+    double cb = laml::cosd(beta);
+    double x = r*cb*laml::cosd(lambda);
+    double y = r*cb*laml::sind(lambda);
+    double z = r*laml::sind(beta);
+
+    double ce = laml::cosd(obliquity_j2000);
+    double se = laml::sind(obliquity_j2000);
+    return vec3d(x, ce*y - se*z, se*y + ce*z);
+}
+
+ephemeris::ephemeris() : num_evaluations(0), cache_next(0) {
+    set_epoch(2451545.0);
+}
+
+void ephemeris::set_epoch(const epoch& start) {
+    set_epoch(start.to_jd(TIME_SCALE_TT));
+    start.to_jd(TIME_SCALE_TDB, &epoch_tdb_whole, &epoch_tdb_frac);
+}
+
+void ephemeris::set_epoch(double jd_tt) {
+    epoch_jd = jd_tt;
+    epoch_tdb_whole = jd_tt;
+    epoch_tdb_frac = 0.0;
+
+    // cached positions are relative to the old epoch
+    for (uint32 n = 0; n < cache_size; n++) {
+        cache[n].valid = false;
+    }
+}
+
+const ephemeris_state& ephemeris::at(double t) {
+    for (uint32 n = 0; n < cache_size; n++) {
+        if (cache[n].valid && cache[n].t == t)
+            return cache[n];
+    }
+
+    // miss: evaluate and overwrite the oldest entry
+    ephemeris_state& entry = cache[cache_next];
+    cache_next = (cache_next + 1) % cache_size;
+
+    entry.t = t;
+    entry.valid = true;
+    num_evaluations++;
+
+    // TDB-TT varies by < 2ms over the run, well below what matters for the perturbation
+    if (de_file && de_file->is_open()) {
+        double frac = epoch_tdb_frac + t / 86400.0;
+        bool ok = de_file->state(DE_SUN,  DE_EARTH, epoch_tdb_whole, frac, &entry.sun_position)
+               && de_file->state(DE_MOON, DE_EARTH, epoch_tdb_whole, frac, &entry.moon_position);
+        if (ok)
+            return entry;
+
+        if (!warned_out_of_span) {
+            spdlog::warn("t = {0:.1f} s is outside the DE{1} span, using analytic Sun/Moon positions",
+                         t, de_file->get_version());
+            warned_out_of_span = true;
+        }
+    }
+
+    double jd = epoch_jd + t / 86400.0;
+    entry.sun_position = sun_position(jd);
+    entry.moon_position = moon_position(jd);
+
+    return entry;
+}
+
+vec3d ephemeris::third_body_accel(vec3d pos_inertial, double t) {
+    const ephemeris_state& bodies = at(t);
+
+    vec3d accel(0.0, 0.0, 0.0);
+    if (enable_sun)
+        accel = accel + ::third_body_accel(pos_inertial, bodies.sun_position, gm_sun);
+    if (enable_moon)
+        accel = accel + ::third_body_accel(pos_inertial, bodies.moon_position, gm_moon);
+    return accel;
+}
+
+vec3d ephemeris::sun_position(double jd_tt) {
+    double T = (jd_tt - 2451545.0) / 36525.0;
+
+    double M = 357.5256 + 35999.049*T; // mean anomaly, deg
+    double lambda = 282.9400 + M + 6892.0*arcsec*laml::sind(M) + 72.0*arcsec*laml::sind(2.0*M);
+    double r = (149.619 - 2.499*laml::cosd(M) - 0.021*laml::cosd(2.0*M)) * 1.0e9; // m
+
+    return ecliptic_to_equatorial(lambda, 0.0, r);
+}
+
+vec3d ephemeris::moon_position(double jd_tt) {
+    double T = (jd_tt - 2451545.0) / 36525.0;
+
+    // fundamental arguments, deg
+    double L0 = 218.31617 + 481267.88088*T - 1.3972*T; // mean longitude (J2000 equinox)
+    double l  = 134.96292 + 477198.86753*T;             // Moon mean anomaly
+    double lp = 357.52543 +  35999.04944*T;             // Sun mean anomaly
+    double F  =  93.27283 + 483202.01873*T;             // mean arg. of latitude
+    double D  = 297.85027 + 445267.11135*T;             // mean elongation
+
+    double lambda = L0 + arcsec*(
+          22640.0*laml::sind(l)         + 769.0*laml::sind(2.0*l)
+        -  4586.0*laml::sind(l - 2.0*D) + 2370.0*laml::sind(2.0*D)
+        -   668.0*laml::sind(lp)        - 412.0*laml::sind(2.0*F)
+        -   212.0*laml::sind(2.0*l - 2.0*D) - 206.0*laml::sind(l + lp - 2.0*D)
+        +   192.0*laml::sind(l + 2.0*D) - 165.0*laml::sind(lp - 2.0*D)
+        +   148.0*laml::sind(l - lp)    - 125.0*laml::sind(D)
+        -   110.0*laml::sind(l + lp)    -  55.0*laml::sind(2.0*F - 2.0*D));
+
+    double beta = arcsec*(
+          18520.0*laml::sind(F + lambda - L0 + arcsec*(412.0*laml::sind(2.0*F) + 541.0*laml::sind(lp)))
+        -   526.0*laml::sind(F - 2.0*D)      + 44.0*laml::sind(l + F - 2.0*D)
+        -    31.0*laml::sind(-l + F - 2.0*D) - 25.0*laml::sind(-2.0*l + F)
+        -    23.0*laml::sind(lp + F - 2.0*D) + 21.0*laml::sind(-l + F)
+        +    11.0*laml::sind(-lp + F - 2.0*D));
+
+    double r = (385000.0
+        - 20905.0*laml::cosd(l)         - 3699.0*laml::cosd(2.0*D - l)
+        -  2956.0*laml::cosd(2.0*D)     -  570.0*laml::cosd(2.0*l)
+        +   246.0*laml::cosd(2.0*l - 2.0*D) - 205.0*laml::cosd(lp - 2.0*D)
+        -   171.0*laml::cosd(l + 2.0*D) -  152.0*laml::cosd(l + lp - 2.0*D)) * 1000.0; // m
+
+    return ecliptic_to_equatorial(lambda, beta, r);
+}
+
+vec3d third_body_accel(vec3d pos, vec3d body_pos, double gm) {
+    // a = -gm/|d|^3 * (r + F(q)*s),  d = r - s
+    // with q = r.(r - 2s)/s.s and F(q) = q(3 + 3q + q^2)/(1 + (1+q)^1.5)
+    vec3d d = pos - body_pos;
+    double d_mag = laml::length(d);
+
+    double q = laml::dot(pos, pos - 2.0*body_pos) / laml::dot(body_pos, body_pos);
+    double F = q*(3.0 + 3.0*q + q*q) / (1.0 + (1.0 + q)*sqrt(1.0 + q));
+
+    return -gm * (pos + F*body_pos) / (d_mag*d_mag*d_mag);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "defines.h"
+
+#include "jpl_ephemeris.h"
+#include "epoch.h"
+
+enum ephemeris_body : int {
+    BODY_SUN = 0,
+    BODY_MOON = 1,
+    NUM_EPHEMERIS_BODIES
+};
+
+// Positions of the third bodies at a single sim time.
+// Earth-centered, mean equator and equinox of J2000, in m.
+struct ephemeris_state {
+    double t;
+    vec3d sun_position;
+    vec3d moon_position;
+
+    bool valid = false;
+};
+
+// Shared lunisolar ephemeris. Every body asks for the same stage times during
+// integration, so the positions are evaluated once per distinct time and the
+// result is reused by all bodies through a small cache.
+struct ephemeris {
+    ephemeris();
+
+    void set_epoch(double jd_tt);
+    void set_epoch(const epoch& start);
+    const ephemeris_state& at(double t);
+
+    // total lunisolar perturbing acceleration on a body at pos_inertial
+    vec3d third_body_accel(vec3d pos_inertial, double t);
+
+    // when set (and open), positions come from the DE file instead of the
+    // analytic series. Falls back to the series outside the file's span.
+    const jpl_ephemeris* de_file = nullptr;
+
+    // low-precision analytic series (Montenbruck & Gill, Satellite Orbits 3.3.2)
+    // ~0.1-1% accuracy in position, good enough for the perturbing force.
+    static vec3d sun_position(double jd_tt);
+    static vec3d moon_position(double jd_tt);
+
+    double epoch_jd;                // TT Julian date at sim time 0
+    double epoch_tdb_whole;         // two-part TDB Julian date at sim time 0, for the DE file
+    double epoch_tdb_frac;
+    double gm_sun = 1.32712440018e20; // m^3/s^2
+    double gm_moon = 4.902800066e12;  // m^3/s^2
+
+    bool enable_sun = true;
+    bool enable_moon = true;
+
+    uint64 num_evaluations; // cache misses, i.e. actual series evaluations
+
+private:
+    bool warned_out_of_span = false;
+
+    static const uint32 cache_size = 8;
+    ephemeris_state cache[cache_size];
+    uint32 cache_next;
+};
+
+// acceleration on pos due to a point mass at body_pos, minus the acceleration
+// of the central body (Battin's formulation to avoid cancellation)
+vec3d third_body_accel(vec3d pos, vec3d body_pos, double gm);
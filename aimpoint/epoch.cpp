@@ -0,0 +1,164 @@
+#include "epoch.h"
+
+#include <cmath>
+
+static const double tt_minus_tai = 32.184;      // s
+static const double j2000_midnight = 2451544.5; // JD at 2000-01-01 00:00
+static const int64 seconds_per_day = 86400;
+
+struct leap_second {
+    int32 mjd;     // UTC day the new offset starts
+    double offset; // TAI - UTC from then on
+};
+
+// IERS Bulletin C. Add new entries here when announced.
+static const leap_second leap_second_table[] = {
+    { 41317, 10.0 }, { 41499, 11.0 }, { 41683, 12.0 }, { 42048, 13.0 }, { 42413, 14.0 },
+    { 42778, 15.0 }, { 43144, 16.0 }, { 43509, 17.0 }, { 43874, 18.0 }, { 44239, 19.0 },
+    { 44786, 20.0 }, { 45151, 21.0 }, { 45516, 22.0 }, { 46247, 23.0 }, { 47161, 24.0 },
+    { 47892, 25.0 }, { 48257, 26.0 }, { 48804, 27.0 }, { 49169, 28.0 }, { 49534, 29.0 },
+    { 50083, 30.0 }, { 50630, 31.0 }, { 51179, 32.0 }, { 53736, 33.0 }, { 54832, 34.0 },
+    { 56109, 35.0 }, { 57204, 36.0 }, { 57754, 37.0 },
+};
+
+double tai_minus_utc(double mjd_utc) {
+    // pre-1972 UTC used rubber seconds, just clamp to the first entry
+    const size_t num_entries = sizeof(leap_second_table) / sizeof(leap_second_table[0]);
+    for (size_t n = num_entries; n > 0; n--) {
+        if (mjd_utc >= leap_second_table[n - 1].mjd)
+            return leap_second_table[n - 1].offset;
+    }
+    return leap_second_table[0].offset;
+}
+
+double tdb_minus_tt(double jd_tt) {
+    // Fairhead & Bretagnon, two largest terms
+    double g = (357.53 + 0.98560028*(jd_tt - 2451545.0)) * laml::constants::deg2rad<double>;
+    return 0.001657*sin(g) + 0.000014*sin(2.0*g);
+}
+
+static int64 floor_div(int64 a, int64 b) {
+    int64 q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+static int64 julian_day_number(int32 year, int32 month, int32 day) {
+    int64 a = (14 - month) / 12;
+    int64 y = year + 4800 - a;
+    int64 m = month + 12*a - 3;
+    return day + (153*m + 2)/5 + 365*y + y/4 - y/100 + y/400 - 32045;
+}
+
+void epoch::normalize() {
+    double whole = floor(fraction);
+    seconds += (int64)whole;
+    fraction -= whole;
+}
+
+// seconds to add to TT to get the given scale, at the instant 'tt'
+static double offset_from_tt(const epoch& tt, time_scale scale) {
+    double jd_tt = 2451545.0 + (tt.seconds + tt.fraction) / 86400.0;
+    switch (scale) {
+        case TIME_SCALE_TT:  return 0.0;
+        case TIME_SCALE_TAI: return -tt_minus_tai;
+        case TIME_SCALE_TDB: return tdb_minus_tt(jd_tt);
+        case TIME_SCALE_UTC: {
+            // the offset depends on the UTC day, so refine once
+            double mjd = jd_tt - 2400000.5;
+            double dat = tai_minus_utc(mjd - (tt_minus_tai + 37.0)/86400.0);
+            dat = tai_minus_utc(mjd - (tt_minus_tai + dat)/86400.0);
+            return -(tt_minus_tai + dat);
+        }
+    }
+    return 0.0;
+}
+
+epoch epoch::from_jd(double jd_whole, double jd_frac, time_scale scale) {
+    // seconds in 'scale' since 2000-01-01 00:00, split to keep precision
+    double days = jd_whole - j2000_midnight;
+    double whole_days = floor(days);
+    double day_seconds = ((days - whole_days) + jd_frac) * 86400.0;
+    double whole_seconds = floor(day_seconds);
+
+    epoch e;
+    e.seconds = (int64)whole_days*seconds_per_day + (int64)whole_seconds - seconds_per_day/2;
+    e.fraction = day_seconds - whole_seconds;
+
+    // back to TT
+    double jd = jd_whole + jd_frac;
+    switch (scale) {
+        case TIME_SCALE_TT:  break;
+        case TIME_SCALE_TAI: e.fraction += tt_minus_tai; break;
+        case TIME_SCALE_TDB: e.fraction -= tdb_minus_tt(jd); break;
+        case TIME_SCALE_UTC: e.fraction += tt_minus_tai + tai_minus_utc(jd - 2400000.5); break;
+    }
+    e.normalize();
+    return e;
+}
+
+epoch epoch::from_calendar(int32 year, int32 month, int32 day, int32 hour, int32 minute, double second, time_scale scale) {
+    // offsets only change at midnight, so take them at the start of the day
+    // and add the time of day as elapsed seconds (handles 23:59:60 too)
+    epoch e = from_jd((double)julian_day_number(year, month, day) - 0.5, 0.0, scale);
+    e += hour*3600.0 + minute*60.0;
+    e += second;
+    return e;
+}
+
+void epoch::to_jd(time_scale scale, double* jd_whole, double* jd_frac) const {
+    epoch shifted = *this;
+    shifted.seconds += seconds_per_day/2; // from noon to midnight
+    shifted.fraction += offset_from_tt(*this, scale);
+    shifted.normalize();
+
+    int64 days = floor_div(shifted.seconds, seconds_per_day);
+    int64 rem = shifted.seconds - days*seconds_per_day;
+
+    *jd_whole = j2000_midnight + (double)days;
+    *jd_frac = ((double)rem + shifted.fraction) / 86400.0;
+}
+
+double epoch::to_jd(time_scale scale) const {
+    double jd_whole, jd_frac;
+    to_jd(scale, &jd_whole, &jd_frac);
+    return jd_whole + jd_frac;
+}
+
+void epoch::to_calendar(time_scale scale, int32* year, int32* month, int32* day,
+                        int32* hour, int32* minute, double* second) const {
+    double jd_whole, jd_frac;
+    to_jd(scale, &jd_whole, &jd_frac);
+
+    // Richards' algorithm for the Gregorian date of a Julian day number
+    int64 J = (int64)(jd_whole + 0.5);
+    int64 f = J + 1401 + (((4*J + 274277) / 146097) * 3) / 4 - 38;
+    int64 e = 4*f + 3;
+    int64 g = (e % 1461) / 4;
+    int64 h = 5*g + 2;
+    *day = (int32)((h % 153) / 5 + 1);
+    *month = (int32)(((h / 153 + 2) % 12) + 1);
+    *year = (int32)(e / 1461 - 4716 + (12 + 2 - *month) / 12);
+
+    double day_seconds = jd_frac * 86400.0;
+    *hour = (int32)(day_seconds / 3600.0);
+    *minute = (int32)((day_seconds - *hour*3600.0) / 60.0);
+    *second = day_seconds - *hour*3600.0 - *minute*60.0;
+}
+
+epoch& epoch::operator+=(double dt) {
+    double whole = floor(dt);
+    seconds += (int64)whole;
+    fraction += dt - whole;
+    normalize();
+    return *this;
+}
+
+epoch epoch::operator+(double dt) const {
+    epoch result = *this;
+    result += dt;
+    return result;
+}
+
+double epoch::operator-(const epoch& other) const {
+    return (double)(seconds - other.seconds) + (fraction - other.fraction);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "defines.h"
+
+enum time_scale : int {
+    TIME_SCALE_UTC = 0,
+    TIME_SCALE_TAI = 1,
+    TIME_SCALE_TT = 2,
+    TIME_SCALE_TDB = 3,
+};
+
+// An instant, stored as whole TT seconds since J2000 (2000-01-01 12:00:00 TT)
+// plus a fraction of a second. The fraction keeps ~1e-16 s resolution no
+// matter how far from J2000, and differences between nearby epochs are exact.
+struct epoch {
+    int64 seconds = 0;
+    double fraction = 0.0; // [0, 1) s
+
+    static epoch from_jd(double jd_whole, double jd_frac, time_scale scale);
+    static epoch from_calendar(int32 year, int32 month, int32 day,
+                               int32 hour, int32 minute, double second, time_scale scale = TIME_SCALE_UTC);
+
+    // two-part Julian date; jd_whole is on a day boundary (x.5), jd_frac in [0, 1)
+    void to_jd(time_scale scale, double* jd_whole, double* jd_frac) const;
+    double to_jd(time_scale scale) const;
+    void to_calendar(time_scale scale, int32* year, int32* month, int32* day,
+                     int32* hour, int32* minute, double* second) const;
+
+    epoch& operator+=(double dt);
+    epoch operator+(double dt) const;
+    double operator-(const epoch& other) const; // s
+
+private:
+    void normalize();
+};
+
+double tai_minus_utc(double mjd_utc); // leap seconds, s (table from 1972)
+double tdb_minus_tt(double jd_tt);    // s, periodic terms to ~30 us
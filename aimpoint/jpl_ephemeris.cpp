@@ -0,0 +1,287 @@
+#include "jpl_ephemeris.h"
+
+#include "log.h"
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// header layout of record 1 (packed, Fortran-written)
+static const uint64 header_ss_offset = 2652;   // start/end/interval doubles
+static const uint64 header_ncon_offset = 2676; // int32
+static const uint64 header_au_offset = 2680;
+static const uint64 header_emrat_offset = 2688;
+static const uint64 header_ipt_offset = 2696;  // int32[12][3]
+static const uint64 header_numde_offset = 2840;
+static const uint64 header_lpt_offset = 2844;  // int32[3]
+static const uint64 header_extra_offset = 2856;
+
+static std::atomic<uint32> de_generation_counter(1);
+
+struct de_thread_cache {
+    const jpl_ephemeris* owner = nullptr;
+    uint32 generation = 0;
+    uint64 index = ~0ull;
+    const double* record = nullptr;
+    std::vector<double> swapped; // byte-swapped copy for foreign-endian files
+};
+static thread_local de_thread_cache de_cache;
+
+static int32 read_int32(const uint8* src, bool swap) {
+    uint32 v;
+    memcpy(&v, src, sizeof(v));
+    if (swap) {
+        v = (v >> 24) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | (v << 24);
+    }
+    return (int32)v;
+}
+
+static double read_double(const uint8* src, bool swap) {
+    uint8 bytes[8];
+    memcpy(bytes, src, 8);
+    if (swap) {
+        for (int n = 0; n < 4; n++) {
+            uint8 tmp = bytes[n];
+            bytes[n] = bytes[7 - n];
+            bytes[7 - n] = tmp;
+        }
+    }
+    double v;
+    memcpy(&v, bytes, 8);
+    return v;
+}
+
+// number of components stored for each item
+static int32 item_components(int32 item) {
+    if (item == 11) return 2; // nutations
+    if (item == 14) return 1; // TT-TDB
+    return 3;
+}
+
+bool jpl_ephemeris::open(const char* filename) {
+    close();
+
+    if (!file.open(filename)) {
+        spdlog::warn("Could not open ephemeris file '{0}'", filename);
+        return false;
+    }
+
+    const uint8* header = file.get_data();
+    if (file.get_size() < header_extra_offset) {
+        spdlog::error("'{0}' is too small to be a DE ephemeris", filename);
+        close();
+        return false;
+    }
+
+    // the file records its own DE number, use it to detect the byte order
+    swap_bytes = false;
+    de_number = read_int32(header + header_numde_offset, false);
+    if (de_number <= 0 || de_number > 10000) {
+        swap_bytes = true;
+        de_number = read_int32(header + header_numde_offset, true);
+        if (de_number <= 0 || de_number > 10000) {
+            spdlog::error("'{0}' is not a DE binary ephemeris", filename);
+            close();
+            return false;
+        }
+    }
+
+    start_jd = read_double(header + header_ss_offset,      swap_bytes);
+    end_jd   = read_double(header + header_ss_offset + 8,  swap_bytes);
+    interval = read_double(header + header_ss_offset + 16, swap_bytes);
+    int32 num_constants = read_int32(header + header_ncon_offset, swap_bytes);
+    au    = read_double(header + header_au_offset,    swap_bytes);
+    emrat = read_double(header + header_emrat_offset, swap_bytes);
+
+    memset(ipt, 0, sizeof(ipt));
+    for (int32 i = 0; i < 12; i++) {
+        for (int32 j = 0; j < 3; j++) {
+            ipt[i][j] = read_int32(header + header_ipt_offset + 4*(3*i + j), swap_bytes);
+        }
+    }
+    for (int32 j = 0; j < 3; j++) {
+        ipt[12][j] = read_int32(header + header_lpt_offset + 4*j, swap_bytes);
+    }
+
+    // DE430 and later store >400 constant names, followed by two more item pointers
+    if (num_constants > 400) {
+        uint64 offset = header_extra_offset + 6*(uint64)(num_constants - 400);
+        if (offset + 24 <= file.get_size()) {
+            for (int32 j = 0; j < 3; j++) {
+                ipt[13][j] = read_int32(header + offset + 4*j, swap_bytes);
+                ipt[14][j] = read_int32(header + offset + 12 + 4*j, swap_bytes);
+            }
+        }
+    }
+
+    // record length is implied by the last coefficient of any item
+    num_coeffs = 0;
+    for (int32 i = 0; i < 15; i++) {
+        if (ipt[i][1] <= 0 || ipt[i][2] <= 0)
+            continue;
+        if (ipt[i][1] > 32) {
+            spdlog::error("'{0}' has unsupported Chebyshev degree {1}", filename, ipt[i][1]);
+            close();
+            return false;
+        }
+        uint32 last = (uint32)(ipt[i][0] - 1 + item_components(i)*ipt[i][1]*ipt[i][2]);
+        if (last > num_coeffs)
+            num_coeffs = last;
+    }
+    record_size = (uint64)num_coeffs * sizeof(double);
+
+    if (num_coeffs == 0 || interval <= 0.0 || file.get_size() < 3*record_size) {
+        spdlog::error("'{0}' has an invalid DE header", filename);
+        close();
+        return false;
+    }
+
+    // first two records are header and constants
+    num_records = file.get_size() / record_size - 2;
+    generation = de_generation_counter++;
+
+    spdlog::info("Opened DE{0} ephemeris: JD {1:.1f} to {2:.1f}, {3} records",
+                 de_number, start_jd, end_jd, num_records);
+    return true;
+}
+
+void jpl_ephemeris::close() {
+    file.close();
+    num_records = 0;
+    generation = 0;
+}
+
+const double* jpl_ephemeris::get_record(double jd_whole, double jd_frac) const {
+    double days = (jd_whole - start_jd) + jd_frac;
+    if (days < 0.0 || jd_whole + jd_frac > end_jd)
+        return nullptr;
+
+    uint64 index = (uint64)(days / interval);
+    if (index >= num_records)
+        index = num_records - 1; // t == end_jd
+
+    de_thread_cache& cache = de_cache;
+    if (cache.owner == this && cache.generation == generation && cache.index == index)
+        return cache.record;
+
+    const uint8* src = file.get_data() + (2 + index)*record_size;
+    if (swap_bytes) {
+        cache.swapped.resize(num_coeffs);
+        for (uint32 n = 0; n < num_coeffs; n++) {
+            cache.swapped[n] = read_double(src + 8*n, true);
+        }
+        cache.record = cache.swapped.data();
+    } else {
+        // records are 8-byte aligned in the mapping since the record size is a multiple of 8
+        cache.record = (const double*)src;
+    }
+    cache.owner = this;
+    cache.generation = generation;
+    cache.index = index;
+
+    return cache.record;
+}
+
+void jpl_ephemeris::interpolate(int32 item, const double* record, double jd_whole, double jd_frac,
+                                double* pos, double* vel) const {
+    const int32 offset = ipt[item][0] - 1;
+    const int32 num_cheby = ipt[item][1];
+    const int32 num_sub = ipt[item][2];
+    const int32 num_comp = item_components(item);
+
+    // locate the sub-interval and normalized time within it
+    double sub_length = interval / num_sub;
+    double t = ((jd_whole - record[0]) + jd_frac) / sub_length;
+    int32 sub = (int32)t;
+    if (sub >= num_sub) sub = num_sub - 1;
+    if (sub < 0) sub = 0;
+    double x = 2.0*(t - sub) - 1.0;
+
+    // Chebyshev polynomials and their derivatives at x
+    double T[32], dT[32];
+    T[0] = 1.0; T[1] = x;
+    dT[0] = 0.0; dT[1] = 1.0;
+    for (int32 k = 2; k < num_cheby && k < 32; k++) {
+        T[k]  = 2.0*x*T[k-1] - T[k-2];
+        dT[k] = 2.0*T[k-1] + 2.0*x*dT[k-1] - dT[k-2];
+    }
+
+    const double* coeffs = record + offset + sub*num_comp*num_cheby;
+    const double vel_scale = 2.0 / sub_length; // d(x)/d(day)
+    for (int32 c = 0; c < num_comp; c++) {
+        const double* a = coeffs + c*num_cheby;
+        double p = 0.0, v = 0.0;
+        for (int32 k = num_cheby - 1; k >= 0; k--) {
+            p += a[k]*T[k];
+            v += a[k]*dT[k];
+        }
+        pos[c] = p;
+        if (vel)
+            vel[c] = v*vel_scale;
+    }
+}
+
+void jpl_ephemeris::barycentric(de_target target, const double* record, double jd_whole, double jd_frac,
+                                double* pos, double* vel) const {
+    if (target == DE_SSB) {
+        pos[0] = pos[1] = pos[2] = 0.0;
+        vel[0] = vel[1] = vel[2] = 0.0;
+        return;
+    }
+
+    if (target == DE_EARTH || target == DE_MOON) {
+        double emb_pos[3], emb_vel[3], moon_pos[3], moon_vel[3];
+        interpolate(DE_EMB,  record, jd_whole, jd_frac, emb_pos,  emb_vel);
+        interpolate(DE_MOON, record, jd_whole, jd_frac, moon_pos, moon_vel);
+
+        // earth = emb - moon_geo/(1 + emrat), moon = earth + moon_geo
+        double f = 1.0 / (1.0 + emrat);
+        for (int c = 0; c < 3; c++) {
+            double earth_pos = emb_pos[c] - f*moon_pos[c];
+            double earth_vel = emb_vel[c] - f*moon_vel[c];
+            pos[c] = (target == DE_EARTH) ? earth_pos : earth_pos + moon_pos[c];
+            vel[c] = (target == DE_EARTH) ? earth_vel : earth_vel + moon_vel[c];
+        }
+        return;
+    }
+
+    interpolate(target, record, jd_whole, jd_frac, pos, vel);
+}
+
+bool jpl_ephemeris::state(de_target target, de_target center, double jd_whole, double jd_frac,
+                          vec3d* pos, vec3d* vel) const {
+    if (!is_open())
+        return false;
+
+    // outside the span, callers decide whether that's worth reporting
+    const double* record = get_record(jd_whole, jd_frac);
+    if (record == nullptr)
+        return false;
+
+    double p[3], v[3];
+    if (target == DE_MOON && center == DE_EARTH) {
+        // stored directly, skip the barycentric round trip
+        interpolate(DE_MOON, record, jd_whole, jd_frac, p, v);
+    } else {
+        double tp[3], tv[3], cp[3], cv[3];
+        barycentric(target, record, jd_whole, jd_frac, tp, tv);
+        barycentric(center, record, jd_whole, jd_frac, cp, cv);
+        for (int c = 0; c < 3; c++) {
+            p[c] = tp[c] - cp[c];
+            v[c] = tv[c] - cv[c];
+        }
+    }
+
+    // km -> m, km/day -> m/s
+    if (pos)
+        *pos = vec3d(p[0], p[1], p[2]) * 1000.0;
+    if (vel)
+        *vel = vec3d(v[0], v[1], v[2]) * (1000.0 / 86400.0);
+    return true;
+}
+
+vec3d jpl_ephemeris::position(de_target target, de_target center, double jd_tdb) const {
+    vec3d pos(0.0, 0.0, 0.0);
+    state(target, center, jd_tdb, 0.0, &pos, nullptr);
+    return pos;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "defines.h"
+
+#include "mapped_file.h"
+
+// Items in a JPL DE binary file. The first 11 map directly onto the file's
+// coefficient table, EARTH/SSB are derived.
+enum de_target : int {
+    DE_MERCURY = 0,
+    DE_VENUS = 1,
+    DE_EMB = 2,      // Earth-Moon barycenter
+    DE_MARS = 3,
+    DE_JUPITER = 4,
+    DE_SATURN = 5,
+    DE_URANUS = 6,
+    DE_NEPTUNE = 7,
+    DE_PLUTO = 8,
+    DE_MOON = 9,     // geocentric in the file
+    DE_SUN = 10,
+    DE_EARTH = 11,
+    DE_SSB = 12,     // solar system barycenter
+    NUM_DE_TARGETS
+};
+
+// Reader for JPL DE binary ephemerides (DE405/DE430/DE440 "linux_*"/"lnx*" files).
+// The file is memory-mapped on open, only the header is touched. Coefficient
+// records are located on demand and each thread keeps its current record, so
+// consecutive lookups in the same ~32 day span skip the record search.
+struct jpl_ephemeris {
+    jpl_ephemeris() {}
+
+    bool open(const char* filename);
+    void close();
+    bool is_open() const { return file.is_open(); }
+
+    // position/velocity of target relative to center, ICRF axes, m and m/s.
+    // time is TDB as a two-part Julian date (jd_whole + jd_frac) for precision.
+    // Returns false, without logging, outside the file's span.
+    bool state(de_target target, de_target center, double jd_whole, double jd_frac,
+               vec3d* pos, vec3d* vel = nullptr) const;
+    vec3d position(de_target target, de_target center, double jd_tdb) const;
+
+    double get_start_jd() const { return start_jd; }
+    double get_end_jd() const { return end_jd; }
+    int32 get_version() const { return de_number; }
+
+    double au = 0.0;    // km
+    double emrat = 0.0; // Earth/Moon mass ratio
+
+private:
+    mapped_file file;
+
+    int32 de_number = 0;
+    double start_jd = 0.0, end_jd = 0.0, interval = 0.0; // days
+    uint32 num_coeffs = 0;   // doubles per record
+    uint64 record_size = 0;  // bytes
+    uint64 num_records = 0;
+    bool swap_bytes = false;
+
+    // per item: offset of first coefficient (0-based), coeffs per component, sub-intervals
+    int32 ipt[15][3];
+
+    uint32 generation = 0; // invalidates per-thread caches on reopen
+
+    const double* get_record(double jd_whole, double jd_frac) const;
+    // raw file item (barycentric, Moon geocentric), km and km/day
+    void interpolate(int32 item, const double* record, double jd_whole, double jd_frac,
+                     double* pos, double* vel) const;
+    void barycentric(de_target target, const double* record, double jd_whole, double jd_frac,
+                     double* pos, double* vel) const;
+};
@@ -0,0 +1,161 @@
+#include "kepler.h"
+
+#include <cmath>
+
+static const double two_pi = 6.283185307179586476925287;
+
+// Mikkola's starter, M in [-pi, pi]
+static inline double kepler_starter(double M, double e) {
+    double denom = 4.0*e + 0.5;
+    double alpha = (1.0 - e) / denom;
+    double beta = 0.5*M / denom;
+    double z = cbrt(beta + copysign(sqrt(beta*beta + alpha*alpha*alpha), beta));
+    double s = z - alpha / z;
+    s = s - 0.078*s*s*s*s*s / (1.0 + e);
+    return M + e*s*(3.0 - 4.0*s*s);
+}
+
+static inline double halley_step(double E, double M, double e, double* step) {
+    double se = e*sin(E);
+    double ce = e*cos(E);
+    double f = E - se - M;
+    double fp = 1.0 - ce;
+    double newton = -f / fp;
+    *step = -f / (fp + 0.5*newton*se);
+    return E + *step;
+}
+
+double kepler_solve(double M, double e) {
+    // reduce to [-pi, pi], the starter is built for that range
+    double revs = floor(M / two_pi + 0.5) * two_pi;
+    double m = M - revs;
+
+    double E = kepler_starter(m, e);
+    for (uint32 n = 0; n < kepler_max_iterations; n++) {
+        double step;
+        E = halley_step(E, m, e, &step);
+        if (fabs(step) < 1.0e-15)
+            break;
+    }
+
+    return E + revs;
+}
+
+void kepler_solve_batch(const double* M, const double* e, double* E, size_t count) {
+    for (size_t n = 0; n < count; n++) {
+        double revs = floor(M[n] / two_pi + 0.5) * two_pi;
+        double m = M[n] - revs;
+        double ecc = e[n];
+
+        double En = kepler_starter(m, ecc);
+        double step;
+        En = halley_step(En, m, ecc, &step);
+        En = halley_step(En, m, ecc, &step);
+        En = halley_step(En, m, ecc, &step); // margin for e > 0.999
+
+        E[n] = En + revs;
+    }
+}
+
+void stumpff(double psi, double* c2, double* c3) {
+    if (psi > 1.0e-6) {
+        double s = sqrt(psi);
+        *c2 = (1.0 - cos(s)) / psi;
+        *c3 = (s - sin(s)) / (psi*s);
+    } else if (psi < -1.0e-6) {
+        double s = sqrt(-psi);
+        *c2 = (1.0 - cosh(s)) / psi;
+        *c3 = (sinh(s) - s) / (-psi*s);
+    } else {
+        *c2 = 0.5 - psi*(1.0/24.0 - psi/720.0);
+        *c3 = 1.0/6.0 - psi*(1.0/120.0 - psi/5040.0);
+    }
+}
+
+bool kepler_propagate(vec3d r0, vec3d v0, double dt, double gm, vec3d* r_out, vec3d* v_out) {
+    const double sqrt_gm = sqrt(gm);
+    const double r0_mag = laml::length(r0);
+    const double v0_sq = laml::dot(v0, v0);
+    const double rdotv = laml::dot(r0, v0);
+    const double sigma0 = rdotv / sqrt_gm;
+    const double alpha = 2.0/r0_mag - v0_sq/gm; // 1/a, 0 for a parabola
+
+    if (dt == 0.0) {
+        *r_out = r0;
+        *v_out = v0;
+        return true;
+    }
+
+    // initial guess for the universal anomaly
+    double chi;
+    if (alpha > 1.0e-12) {
+        // drop whole revolutions, they don't change the state
+        double period = two_pi / (alpha*sqrt(alpha)*sqrt_gm);
+        dt = fmod(dt, period);
+        chi = sqrt_gm*alpha*dt;
+    } else if (alpha < -1.0e-12) {
+        double a = 1.0/alpha;
+        double sign_dt = dt > 0.0 ? 1.0 : -1.0;
+        double num = -2.0*gm*alpha*dt;
+        double den = rdotv + sign_dt*sqrt(-gm*a)*(1.0 - r0_mag*alpha);
+        chi = sign_dt*sqrt(-a)*log(num / den);
+    } else {
+        // Barker's equation for the parabola
+        vec3d h = laml::cross(r0, v0);
+        double p = laml::dot(h, h) / gm;
+        double s = 0.5*atan(1.0 / (3.0*sqrt(gm/(p*p*p))*dt));
+        double w = atan(cbrt(tan(s)));
+        chi = sqrt(p) * 2.0 / tan(2.0*w);
+    }
+
+    // Newton on the universal Kepler equation
+    const uint32 max_iterations = 50;
+    bool converged = false;
+    double psi = 0.0, c2 = 0.5, c3 = 1.0/6.0, r_mag = r0_mag;
+    for (uint32 n = 0; n < max_iterations; n++) {
+        psi = chi*chi*alpha;
+        stumpff(psi, &c2, &c3);
+
+        double chi2 = chi*chi;
+        r_mag = chi2*c2 + sigma0*chi*(1.0 - psi*c3) + r0_mag*(1.0 - psi*c2);
+        double F = sigma0*chi2*c2 + (1.0 - r0_mag*alpha)*chi2*chi*c3 + r0_mag*chi - sqrt_gm*dt;
+
+        double step = F / r_mag;
+        chi -= step;
+        if (fabs(step) < 1.0e-9*(1.0 + fabs(chi))) {
+            converged = true;
+            break;
+        }
+    }
+
+    psi = chi*chi*alpha;
+    stumpff(psi, &c2, &c3);
+    double chi2 = chi*chi;
+    r_mag = chi2*c2 + sigma0*chi*(1.0 - psi*c3) + r0_mag*(1.0 - psi*c2);
+
+    // Lagrange coefficients
+    double f = 1.0 - chi2*c2/r0_mag;
+    double g = dt - chi2*chi*c3/sqrt_gm;
+    double g_dot = 1.0 - chi2*c2/r_mag;
+    double f_dot = sqrt_gm*chi*(psi*c3 - 1.0)/(r_mag*r0_mag);
+
+    *r_out = f*r0 + g*v0;
+    *v_out = f_dot*r0 + g_dot*v0;
+    return converged;
+}
+
+uint32 kepler_propagate_batch(const double* const pos[3], const double* const vel[3], size_t count,
+                              double dt, double gm, double* const pos_out[3], double* const vel_out[3]) {
+    uint32 num_failed = 0;
+    for (size_t n = 0; n < count; n++) {
+        vec3d r0(pos[0][n], pos[1][n], pos[2][n]);
+        vec3d v0(vel[0][n], vel[1][n], vel[2][n]);
+        vec3d r, v;
+        if (!kepler_propagate(r0, v0, dt, gm, &r, &v))
+            num_failed++;
+
+        pos_out[0][n] = r.x; pos_out[1][n] = r.y; pos_out[2][n] = r.z;
+        vel_out[0][n] = v.x; vel_out[1][n] = v.y; vel_out[2][n] = v.z;
+    }
+    return num_failed;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "defines.h"
+
+// Solves Kepler's equation M = E - e*sin(E) for elliptic orbits (0 <= e < 1).
+// Angles in radians. E is returned in the same revolution as M.
+//
+// Mikkola's cubic starter (1987) is within ~1e-3 everywhere, including the
+// M ~ 0, e ~ 1 corner where Danby's starter is poor, and two Halley steps
+// take it to round-off. The scalar version stops early once converged and
+// never runs more than kepler_max_iterations.
+double kepler_solve(double M, double e);
+
+// Fixed iteration count and no branches in the loop body, so it vectorizes
+// where the compiler has vector sin/cos/cbrt.
+void kepler_solve_batch(const double* M, const double* e, double* E, size_t count);
+
+const uint32 kepler_max_iterations = 4;
+
+// Stumpff functions c2(psi) = (1 - cos(sqrt(psi)))/psi, c3(psi) = (sqrt(psi) - sin(sqrt(psi)))/sqrt(psi)^3,
+// continued through psi = 0 (parabola) and psi < 0 (hyperbola)
+void stumpff(double psi, double* c2, double* c3);
+
+// Two-body propagation of a state vector by dt with the universal variable
+// formulation (Vallado alg. 8). Handles circular, elliptic, parabolic and
+// hyperbolic orbits the same way and never goes through orbital elements.
+// Returns false if the iteration did not converge (state is still filled).
+bool kepler_propagate(vec3d r0, vec3d v0, double dt, double gm, vec3d* r, vec3d* v);
+
+// SoA form: state arrays are [x..., y..., z...] per component, in/out may alias.
+// Returns the number of states that did not converge.
+uint32 kepler_propagate_batch(const double* const pos[3], const double* const vel[3], size_t count,
+                              double dt, double gm, double* const pos_out[3], double* const vel_out[3]);
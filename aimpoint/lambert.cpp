@@ -0,0 +1,273 @@
+#include "lambert.h"
+
+#include <cmath>
+
+static const double pi = 3.141592653589793238462643;
+
+// r1/r2 reduced to Izzo's nondimensional problem
+struct lambert_geometry {
+    double lambda, lambda2, lambda3;
+    double T;     // nondimensional time of flight
+    double r1n, r2n;
+    double ir1[3], ir2[3], it1[3], it2[3]; // radial and transverse unit vectors
+    double gamma, rho, sigma;
+};
+
+static inline double dot3(const double* a, const double* b) {
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline void cross3(const double* a, const double* b, double* out) {
+    out[0] = a[1]*b[2] - a[2]*b[1];
+    out[1] = a[2]*b[0] - a[0]*b[2];
+    out[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+static inline bool normalize3(double* a) {
+    double n = sqrt(dot3(a, a));
+    if (n == 0.0)
+        return false;
+    a[0] /= n; a[1] /= n; a[2] /= n;
+    return true;
+}
+
+static bool lambert_setup(const double* r1, const double* r2, double tof, double gm, bool retrograde,
+                          lambert_geometry* g) {
+    if (!(tof > 0.0) || !(gm > 0.0))
+        return false;
+
+    double c[3] = { r2[0] - r1[0], r2[1] - r1[1], r2[2] - r1[2] };
+    double cn = sqrt(dot3(c, c));
+    g->r1n = sqrt(dot3(r1, r1));
+    g->r2n = sqrt(dot3(r2, r2));
+    if (cn == 0.0 || g->r1n == 0.0 || g->r2n == 0.0)
+        return false;
+    double s = 0.5*(cn + g->r1n + g->r2n);
+
+    for (int n = 0; n < 3; n++) {
+        g->ir1[n] = r1[n] / g->r1n;
+        g->ir2[n] = r2[n] / g->r2n;
+    }
+    double ih[3];
+    cross3(g->ir1, g->ir2, ih);
+    if (!normalize3(ih))
+        return false; // collinear, no transfer plane
+
+    g->lambda2 = 1.0 - cn/s;
+    g->lambda = sqrt(g->lambda2 > 0.0 ? g->lambda2 : 0.0);
+
+    // the short way is the prograde one when h points up, otherwise the
+    // transfer goes the long way round
+    if (ih[2] < 0.0) {
+        g->lambda = -g->lambda;
+        cross3(g->ir1, ih, g->it1);
+        cross3(g->ir2, ih, g->it2);
+    } else {
+        cross3(ih, g->ir1, g->it1);
+        cross3(ih, g->ir2, g->it2);
+    }
+    if (retrograde) {
+        g->lambda = -g->lambda;
+        for (int n = 0; n < 3; n++) {
+            g->it1[n] = -g->it1[n];
+            g->it2[n] = -g->it2[n];
+        }
+    }
+    g->lambda3 = g->lambda*g->lambda2;
+
+    g->T = sqrt(2.0*gm / (s*s*s)) * tof;
+
+    g->gamma = sqrt(0.5*gm*s);
+    g->rho = (g->r1n - g->r2n) / cn;
+    g->sigma = sqrt(1.0 - g->rho*g->rho);
+    return true;
+}
+
+// Gauss hypergeometric 2F1(3, 1, 5/2, z) for Battin's series
+static double hypergeometric(double z) {
+    double S = 1.0, C = 1.0;
+    for (uint32 j = 0; j < 64; j++) {
+        C = C * (3.0 + j)*(1.0 + j) / (2.5 + j) * z / (j + 1.0);
+        S += C;
+        if (fabs(C) < 1.0e-11)
+            break;
+    }
+    return S;
+}
+
+// T(x) for N revolutions
+static double x_to_tof(double x, uint32 N, double lambda) {
+    const double battin = 0.01;
+    const double lagrange = 0.2;
+    double dist = fabs(x - 1.0);
+
+    if (dist < lagrange && dist > battin) {
+        // Lagrange
+        double a = 1.0 / (1.0 - x*x);
+        if (a > 0.0) {
+            double alpha = 2.0*acos(x);
+            double beta = 2.0*asin(sqrt(lambda*lambda / a));
+            if (lambda < 0.0) beta = -beta;
+            return 0.5*a*sqrt(a)*((alpha - sin(alpha)) - (beta - sin(beta)) + 2.0*pi*N);
+        } else {
+            double alpha = 2.0*acosh(x);
+            double beta = 2.0*asinh(sqrt(-lambda*lambda / a));
+            if (lambda < 0.0) beta = -beta;
+            return -0.5*a*sqrt(-a)*((beta - sinh(beta)) - (alpha - sinh(alpha)));
+        }
+    }
+
+    double K = lambda*lambda;
+    double E = x*x - 1.0;
+    double rho = fabs(E);
+    double z = sqrt(1.0 + K*E);
+
+    if (dist < battin) {
+        // Battin's series, near parabolic
+        double eta = z - lambda*x;
+        double S1 = 0.5*(1.0 - lambda - x*eta);
+        double Q = 4.0/3.0 * hypergeometric(S1);
+        return 0.5*(eta*eta*eta*Q + 4.0*lambda*eta) + N*pi / pow(rho, 1.5);
+    }
+
+    // Lancaster
+    double y = sqrt(rho);
+    double g = x*z - lambda*E;
+    double d;
+    if (E < 0.0) {
+        d = N*pi + acos(g);
+    } else {
+        double f = y*(z - lambda*x);
+        d = log(f + g);
+    }
+    return (x - lambda*z - d/y) / E;
+}
+
+// first three derivatives of T(x)
+static inline void tof_derivatives(double x, double T, double lambda2, double lambda3,
+                                   double* dT, double* ddT, double* dddT) {
+    double umx2 = 1.0 - x*x;
+    double y = sqrt(1.0 - lambda2*umx2);
+    double y2 = y*y;
+    double y3 = y2*y;
+    *dT = (3.0*T*x - 2.0 + 2.0*lambda3*x/y) / umx2;
+    *ddT = (3.0*T + 5.0*x*(*dT) + 2.0*(1.0 - lambda2)*lambda3/y3) / umx2;
+    *dddT = (7.0*x*(*ddT) + 8.0*(*dT) - 6.0*(1.0 - lambda2)*lambda2*lambda3*x/y3/y2) / umx2;
+}
+
+// solves T(x) = T from x0, false if it didn't converge
+static bool householder(const lambert_geometry& g, double x0, uint32 N, double tolerance, double* x) {
+    for (uint32 n = 0; n < lambert_max_iterations; n++) {
+        double tof = x_to_tof(x0, N, g.lambda);
+        double dT, ddT, dddT;
+        tof_derivatives(x0, tof, g.lambda2, g.lambda3, &dT, &ddT, &dddT);
+        double delta = tof - g.T;
+        double dT2 = dT*dT;
+        double x_new = x0 - delta*(dT2 - 0.5*delta*ddT) / (dT*(dT2 - delta*ddT) + dddT*delta*delta/6.0);
+        if (!std::isfinite(x_new))
+            return false;
+        double err = fabs(x_new - x0);
+        x0 = x_new;
+        if (err < tolerance) {
+            *x = x0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void x_to_velocity(const lambert_geometry& g, double x, double* v1, double* v2) {
+    double y = sqrt(1.0 - g.lambda2 + g.lambda2*x*x);
+    double vr1 = g.gamma*((g.lambda*y - x) - g.rho*(g.lambda*y + x)) / g.r1n;
+    double vr2 = -g.gamma*((g.lambda*y - x) + g.rho*(g.lambda*y + x)) / g.r2n;
+    double vt = g.gamma*g.sigma*(y + g.lambda*x);
+    double vt1 = vt / g.r1n;
+    double vt2 = vt / g.r2n;
+    for (int n = 0; n < 3; n++) {
+        v1[n] = vr1*g.ir1[n] + vt1*g.it1[n];
+        v2[n] = vr2*g.ir2[n] + vt2*g.it2[n];
+    }
+}
+
+// zero revolution x, the only solution for short transfers
+static bool solve_single(const lambert_geometry& g, double* x) {
+    double T00 = acos(g.lambda) + g.lambda*sqrt(1.0 - g.lambda2);
+    double T1 = 2.0/3.0 * (1.0 - g.lambda3);
+
+    double x0;
+    if (g.T >= T00)
+        x0 = -(g.T - T00) / (g.T - T00 + 4.0);
+    else if (g.T <= T1)
+        x0 = T1*(T1 - g.T) / (0.4*(1.0 - g.lambda2*g.lambda3)*g.T) + 1.0;
+    else
+        x0 = pow(g.T / T00, 0.69314718055994529 / log(T1 / T00)) - 1.0;
+
+    return householder(g, x0, 0, 1.0e-5, x);
+}
+
+// largest revolution count that fits in T, found from the minimum time of
+// flight of the last candidate
+static uint32 max_revolutions_for(const lambert_geometry& g, uint32 limit) {
+    uint32 N = (uint32)(g.T / pi);
+    if (N > limit + 1) N = limit + 1;
+    if (N == 0)
+        return 0;
+
+    double T00 = acos(g.lambda) + g.lambda*sqrt(1.0 - g.lambda2);
+    double T0 = T00 + N*pi;
+    if (g.T < T0) {
+        // Halley iterations for the minimum of T(x) at N revolutions
+        double x_old = 0.0, x_new = 0.0;
+        double T_min = T0;
+        for (uint32 n = 0; n < 12; n++) {
+            double dT, ddT, dddT;
+            tof_derivatives(x_old, T_min, g.lambda2, g.lambda3, &dT, &ddT, &dddT);
+            if (dT != 0.0)
+                x_new = x_old - dT*ddT / (ddT*ddT - 0.5*dT*dddT);
+            if (fabs(x_old - x_new) < 1.0e-13)
+                break;
+            T_min = x_to_tof(x_new, N, g.lambda);
+            x_old = x_new;
+        }
+        if (T_min > g.T)
+            N--;
+    }
+    return N < limit ? N : limit;
+}
+
+uint32 lambert_solve(vec3d r1, vec3d r2, double tof, double gm, bool retrograde, uint32 max_revolutions,
+                     vec3d* v1, vec3d* v2) {
+    double a[3] = { r1.x, r1.y, r1.z };
+    double b[3] = { r2.x, r2.y, r2.z };
+    lambert_geometry g;
+    if (!lambert_setup(a, b, tof, gm, retrograde, &g))
+        return 0;
+
+    double x[64];
+    uint32 num_x = 0;
+
+    double x_single;
+    if (solve_single(g, &x_single))
+        x[num_x++] = x_single;
+
+    uint32 N_max = max_revolutions_for(g, max_revolutions < 31 ? max_revolutions : 31);
+    for (uint32 N = 1; N <= N_max; N++) {
+        double tmp = pow((N*pi + pi) / (8.0*g.T), 2.0/3.0);
+        double x_left;
+        if (householder(g, (tmp - 1.0) / (tmp + 1.0), N, 1.0e-8, &x_left))
+            x[num_x++] = x_left;
+
+        tmp = pow(8.0*g.T / (N*pi), 2.0/3.0);
+        double x_right;
+        if (householder(g, (tmp - 1.0) / (tmp + 1.0), N, 1.0e-8, &x_right))
+            x[num_x++] = x_right;
+    }
+
+    for (uint32 n = 0; n < num_x; n++) {
+        double u[3], w[3];
+        x_to_velocity(g, x[n], u, w);
+        v1[n] = vec3d(u[0], u[1], u[2]);
+        v2[n] = vec3d(w[0], w[1], w[2]);
+    }
+    return num_x;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "defines.h"
+
+// Lambert's problem: the conic from r1 to r2 in time tof about a body with
+// parameter gm. Izzo's formulation (2015): one Householder iteration on a
+// single variable x over a nondimensional time of flight, with Lagrange,
+// Battin and Lancaster forms of T(x) so it stays well conditioned from
+// near-parabolic to many-revolution transfers.
+//
+// Transfers go the short way in the prograde sense (angular momentum along
+// +z) unless retrograde is set. The 180 deg case, where the plane is not
+// defined by r1 and r2, has no solution.
+
+// Solutions with up to max_revolutions full revolutions. v1/v2 need room for
+// 2*max_revolutions + 1 entries and are filled with the zero revolution
+// transfer first, then the left and right branch for each revolution count
+// that tof allows. Returns the number of solutions, 0 if there are none.
+uint32 lambert_solve(vec3d r1, vec3d r2, double tof, double gm, bool retrograde, uint32 max_revolutions,
+                     vec3d* v1, vec3d* v2);
+
+const uint32 lambert_max_iterations = 15;
@@ -0,0 +1,102 @@
+#include "mapped_file.h"
+
+#include "log.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::~mapped_file() {
+    close();
+}
+
+#ifdef _WIN32
+bool mapped_file::open(const char* filename) {
+    close();
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        spdlog::error("Failed to map '{0}'", filename);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        spdlog::error("Failed to map '{0}'", filename);
+        return false;
+    }
+
+    file_handle = file;
+    map_handle = mapping;
+    data = (const uint8*)view;
+    size = (uint64)file_size.QuadPart;
+    return true;
+}
+
+void mapped_file::close() {
+    if (data) {
+        UnmapViewOfFile(data);
+        CloseHandle(map_handle);
+        CloseHandle(file_handle);
+    }
+    data = nullptr;
+    size = 0;
+    file_handle = nullptr;
+    map_handle = nullptr;
+}
+#else
+bool mapped_file::open(const char* filename) {
+    close();
+
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (view == MAP_FAILED) {
+        spdlog::error("Failed to map '{0}'", filename);
+        return false;
+    }
+
+    data = (const uint8*)view;
+    size = (uint64)st.st_size;
+    return true;
+}
+
+void mapped_file::close() {
+    if (data) {
+        munmap((void*)data, (size_t)size);
+    }
+    data = nullptr;
+    size = 0;
+}
+#endif
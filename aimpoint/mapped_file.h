@@ -0,0 +1,28 @@
+#pragma once
+#include "defines.h"
+
+// Read-only memory mapping of a whole file. Pages are faulted in by the OS on
+// first touch, so opening even a very large file is essentially free.
+struct mapped_file {
+    mapped_file() {}
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    bool open(const char* filename);
+    void close();
+
+    bool is_open() const { return data != nullptr; }
+    const uint8* get_data() const { return data; }
+    uint64 get_size() const { return size; }
+
+private:
+    const uint8* data = nullptr;
+    uint64 size = 0;
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* map_handle = nullptr;
+#endif
+};
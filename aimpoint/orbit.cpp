@@ -1,29 +1,10 @@
 #include "orbit.h"
 
-double eccentric_from_mean(const double e, const double mean_deg, double eccentric_guess_deg) {
-    const double tol = 1e-12;
+#include "kepler.h"
 
-    // iterative method to solve
+double eccentric_from_mean(const double e, const double mean_deg) {
     // M = E - e*sinE for E given e,M
-    // M = Mean Anomaly
-    // E = Eccentric Anomaly
-
-    // Method:
-    // rewrite as E_(n+1) = M + e*sin(E_n)
-    // start with E_0 = M;
-    // in the future: if this is being propogated: E_0 can be the 'old' value of E
-    const double M = mean_deg * laml::constants::deg2rad<double>;
-    double E_prev = eccentric_guess_deg * laml::constants::deg2rad<double>;
-    double E_new = M + e*laml::sin(E_prev);
-    double error = laml::abs(E_new - E_prev);
-    E_prev = E_new;
-    while (error > tol) {
-        E_new = M + e*laml::sin(E_prev);
-        error = laml::abs(E_new - E_prev);
-        E_prev = E_new;
-    }
-
-    return E_new * laml::constants::rad2deg<double>;
+    return kepler_solve(mean_deg * laml::constants::deg2rad<double>, e) * laml::constants::rad2deg<double>;
 }
 
 double true_from_eccentric(const double e, const double eccentric_deg) {
@@ -37,6 +18,10 @@ double true_from_eccentric(const double e, const double eccentric_deg) {
 orbit::orbit(const planet& set_body) : body(set_body), path_buffer_created(false) {}
 
 void orbit::create_from_state_vectors(const vec3d& r_vec, const vec3d& v_vec, double T) {
+    state_position = r_vec;
+    state_velocity = v_vec;
+    state_time = T;
+
     // Reference Frame - ECI
     vec3d I_eci = vec3d(1.0, 0.0, 0.0);
     vec3d J_eci = vec3d(0.0, 1.0, 0.0);
@@ -99,6 +84,11 @@ void orbit::create_from_state_vectors(const vec3d& r_vec, const vec3d& v_vec, do
     laml::transform::create_ZXZ_rotation(perifocal_to_inertial, right_ascension, inclination, argument_of_periapsis);
 }
 
+void orbit::create_from_state_vectors(const vec3d& r_vec, const vec3d& v_vec, const epoch& at) {
+    reference_epoch = at;
+    create_from_state_vectors(r_vec, v_vec, 0.0);
+}
+
 void orbit::create_from_kep_elements(double e, double a, double i, double Omega, double omega, double M0, double T) {
     eccentricity = e;
     semimajor_axis = a;
@@ -116,7 +106,7 @@ void orbit::create_from_kep_elements(double e, double a, double i, double Omega,
 
     // calculate anomalies
     mean_anomaly = mean_anomaly_at_epoch + T*mean_motion;
-    eccentric_anomaly = eccentric_from_mean(eccentricity, mean_anomaly, mean_anomaly);
+    eccentric_anomaly = eccentric_from_mean(eccentricity, mean_anomaly);
     true_anomaly = true_from_eccentric(eccentricity, eccentric_anomaly);
 
     // cheaty way
@@ -130,10 +120,24 @@ void orbit::advance(double dt) {
     if (mean_anomaly > 360.0)
         mean_anomaly -= 360.0;
 
-    eccentric_anomaly = eccentric_from_mean(eccentricity, mean_anomaly, eccentric_anomaly);
+    eccentric_anomaly = eccentric_from_mean(eccentricity, mean_anomaly);
     true_anomaly = true_from_eccentric(eccentricity, eccentric_anomaly);
 }
 
+void orbit::propagate_to(const epoch& when) {
+    mean_anomaly = fmod(mean_anomaly_at_epoch + mean_motion*(when - reference_epoch), 360.0);
+    if (mean_anomaly < 0.0)
+        mean_anomaly += 360.0;
+
+    eccentric_anomaly = eccentric_from_mean(eccentricity, mean_anomaly);
+    true_anomaly = true_from_eccentric(eccentricity, eccentric_anomaly);
+}
+
+bool orbit::state_at(const epoch& when, vec3d* pos_eci, vec3d* vel_eci) {
+    double dt = (when - reference_epoch) - state_time;
+    return kepler_propagate(state_position, state_velocity, dt, body.gm, pos_eci, vel_eci);
+}
+
 void orbit::get_state_vectors(vec3d* pos_eci, vec3d* vel_eci) {
     double h = specific_ang_momentum;
 
@@ -150,28 +154,61 @@ void orbit::get_state_vectors(vec3d* pos_eci, vec3d* vel_eci) {
 }
 
 #include <glad/gl.h>
-void orbit::calc_path_mesh() {
-    double h = specific_ang_momentum;
-
-    // sample the orbit at N points along the orbit for rendering
-    const size_t N = 100;
-    const double spacing = 360.0 / N;
-    vec3f path[N];
-    uint32 indices[N];
-
-    for (int n = 0; n < N; n++) {
-        double theta = spacing*n; // treat at True Anomaly
-
-        // first calculate in perifocal frame
-        double r_mag = (h*h / body.gm) * 1.0 / (1 + eccentricity*laml::cosd(theta));
-        vec3d r_w(r_mag*laml::cosd(theta), r_mag*laml::sind(theta), 0.0);
-
-        path[n] = laml::transform::transform_point(perifocal_to_inertial, r_w);
-        indices[n] = n;
+void orbit::calc_path_mesh(double max_error) {
+    vec3d P = laml::transform::transform_point(perifocal_to_inertial, vec3d(1.0, 0.0, 0.0));
+    vec3d Q = laml::transform::transform_point(perifocal_to_inertial, vec3d(0.0, 1.0, 0.0));
+    vec3d W = laml::cross(P, Q);
+    vec3d e_vec = eccentricity*P;
+
+    if (path_buffer_created) {
+        // rough bound on how far any point of the path moved
+        double moved = laml::abs(semimajor_axis - path_semimajor_axis)
+                     + semimajor_axis*(laml::length(e_vec - path_eccentricity_vector) + laml::length(W - path_normal));
+        bool same_detail = max_error > 0.5*path_max_error && max_error < 2.0*path_max_error;
+        if (moved < max_error && same_detail)
+            return;
+    }
+    path_semimajor_axis = semimajor_axis;
+    path_eccentricity_vector = e_vec;
+    path_normal = W;
+    path_max_error = max_error;
+
+    // A chord of length ds on a curve of curvature k strays k*ds^2/8 from it.
+    // For r = p/(1 + e cos(v)) that error bound gives a true anomaly step of
+    //   dv = sqrt(8*max_error/p) * sqrt(1 + e cos(v)) * (1 + 2e cos(v) + e^2)^(1/4)
+    // which is largest at periapsis and smallest at apoapsis. Steps are kept
+    // within the vertex count range, past which the error is allowed to grow.
+    const double e = eccentricity;
+    const double semi_latus = semimajor_axis*(1.0 - e*e);
+    const double two_pi = 2.0*laml::constants::pi<double>;
+    const double base_step = sqrt(8.0*max_error / semi_latus);
+    const double min_step = two_pi / orbit_path_max_vertices;
+    const double max_step = two_pi / orbit_path_min_vertices;
+
+    uint32 count = 0;
+    double v = 0.0;
+    while (v < two_pi && count < orbit_path_max_vertices) {
+        double c = cos(v);
+        double s = sin(v);
+        double r_mag = semi_latus / (1.0 + e*c);
+        path_points[count++] = vec3f(P*(r_mag*c) + Q*(r_mag*s));
+
+        // step size from the middle of the step, so it doesn't overshoot
+        // where the steps are shrinking
+        double step = base_step * sqrt(1.0 + e*c) * sqrt(sqrt(1.0 + 2.0*e*c + e*e));
+        double cm = cos(v + 0.5*step);
+        step = base_step * sqrt(1.0 + e*cm) * sqrt(sqrt(1.0 + 2.0*e*cm + e*e));
+        v += fmin(fmax(step, min_step), max_step);
     }
+    path_vertex_count = count;
 
     // load points into GPU
+    const uint32 N = orbit_path_max_vertices;
     if (!path_buffer_created) {
+        uint32 indices[N];
+        for (uint32 n = 0; n < N; n++)
+            indices[n] = n;
+
         glGenVertexArrays(1, &path_handle);
         glGenBuffers(1, &path_vbo);
         glGenBuffers(1, &path_ebo);
@@ -179,10 +216,11 @@ void orbit::calc_path_mesh() {
         glBindVertexArray(path_handle);
 
         glBindBuffer(GL_ARRAY_BUFFER, path_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float)*3*N, path[0]._data, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float)*3*N, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*3*count, path_points[0]._data);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, path_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32)*3*N, indices, GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32)*N, indices, GL_STATIC_DRAW);
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
         glEnableVertexAttribArray(0);
@@ -192,9 +230,9 @@ void orbit::calc_path_mesh() {
 
         path_buffer_created = true;
     } else {
-        // only need to buffer new data
+        // allocated for the largest path, so overwrite in place rather than reallocating
         glBindBuffer(GL_ARRAY_BUFFER, path_vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float)*3*N, path[0]._data, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*3*count, path_points[0]._data);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
-}
\ No newline at end of file
+}
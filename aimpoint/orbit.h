@@ -2,6 +2,11 @@
 #include "defines.h"
 
 #include "planet.h"
+#include "epoch.h"
+
+// vertex count range of an orbit's path loop
+const uint32 orbit_path_min_vertices = 16;
+const uint32 orbit_path_max_vertices = 512;
 
 struct orbit {
     orbit(const planet& set_body);
@@ -13,6 +18,7 @@ struct orbit {
     double right_ascension;
     double argument_of_periapsis;
     double mean_anomaly_at_epoch;
+    epoch reference_epoch; // instant of mean_anomaly_at_epoch (T = 0)
 
     // other constant parameters
     double periapsis_alt;
@@ -26,23 +32,51 @@ struct orbit {
     vec3d apsis_line_unit;
     mat3d perifocal_to_inertial;
 
+    // state vector the elements were created from, at reference_epoch + state_time
+    vec3d state_position;
+    vec3d state_velocity;
+    double state_time;
+
     // time varying anomalies
     double true_anomaly;
     double mean_anomaly;
     double eccentric_anomaly;
 
+    // T is seconds since reference_epoch
     void create_from_state_vectors(const vec3d& pos_eci, const vec3d& vel_eci, double T);
+    void create_from_state_vectors(const vec3d& pos_eci, const vec3d& vel_eci, const epoch& at);
     void create_from_kep_elements(double e, double a, double i, double Omega, double omega, double M0, double T);
     void advance(double dt);
+    // anomalies at an absolute time, from the epoch elements (no accumulated error)
+    void propagate_to(const epoch& when);
     void get_state_vectors(vec3d* pos_eci = nullptr, vec3d* vel_eci = nullptr);
+    // two-body state at any time straight from the defining state vector
+    // (universal variables), valid for any conic including e = 0. Returns
+    // false if the iteration did not converge (state is still filled).
+    bool state_at(const epoch& when, vec3d* pos_eci, vec3d* vel_eci);
 
-    void calc_path_mesh();
+    // Samples the path so no chord strays more than max_error (m) from the
+    // conic, with steps sized from the local curvature: dense around
+    // periapsis of eccentric orbits, sparse for distant views. The path is
+    // only re-sampled and updated in place when the conic has moved, or
+    // the error target changed, by more than that, so it is cheap to call
+    // every frame.
+    void calc_path_mesh(double max_error = 1000.0);
 
     uint32 path_handle;
     uint32 path_vbo, path_ebo;
+    uint32 path_vertex_count = 0;
 private:
     // the orbital body
     const planet& body;
 
     bool path_buffer_created;
+
+    // conic the uploaded path was sampled from: a, e*P and the orbit normal
+    // (all regular for circular and equatorial orbits)
+    double path_semimajor_axis;
+    vec3d path_eccentricity_vector;
+    vec3d path_normal;
+    double path_max_error;
+    vec3f path_points[orbit_path_max_vertices];
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "orbit_catalog.h"
+
+#include "kepler.h"
+#include "parallel.h"
+#include "log.h"
+
+#include <cmath>
+
+static const size_t catalog_chunk_size = 4096;
+
+orbit_catalog::orbit_catalog(double new_gm) : gm(new_gm) {}
+
+void orbit_catalog::reserve(size_t capacity) {
+    eccentricity.reserve(capacity);
+    semimajor_axis.reserve(capacity);
+    mean_anomaly_at_epoch.reserve(capacity);
+    epoch_offset.reserve(capacity);
+    mean_motion.reserve(capacity);
+    semiminor_ratio.reserve(capacity);
+    for (int c = 0; c < 3; c++) {
+        P[c].reserve(capacity);
+        Q[c].reserve(capacity);
+        position[c].reserve(capacity);
+        velocity[c].reserve(capacity);
+    }
+    mean_anomaly.reserve(capacity);
+    eccentric_anomaly.reserve(capacity);
+}
+
+void orbit_catalog::clear() {
+    eccentricity.clear();
+    semimajor_axis.clear();
+    mean_anomaly_at_epoch.clear();
+    epoch_offset.clear();
+    mean_motion.clear();
+    semiminor_ratio.clear();
+    for (int c = 0; c < 3; c++) {
+        P[c].clear();
+        Q[c].clear();
+        position[c].clear();
+        velocity[c].clear();
+    }
+    mean_anomaly.clear();
+    eccentric_anomaly.clear();
+}
+
+int32 orbit_catalog::add(double e, double a, double i, double Omega, double omega, double M0, const epoch& element_epoch) {
+    if (e < 0.0 || e >= 1.0 || a <= 0.0) {
+        spdlog::warn("orbit_catalog only holds elliptic orbits (e = {0}, a = {1})", e, a);
+        return -1;
+    }
+
+    const double d2r = laml::constants::deg2rad<double>;
+    double cO = cos(Omega*d2r), sO = sin(Omega*d2r);
+    double ci = cos(i*d2r),     si = sin(i*d2r);
+    double cw = cos(omega*d2r), sw = sin(omega*d2r);
+
+    eccentricity.push_back(e);
+    semimajor_axis.push_back(a);
+    mean_anomaly_at_epoch.push_back(M0*d2r);
+    epoch_offset.push_back(element_epoch - reference);
+    mean_motion.push_back(sqrt(gm / (a*a*a)));
+    semiminor_ratio.push_back(sqrt(1.0 - e*e));
+
+    // first two columns of R3(-Omega) R1(-i) R3(-omega)
+    P[0].push_back( cO*cw - sO*sw*ci);
+    P[1].push_back( sO*cw + cO*sw*ci);
+    P[2].push_back( sw*si);
+    Q[0].push_back(-cO*sw - sO*cw*ci);
+    Q[1].push_back(-sO*sw + cO*cw*ci);
+    Q[2].push_back( cw*si);
+
+    for (int c = 0; c < 3; c++) {
+        position[c].push_back(0.0);
+        velocity[c].push_back(0.0);
+    }
+    mean_anomaly.push_back(0.0);
+    eccentric_anomaly.push_back(0.0);
+
+    return (int32)(eccentricity.size() - 1);
+}
+
+void orbit_catalog::propagate_to(const epoch& when) {
+    const double t = when - reference;
+
+    parallel_for(size(), catalog_chunk_size, [&](size_t begin, size_t end) {
+        const size_t count = end - begin;
+
+        // pass 1: mean anomalies
+        double* M = mean_anomaly.data() + begin;
+        const double* M0 = mean_anomaly_at_epoch.data() + begin;
+        const double* n = mean_motion.data() + begin;
+        const double* t0 = epoch_offset.data() + begin;
+        for (size_t k = 0; k < count; k++) {
+            M[k] = M0[k] + n[k]*(t - t0[k]);
+        }
+
+        // pass 2: Kepler's equation
+        double* E = eccentric_anomaly.data() + begin;
+        kepler_solve_batch(M, eccentricity.data() + begin, E, count);
+
+        // pass 3: perifocal state rotated to inertial
+        const double* e = eccentricity.data() + begin;
+        const double* a = semimajor_axis.data() + begin;
+        const double* b = semiminor_ratio.data() + begin;
+        const double *Px = P[0].data() + begin, *Py = P[1].data() + begin, *Pz = P[2].data() + begin;
+        const double *Qx = Q[0].data() + begin, *Qy = Q[1].data() + begin, *Qz = Q[2].data() + begin;
+        double *rx = position[0].data() + begin, *ry = position[1].data() + begin, *rz = position[2].data() + begin;
+        double *vx = velocity[0].data() + begin, *vy = velocity[1].data() + begin, *vz = velocity[2].data() + begin;
+        for (size_t k = 0; k < count; k++) {
+            double cE = cos(E[k]);
+            double sE = sin(E[k]);
+
+            double xp = a[k]*(cE - e[k]);
+            double yp = a[k]*b[k]*sE;
+
+            // dE/dt = n / (1 - e cosE)
+            double Edot = n[k] / (1.0 - e[k]*cE);
+            double vxp = -a[k]*sE*Edot;
+            double vyp = a[k]*b[k]*cE*Edot;
+
+            rx[k] = xp*Px[k] + yp*Qx[k];
+            ry[k] = xp*Py[k] + yp*Qy[k];
+            rz[k] = xp*Pz[k] + yp*Qz[k];
+            vx[k] = vxp*Px[k] + vyp*Qx[k];
+            vy[k] = vxp*Py[k] + vyp*Qy[k];
+            vz[k] = vxp*Pz[k] + vyp*Qz[k];
+        }
+    });
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "defines.h"
+
+#include "epoch.h"
+
+#include <vector>
+
+// Keplerian elements for many objects in SoA layout, for propagating whole
+// catalogs to a common time. Everything that doesn't depend on time (mean
+// motion, perifocal axes, velocity scale) is computed once in add().
+// Elliptic orbits only; angles in degrees at the interface, radians inside.
+struct orbit_catalog {
+    orbit_catalog(double gm = 3.986004418e14);
+
+    void reserve(size_t capacity);
+    void clear();
+    size_t size() const { return eccentricity.size(); }
+
+    // returns the object index, or -1 if the orbit isn't elliptic
+    int32 add(double e, double a, double i, double Omega, double omega, double M0, const epoch& element_epoch);
+
+    // fills position/velocity (inertial, m and m/s) for every object
+    void propagate_to(const epoch& when);
+
+    double gm;
+    epoch reference; // element epochs are stored as offsets from this
+
+    // elements
+    std::vector<double> eccentricity;
+    std::vector<double> semimajor_axis;
+    std::vector<double> mean_anomaly_at_epoch; // rad
+    std::vector<double> epoch_offset;          // s from reference
+
+    // derived
+    std::vector<double> mean_motion;  // rad/s
+    std::vector<double> semiminor_ratio; // sqrt(1 - e^2)
+    std::vector<double> P[3];         // perifocal x (periapsis) axis
+    std::vector<double> Q[3];         // perifocal y axis
+
+    // outputs
+    std::vector<double> position[3];
+    std::vector<double> velocity[3];
+
+private:
+    // per-object scratch for the batched passes
+    std::vector<double> mean_anomaly;
+    std::vector<double> eccentric_anomaly;
+};
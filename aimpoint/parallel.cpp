@@ -0,0 +1,154 @@
+#include "parallel.h"
+
+#include "log.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct job_pool {
+    job_pool();
+    ~job_pool();
+
+    void run(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& fn);
+
+    uint32 num_threads; // including the caller
+
+private:
+    void worker_loop();
+    void work_chunks();
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stop = false;
+
+    // current job, only changed while no worker is inside it
+    const std::function<void(size_t, size_t)>* fn = nullptr;
+    size_t count = 0;
+    size_t chunk_size = 1;
+    size_t num_chunks = 0;
+    uint64 generation = 0;
+    uint32 active = 0; // workers that picked up the current job
+
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> chunks_done{0};
+};
+
+static thread_local bool inside_parallel_for = false;
+
+job_pool::job_pool() {
+    uint32 hw = std::thread::hardware_concurrency();
+    num_threads = hw > 0 ? hw : 1;
+
+    for (uint32 n = 1; n < num_threads; n++) {
+        workers.emplace_back(&job_pool::worker_loop, this);
+    }
+    spdlog::info("parallel_for using {0} threads", num_threads);
+}
+
+job_pool::~job_pool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void job_pool::work_chunks() {
+    size_t chunk;
+    while ((chunk = next_chunk.fetch_add(1)) < num_chunks) {
+        size_t begin = chunk * chunk_size;
+        size_t end = begin + chunk_size < count ? begin + chunk_size : count;
+        (*fn)(begin, end);
+
+        if (chunks_done.fetch_add(1) + 1 == num_chunks) {
+            std::lock_guard<std::mutex> guard(lock);
+            finished.notify_all();
+        }
+    }
+}
+
+void job_pool::worker_loop() {
+    inside_parallel_for = true;
+    uint64 seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stop || generation != seen_generation; });
+            if (stop)
+                return;
+            seen_generation = generation;
+            active++;
+        }
+
+        work_chunks();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            active--;
+        }
+        finished.notify_all();
+    }
+}
+
+void job_pool::run(size_t new_count, size_t new_chunk_size, const std::function<void(size_t, size_t)>& new_fn) {
+    {
+        // a worker that woke late may still be draining the previous job
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [&] { return active == 0; });
+
+        fn = &new_fn;
+        count = new_count;
+        chunk_size = new_chunk_size;
+        num_chunks = (new_count + new_chunk_size - 1) / new_chunk_size;
+        next_chunk = 0;
+        chunks_done = 0;
+        generation++;
+    }
+    wake.notify_all();
+
+    inside_parallel_for = true;
+    work_chunks();
+    inside_parallel_for = false;
+
+    // wait for the last chunk, and for every worker to leave the job before
+    // it can be replaced
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&] { return chunks_done == num_chunks && active == 0; });
+    fn = nullptr;
+}
+
+static job_pool& get_pool() {
+    static job_pool pool;
+    return pool;
+}
+
+static std::mutex submit_lock;
+
+uint32 parallel_thread_count() {
+    return get_pool().num_threads;
+}
+
+void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t begin, size_t end)>& fn) {
+    if (count == 0)
+        return;
+    if (chunk_size == 0)
+        chunk_size = 1;
+
+    // small jobs, nested calls and concurrent submitters just run inline
+    if (count <= chunk_size || inside_parallel_for || !submit_lock.try_lock()) {
+        fn(0, count);
+        return;
+    }
+
+    get_pool().run(count, chunk_size, fn);
+    submit_lock.unlock();
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "defines.h"
+
+#include <functional>
+
+// Number of threads parallel_for spreads work over (workers + the caller)
+uint32 parallel_thread_count();
+
+// Calls fn(begin, end) over [0, count) in chunks of chunk_size, spread over a
+// persistent pool of worker threads. The calling thread works too, and the
+// call blocks until every chunk is done. Calls from inside fn (or from two
+// threads at once) run serially rather than deadlocking.
+void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t begin, size_t end)>& fn);
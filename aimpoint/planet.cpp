@@ -1,6 +1,6 @@
 #include "planet.h"
 
-planet::planet() : mat_inertial_to_fixed(1.0f) {
+planet::planet() : mat_inertial_to_fixed_highp(1.0), mat_fixed_to_inertial_highp(1.0), mat_inertial_to_fixed(1.0f) {
     //rotation_rate *= .01*86400;
     //gm = 1.0;
     //eccentricity_sq = 0;
@@ -11,28 +11,40 @@ planet::planet() : mat_inertial_to_fixed(1.0f) {
     mat_fixed_to_inertial = laml::transpose(mat_inertial_to_fixed);
 }
 
-void planet::load_mesh() {
+void planet::load_mesh(asset_loader* assets) {
     double polar_radius = equatorial_radius * sqrt(1 - eccentricity_sq);
+    if (assets) {
+        assets->load_mesh(&mesh, "data/unit_sphere.bmesh", equatorial_radius, equatorial_radius, polar_radius);
+        assets->load_texture(&diffuse, "data/earth.jpg");
+        return;
+    }
+
     //mesh.load_from_mesh_file("data/unit_sphere.mesh", equatorial_radius);
-    mesh.load_from_mesh_file("data/unit_sphere.mesh", equatorial_radius, equatorial_radius, polar_radius);
+    mesh.load_from_baked_file("data/unit_sphere.bmesh", equatorial_radius, equatorial_radius, polar_radius);
     //mesh.load_from_mesh_file("data/blahaj.mesh", equatorial_radius*0.02f);
 
     diffuse.load_texture_file("data/earth.jpg");
 }
 
-void planet::update(double t, double dt) {
-    yaw += rotation_rate * dt;
+mat3d planet::orientation_at(double t) {
+    if (orientation)
+        return orientation->inertial_to_fixed(t);
 
-    const double d360 = 360.0 * laml::constants::deg2rad<double>;
-    while (yaw > d360)
-        yaw -= d360;
+    // evaluated from t directly rather than accumulated, so it doesn't drift
+    double angle = fmod(rotation_rate * t, 2.0*laml::constants::pi<double>);
+    double cy = laml::cos(angle);
+    double sy = laml::sin(angle);
+    return mat3d(cy, -sy, 0, sy, cy, 0, 0, 0, 1);
+}
 
-    double cy = laml::cos(yaw);
-    double sy = laml::sin(yaw);
+void planet::update(double t, double dt) {
+    mat_inertial_to_fixed_highp = orientation_at(t + dt);
+    mat_fixed_to_inertial_highp = laml::transpose(mat_inertial_to_fixed_highp);
 
-    //inertial_to_fixed = laml::Mat3(cy, -sy, 0, 0, 0, 1, sy, cy, 0);
-    //mat_inertial_to_fixed = laml::Mat3(cy, sy, 0, -sy, cy, 0, 0, 0, 1);
-    mat_inertial_to_fixed = laml::Mat3(cy, -sy, 0, sy, cy, 0, 0, 0, 1);
+    const mat3d& m = mat_inertial_to_fixed_highp;
+    mat_inertial_to_fixed = laml::Mat3((float)m.c_11, (float)m.c_21, (float)m.c_31,
+                                       (float)m.c_12, (float)m.c_22, (float)m.c_32,
+                                       (float)m.c_13, (float)m.c_23, (float)m.c_33);
     mat_fixed_to_inertial = laml::transpose(mat_inertial_to_fixed);
 }
 
@@ -51,122 +63,114 @@ vec3d planet::lla_to_fixed(double lat, double lon, double alt) {
         ((1 - eccentricity_sq)*N + alt)*slat);
 }
 void planet::fixed_to_lla(vec3d pos_fixed, double *lat_out, double *lon_out, double *alt_out) {
-    // Bowring's method
-    double X = pos_fixed.x;
-    double Y = pos_fixed.y;
-    double Z = pos_fixed.z;
-
-    *lon_out = laml::atan2d(Y, X);
-    double s = sqrt(X*X + Y*Y);
-    double f = 1 - sqrt(1 - eccentricity_sq);
-
-    // initial guess
-    double red_lat = laml::atand(Z / ((1-f)*2));
-    double c_red_lat_3 = laml::cosd(red_lat); c_red_lat_3 = c_red_lat_3*c_red_lat_3*c_red_lat_3;
-    double s_red_lat_3 = laml::sind(red_lat); s_red_lat_3 = s_red_lat_3*s_red_lat_3*s_red_lat_3;
-    double geo_lat = laml::atand((Z + eccentricity_sq*(1-f)*equatorial_radius*(s_red_lat_3)/(1 - eccentricity_sq)) / (s - eccentricity_sq*equatorial_radius*(c_red_lat_3)));
-
-    double error = 1e5;
-    uint32 iterations = 0;
-    const double tol = 1e-9;
-    const uint32 max_iterations = 5;
-    while (abs(error) > tol && iterations < max_iterations) {
-        red_lat = laml::atand((1-f)*laml::sind(geo_lat) / laml::cosd(geo_lat));
-        c_red_lat_3 = laml::cosd(red_lat); c_red_lat_3 = c_red_lat_3*c_red_lat_3*c_red_lat_3;
-        s_red_lat_3 = laml::sind(red_lat); s_red_lat_3 = s_red_lat_3*s_red_lat_3*s_red_lat_3;
-        double new_geo_lat = laml::atand((Z + eccentricity_sq*(1-f)*equatorial_radius*(s_red_lat_3)/(1 - eccentricity_sq)) / (s - eccentricity_sq*equatorial_radius*(c_red_lat_3)));
-        error = geo_lat - new_geo_lat;
-        geo_lat = new_geo_lat;
-        iterations++;
-    }
-    *lat_out = geo_lat;
-    
-    double s_lat = laml::sind(geo_lat);
-    double N = equatorial_radius / sqrt(1 - eccentricity_sq*(s_lat*s_lat));
-    *alt_out = s*laml::cosd(geo_lat) + (Z + eccentricity_sq*N*laml::sind(geo_lat))*laml::sind(geo_lat) - N;
+    double lat, lon;
+    fixed_to_geodetic(pos_fixed, &lat, &lon, alt_out);
+    *lat_out = lat * laml::constants::rad2deg<double>;
+    *lon_out = lon * laml::constants::rad2deg<double>;
 }
 
-vec3d planet::fixed_to_inertial(vec3d pos_fixed) {
-    double cy = laml::cos(yaw);
-    double sy = laml::sin(yaw);
-    return vec3d(cy*pos_fixed.x - sy*pos_fixed.y, sy*pos_fixed.x + cy*pos_fixed.y, pos_fixed.z);
-}
-vec3d planet::fixed_to_inertial(vec3d pos_fixed, double t) {
-    double cy = laml::cos(rotation_rate * t);
-    double sy = laml::sin(rotation_rate * t);
-    return vec3d(cy*pos_fixed.x - sy*pos_fixed.y, sy*pos_fixed.x + cy*pos_fixed.y, pos_fixed.z);
+// Vermeille's closed form (J. Geodesy 76, 2002). No iteration and only one
+// cbrt, three sqrt and two atan2. Exact to round-off (< 1e-15 rad, < 1 nm in
+// height) everywhere outside the evolute of the meridian ellipse, i.e. for
+// anything more than ~43 km from the Earth's center. Inside it the result is
+// still finite but degrades.
+static inline void vermeille(double X, double Y, double Z, double a, double e2,
+                             double* lat, double* lon, double* alt) {
+    const double e4 = e2*e2;
+    const double inv_a2 = 1.0 / (a*a);
+
+    double s2 = X*X + Y*Y;
+    double p = s2 * inv_a2;
+    double q = (1.0 - e2) * inv_a2 * Z*Z;
+    double r = (p + q - e4) * (1.0 / 6.0);
+    r = r > 1.0e-30 ? r : 1.0e-30;
+
+    double s = e4*p*q / (4.0*r*r*r);
+    double ss = s*(2.0 + s);
+    double t = cbrt(1.0 + s + sqrt(ss > 0.0 ? ss : 0.0));
+    double u = r*(1.0 + t + 1.0/t);
+    double v = sqrt(u*u + e4*q);
+    double w = e2*(u + v - q) / (2.0*v);
+    double k = sqrt(u + v + w*w) - w;
+
+    double rho = sqrt(s2);
+    double D = k*rho / (k + e2);
+    double dz = sqrt(D*D + Z*Z);
+
+    *lat = 2.0*atan2(Z, D + dz);
+    *lon = atan2(Y, X);
+    *alt = (k + e2 - 1.0) / k * dz;
 }
-void planet::fixed_to_inertial(vec3d pos_fixed, vec3d vel_fixed, vec3d* pos_inertial, vec3d* vel_inertial) {
-    double cy = laml::cos(yaw);
-    double sy = laml::sin(yaw);
-
-    vec3d pos(cy*pos_fixed.x - sy*pos_fixed.y, sy*pos_fixed.x + cy*pos_fixed.y, pos_fixed.z);
-    vec3d vel(cy*vel_fixed.x - sy*vel_fixed.y, sy*vel_fixed.x + cy*vel_fixed.y, vel_fixed.z);
 
-    vec3d omega(0.0, 0.0, rotation_rate);
-    double r = laml::length(pos);
-
-    vel = laml::cross(omega, pos)/r + vel;
+void planet::fixed_to_geodetic(vec3d pos_fixed, double *lat_out, double *lon_out, double *alt_out) {
+    vermeille(pos_fixed.x, pos_fixed.y, pos_fixed.z, equatorial_radius, eccentricity_sq, lat_out, lon_out, alt_out);
+}
 
-    *pos_inertial = pos;
-    *vel_inertial = vel;
+void planet::fixed_to_geodetic_batch(const double* x, const double* y, const double* z, size_t count,
+                                     double* lat, double* lon, double* alt) {
+    // straight-line body; vectorizes where the compiler has vector cbrt/atan2
+    // (e.g. -O3 -ffast-math with glibc libmvec), otherwise same as the scalar loop
+    const double a = equatorial_radius;
+    const double e2 = eccentricity_sq;
+    for (size_t n = 0; n < count; n++) {
+        vermeille(x[n], y[n], z[n], a, e2, &lat[n], &lon[n], &alt[n]);
+    }
 }
-void planet::fixed_to_inertial(vec3d pos_fixed, vec3d vel_fixed, double t, vec3d* pos_inertial, vec3d* vel_inertial) {
-    double cy = laml::cos(rotation_rate * t);
-    double sy = laml::sin(rotation_rate * t);
 
-    vec3d pos(cy*pos_fixed.x - sy*pos_fixed.y, sy*pos_fixed.x + cy*pos_fixed.y, pos_fixed.z);
-    vec3d vel(cy*vel_fixed.x - sy*vel_fixed.y, sy*vel_fixed.x + cy*vel_fixed.y, vel_fixed.z);
+double planet::geocentric_altitude(vec3d pos) {
+    // ellipsoid radius to first order in flattening at the geocentric latitude.
+    // Within ~100 m of the geodetic height, plenty for density lookups.
+    if (flattening_eccentricity_sq != eccentricity_sq) {
+        flattening = 1 - sqrt(1 - eccentricity_sq);
+        flattening_eccentricity_sq = eccentricity_sq;
+    }
 
-    vec3d omega(0.0, 0.0, rotation_rate);
     double r = laml::length(pos);
+    double s_lat = pos.z / r;
+    return r - equatorial_radius*(1.0 - flattening*s_lat*s_lat);
+}
 
-    vel = laml::cross(pos, omega)/r + vel;
-
-    *pos_inertial = pos;
-    *vel_inertial = vel;
+vec3d planet::fixed_to_inertial(vec3d pos_fixed) {
+    return laml::transform::transform_point(mat_fixed_to_inertial_highp, pos_fixed);
+}
+vec3d planet::fixed_to_inertial(vec3d pos_fixed, double t) {
+    return laml::transform::transform_point(laml::transpose(orientation_at(t)), pos_fixed);
+}
+// v_inertial = M^T (v_fixed + w x r_fixed), with w about the fixed z axis.
+// (The slow precession/nutation rates are ignored.)
+static void rotate_state_to_inertial(const mat3d& fixed_to_inertial, double rate, vec3d pos_fixed, vec3d vel_fixed,
+                                     vec3d* pos_inertial, vec3d* vel_inertial) {
+    vec3d w_cross_r(-rate*pos_fixed.y, rate*pos_fixed.x, 0.0);
+    *pos_inertial = laml::transform::transform_point(fixed_to_inertial, pos_fixed);
+    *vel_inertial = laml::transform::transform_point(fixed_to_inertial, vel_fixed + w_cross_r);
+}
+// v_fixed = M v_inertial - w x r_fixed
+static void rotate_state_to_fixed(const mat3d& inertial_to_fixed, double rate, vec3d pos_inertial, vec3d vel_inertial,
+                                  vec3d* pos_fixed, vec3d* vel_fixed) {
+    vec3d pos = laml::transform::transform_point(inertial_to_fixed, pos_inertial);
+    vec3d w_cross_r(-rate*pos.y, rate*pos.x, 0.0);
+    *pos_fixed = pos;
+    *vel_fixed = laml::transform::transform_point(inertial_to_fixed, vel_inertial) - w_cross_r;
+}
+void planet::fixed_to_inertial(vec3d pos_fixed, vec3d vel_fixed, vec3d* pos_inertial, vec3d* vel_inertial) {
+    rotate_state_to_inertial(mat_fixed_to_inertial_highp, rotation_rate, pos_fixed, vel_fixed, pos_inertial, vel_inertial);
+}
+void planet::fixed_to_inertial(vec3d pos_fixed, vec3d vel_fixed, double t, vec3d* pos_inertial, vec3d* vel_inertial) {
+    rotate_state_to_inertial(laml::transpose(orientation_at(t)), rotation_rate, pos_fixed, vel_fixed, pos_inertial, vel_inertial);
 }
 
 
 vec3d planet::inertial_to_fixed(vec3d pos_inertial){
-    double cy =  laml::cos(yaw);
-    double sy = -laml::sin(yaw);
-    return vec3d(cy*pos_inertial.x - sy*pos_inertial.y, sy*pos_inertial.x + cy*pos_inertial.y, pos_inertial.z);
+    return laml::transform::transform_point(mat_inertial_to_fixed_highp, pos_inertial);
 }
 vec3d planet::inertial_to_fixed(vec3d pos_inertial, double t){
-    double cy =  laml::cos(rotation_rate * t);
-    double sy = -laml::sin(rotation_rate * t);
-    return vec3d(cy*pos_inertial.x - sy*pos_inertial.y, sy*pos_inertial.x + cy*pos_inertial.y, pos_inertial.z);
+    return laml::transform::transform_point(orientation_at(t), pos_inertial);
 }
 void  planet::inertial_to_fixed(vec3d pos_inertial, vec3d vel_inertial, vec3d* pos_fixed, vec3d* vel_fixed){
-    double cy =  laml::cos(yaw);
-    double sy = -laml::sin(yaw);
-
-    vec3d pos(cy*pos_inertial.x - sy*pos_inertial.y, sy*pos_inertial.x + cy*pos_inertial.y, pos_inertial.z);
-    vec3d vel(cy*vel_inertial.x - sy*vel_inertial.y, sy*vel_inertial.x + cy*vel_inertial.y, vel_inertial.z);
-
-    vec3d omega(0.0, 0.0, rotation_rate);
-    double r = laml::length(pos);
-
-    vel = vel - laml::cross(omega, pos)/r;
-
-    *pos_fixed = pos;
-    *vel_fixed = vel;
+    rotate_state_to_fixed(mat_inertial_to_fixed_highp, rotation_rate, pos_inertial, vel_inertial, pos_fixed, vel_fixed);
 }
 void planet::inertial_to_fixed(vec3d pos_inertial, vec3d vel_inertial, double t, vec3d* pos_fixed, vec3d* vel_fixed) {
-    double cy =  laml::cos(rotation_rate*t);
-    double sy = -laml::sin(rotation_rate*t);
-
-    vec3d pos(cy*pos_inertial.x - sy*pos_inertial.y, sy*pos_inertial.x + cy*pos_inertial.y, pos_inertial.z);
-    vec3d vel(cy*vel_inertial.x - sy*vel_inertial.y, sy*vel_inertial.x + cy*vel_inertial.y, vel_inertial.z);
-
-    vec3d omega(0.0, 0.0, rotation_rate);
-    double r = laml::length(pos);
-
-    vel = vel - laml::cross(omega, pos)/r;
-
-    *pos_fixed = pos;
-    *vel_fixed = vel;
+    rotate_state_to_fixed(orientation_at(t), rotation_rate, pos_inertial, vel_inertial, pos_fixed, vel_fixed);
 }
 
 
@@ -216,5 +220,6 @@ mat3d planet::create_local_inertial(double lat, double lon, double az) {
 
     mat3d LCI2ECI = laml::mul(laml::transpose(ECI2NED), laml::transpose(NED2LCF));
 
-    return LCI2ECI;
+    // above is relative to the fixed frame, the local frame is inertial from t = 0
+    return laml::mul(laml::transpose(orientation_at(0.0)), LCI2ECI);
 }
\ No newline at end of file
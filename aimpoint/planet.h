@@ -3,15 +3,22 @@
 
 #include "render/mesh.h"
 #include "render/texture.h"
+#include "render/asset_loader.h"
+
+#include "earth_orientation.h"
 
 struct planet {
     planet();
 
-    void load_mesh();
+    void load_mesh(asset_loader* assets = nullptr); // in the background if given a loader
     void update(double t, double dt);
 
     vec3d lla_to_fixed(double lat, double lon, double alt); // in deg
     void fixed_to_lla(vec3d pos_fixed, double *lat, double *lon, double *alt); // in deg
+    void fixed_to_geodetic(vec3d pos_fixed, double *lat, double *lon, double *alt); // in rad
+    void fixed_to_geodetic_batch(const double* x, const double* y, const double* z, size_t count,
+                                 double* lat, double* lon, double* alt); // in rad, SoA
+    double geocentric_altitude(vec3d pos); // approx. height above the ellipsoid, any Earth-centered frame
 
     vec3d fixed_to_inertial(vec3d pos_fixed);
     vec3d fixed_to_inertial(vec3d pos_fixed, double t);
@@ -23,6 +30,8 @@ struct planet {
     void  inertial_to_fixed(vec3d pos_inertial, vec3d vel_inertial, vec3d* pos_fixed, vec3d* vel_fixed);
     void  inertial_to_fixed(vec3d pos_inertial, vec3d vel_inertial, double t, vec3d* pos_fixed, vec3d* vel_fixed);
 
+    mat3d orientation_at(double t); // inertial to fixed rotation at sim time t
+
     vec3d gravity(vec3d pos_inertial);
     vec3d gravity_J2(vec3d pos_inertial);
 
@@ -36,10 +45,21 @@ struct planet {
     double rotation_rate = 72.92115e-6;        // rad/s
     double equatorial_radius = 6378137.0;      // m
     double eccentricity_sq = 6.69437999014e-3; // 
-    double yaw = 0.0;                          // rad
     double gm = 3.986004418e14;                // m^3/s^2
     double J2 = 1.75553e25;                    // 
 
+    // from eccentricity_sq for geocentric_altitude, redone only when that changes
+    double flattening = 0.0;
+    double flattening_eccentricity_sq = -1.0;
+
+    // optional precession/nutation/polar motion, otherwise a uniform spin about z
+    earth_orientation* orientation = nullptr;
+
+    // current orientation, set by update()
+    mat3d mat_inertial_to_fixed_highp;
+    mat3d mat_fixed_to_inertial_highp;
+
+    // single precision copies for rendering
     laml::Mat3 mat_inertial_to_fixed;
     laml::Mat3 mat_fixed_to_inertial;
 };
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "porkchop.h"
+
+#include "lambert.h"
+#include "parallel.h"
+#include "log.h"
+
+#include <chrono>
+
+// departure columns per parallel_for chunk
+static const size_t column_chunk_size = 4;
+
+epoch porkchop::departure_time(uint32 i) const {
+    double step = departure_steps > 1 ? departure_span / (departure_steps - 1) : 0.0;
+    return departure_start + step*i;
+}
+
+epoch porkchop::arrival_time(uint32 j) const {
+    double step = arrival_steps > 1 ? arrival_span / (arrival_steps - 1) : 0.0;
+    return arrival_start + step*j;
+}
+
+bool porkchop::sample_endpoints(const jpl_ephemeris& de, de_target from, de_target to, de_target center) {
+    departure_position.resize(departure_steps);
+    departure_velocity.resize(departure_steps);
+    arrival_position.resize(arrival_steps);
+    arrival_velocity.resize(arrival_steps);
+
+    for (uint32 i = 0; i < departure_steps; i++) {
+        double jd_whole, jd_frac;
+        departure_time(i).to_jd(TIME_SCALE_TDB, &jd_whole, &jd_frac);
+        if (!de.state(from, center, jd_whole, jd_frac, &departure_position[i], &departure_velocity[i])) {
+            spdlog::error("Porkchop departure {0} is outside the ephemeris", i);
+            return false;
+        }
+    }
+    for (uint32 j = 0; j < arrival_steps; j++) {
+        double jd_whole, jd_frac;
+        arrival_time(j).to_jd(TIME_SCALE_TDB, &jd_whole, &jd_frac);
+        if (!de.state(to, center, jd_whole, jd_frac, &arrival_position[j], &arrival_velocity[j])) {
+            spdlog::error("Porkchop arrival {0} is outside the ephemeris", j);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool porkchop::sample_endpoints(orbit& from, orbit& to) {
+    departure_position.resize(departure_steps);
+    departure_velocity.resize(departure_steps);
+    arrival_position.resize(arrival_steps);
+    arrival_velocity.resize(arrival_steps);
+
+    for (uint32 i = 0; i < departure_steps; i++) {
+        if (!from.state_at(departure_time(i), &departure_position[i], &departure_velocity[i])) {
+            spdlog::error("Porkchop departure {0} did not converge", i);
+            return false;
+        }
+    }
+    for (uint32 j = 0; j < arrival_steps; j++) {
+        if (!to.state_at(arrival_time(j), &arrival_position[j], &arrival_velocity[j])) {
+            spdlog::error("Porkchop arrival {0} did not converge", j);
+            return false;
+        }
+    }
+    return true;
+}
+
+void porkchop::run() {
+    if (departure_position.size() != departure_steps || arrival_position.size() != arrival_steps) {
+        spdlog::error("Porkchop endpoints not sampled for a {0}x{1} grid", departure_steps, arrival_steps);
+        return;
+    }
+
+    size_t num_cells = (size_t)departure_steps*arrival_steps;
+    departure_c3.assign(num_cells, porkchop_no_solution);
+    arrival_vinf.assign(num_cells, porkchop_no_solution);
+    total_vinf.assign(num_cells, porkchop_no_solution);
+
+    const uint32 revolutions = max_revolutions < 31 ? max_revolutions : 31;
+    const double departure_step = departure_steps > 1 ? departure_span / (departure_steps - 1) : 0.0;
+    const double arrival_step = arrival_steps > 1 ? arrival_span / (arrival_steps - 1) : 0.0;
+    const double arrival_offset = arrival_start - departure_start;
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t num_chunks = (departure_steps + column_chunk_size - 1) / column_chunk_size;
+    std::vector<uint64> chunk_solves(num_chunks, 0);
+
+    parallel_for(departure_steps, column_chunk_size, [&](size_t begin, size_t end) {
+        vec3d v1[63], v2[63];
+        uint64 solves = 0;
+
+        for (size_t i = begin; i < end; i++) {
+            const vec3d& r1 = departure_position[i];
+            const vec3d& planet_v1 = departure_velocity[i];
+
+            for (uint32 j = 0; j < arrival_steps; j++) {
+                double tof = arrival_offset + arrival_step*j - departure_step*i;
+                if (tof <= 0.0)
+                    continue;
+
+                uint32 n = lambert_solve(r1, arrival_position[j], tof, gm, false, revolutions, v1, v2);
+                solves++;
+
+                size_t c = cell((uint32)i, j);
+                for (uint32 k = 0; k < n; k++) {
+                    double vinf1 = laml::length(v1[k] - planet_v1);
+                    double vinf2 = laml::length(v2[k] - arrival_velocity[j]);
+                    if (vinf1 + vinf2 < total_vinf[c]) {
+                        total_vinf[c] = vinf1 + vinf2;
+                        departure_c3[c] = vinf1*vinf1;
+                        arrival_vinf[c] = vinf2;
+                    }
+                }
+            }
+        }
+        chunk_solves[begin / column_chunk_size] = solves;
+    });
+
+    solve_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    num_solves = 0;
+    for (uint64 s : chunk_solves)
+        num_solves += s;
+
+    best_total_vinf = porkchop_no_solution;
+    for (uint32 i = 0; i < departure_steps; i++) {
+        for (uint32 j = 0; j < arrival_steps; j++) {
+            size_t c = cell(i, j);
+            if (total_vinf[c] < best_total_vinf) {
+                best_total_vinf = total_vinf[c];
+                best_departure = i;
+                best_arrival = j;
+            }
+        }
+    }
+
+    spdlog::info("Porkchop {0}x{1}: {2} Lambert solves in {3:.1f} ms ({4:.2f} M/s), best {5:.3f} km/s total v_inf",
+                 departure_steps, arrival_steps, num_solves, solve_ms,
+                 solve_ms > 0.0 ? num_solves / solve_ms * 1.0e-3 : 0.0, best_total_vinf * 1.0e-3);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "defines.h"
+
+#include "epoch.h"
+#include "jpl_ephemeris.h"
+#include "orbit.h"
+
+#include <vector>
+
+// value of cells with no transfer (arrival before departure, no solution)
+const double porkchop_no_solution = 1.0e30;
+
+// Launch date / arrival date grid of Lambert transfers between two bodies.
+//
+// Endpoint states are sampled once per grid row and column, then every cell
+// is solved on parallel_for. With max_revolutions > 0 each cell keeps the
+// cheapest of the zero and multi revolution solutions.
+struct porkchop {
+    epoch departure_start;
+    double departure_span = 0.0;  // s
+    epoch arrival_start;
+    double arrival_span = 0.0;    // s
+    uint32 departure_steps = 200;
+    uint32 arrival_steps = 200;
+
+    double gm = 1.32712440018e20; // central body, m^3/s^2
+    uint32 max_revolutions = 0;
+
+    // states of two DE targets relative to center (ICRF, heliocentric by default)
+    bool sample_endpoints(const jpl_ephemeris& de, de_target from, de_target to, de_target center = DE_SUN);
+    // two-body states of two orbits about the same body
+    bool sample_endpoints(orbit& from, orbit& to);
+
+    void run();
+
+    epoch departure_time(uint32 i) const;
+    epoch arrival_time(uint32 j) const;
+
+    std::vector<vec3d> departure_position, departure_velocity; // per departure step
+    std::vector<vec3d> arrival_position, arrival_velocity;     // per arrival step
+
+    // departure_steps wide, arrival_steps tall, latest arrival in the first
+    // row (the order ImPlot draws heatmap rows in). cell(i, j) indexes them.
+    std::vector<double> departure_c3;  // m^2/s^2
+    std::vector<double> arrival_vinf;  // m/s
+    std::vector<double> total_vinf;    // m/s, departure + arrival excess speed
+    size_t cell(uint32 i, uint32 j) const { return (size_t)(arrival_steps - 1 - j)*departure_steps + i; }
+
+    // cheapest cell by total_vinf
+    uint32 best_departure = 0, best_arrival = 0;
+    double best_total_vinf = porkchop_no_solution;
+
+    uint64 num_solves = 0;
+    double solve_ms = 0.0;
+};
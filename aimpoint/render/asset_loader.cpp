@@ -0,0 +1,187 @@
+#include "asset_loader.h"
+
+#include "parallel.h"
+#include "log.h"
+#include "startup_profile.h"
+
+#include "stb/stb_image.h"
+
+// decoding is mostly I/O and inflate, a few threads is plenty
+static const uint32 max_asset_threads = 4;
+
+asset_loader::~asset_loader() {
+    shutdown();
+}
+
+void asset_loader::init() {
+    const uint8 white[4] = { 255, 255, 255, 255 };
+    placeholder.upload(white, 1, 1, 4);
+
+    // set once here, stbi keeps it in a global
+    stbi_set_flip_vertically_on_load(true);
+
+    uint32 num_threads = parallel_thread_count() > 1 ? parallel_thread_count() - 1 : 1;
+    if (num_threads > max_asset_threads)
+        num_threads = max_asset_threads;
+
+    stopping = false;
+    for (uint32 n = 0; n < num_threads; n++)
+        workers.emplace_back(&asset_loader::worker_loop, this);
+}
+
+void asset_loader::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_signal.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    for (auto& entry : assets) {
+        entry.second->image.release();
+        entry.second->file.close();
+    }
+    jobs.clear();
+    finished.clear();
+    num_pending = 0;
+}
+
+void asset_loader::load_texture(texture* target, const char* filename) {
+    asset* a = request(filename, false);
+    if (a->finalized) {
+        *target = a->failed ? placeholder : a->tex;
+        return;
+    }
+
+    *target = placeholder;
+    a->texture_targets.push_back(target);
+}
+
+void asset_loader::load_mesh(triangle_mesh* target, const char* filename, float scale_factor) {
+    load_mesh(target, filename, scale_factor, scale_factor, scale_factor);
+}
+void asset_loader::load_mesh(triangle_mesh* target, const char* filename, float x_scale_factor, float y_scale_factor, float z_scale_factor) {
+    asset* a = request(filename, true);
+    if (a->finalized) {
+        if (!a->failed)
+            target->share_from(a->mesh, x_scale_factor, y_scale_factor, z_scale_factor);
+        return;
+    }
+
+    a->mesh_targets.push_back({ target, vec3f(x_scale_factor, y_scale_factor, z_scale_factor) });
+}
+
+asset_loader::asset* asset_loader::request(const char* filename, bool is_mesh) {
+    auto found = assets.find(filename);
+    if (found != assets.end())
+        return found->second.get();
+
+    std::unique_ptr<asset> a(new asset);
+    a->path = filename;
+    a->is_mesh = is_mesh;
+    asset* raw = a.get();
+    assets.emplace(a->path, std::move(a));
+
+    num_pending++;
+    if (workers.empty()) {
+        // not started, load on this thread and upload at the next finalize
+        decode(raw);
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        finished.push_back(raw);
+        return raw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        jobs.push_back(raw);
+    }
+    queue_signal.notify_one();
+    return raw;
+}
+
+void asset_loader::worker_loop() {
+    for (;;) {
+        asset* a;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_signal.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            a = jobs.front();
+            jobs.pop_front();
+        }
+
+        decode(a);
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        finished.push_back(a);
+    }
+}
+
+// no GL in here
+void asset_loader::decode(asset* a) {
+    startup_timer timer("load", a->path.c_str());
+
+    if (a->is_mesh) {
+        if (!triangle_mesh::open_baked_file(a->file, a->path.c_str())) {
+            a->failed = true;
+            return;
+        }
+
+        // fault the pages in now, so the upload doesn't wait on the disk
+        const uint8* data = a->file.get_data();
+        volatile uint8 sink = 0;
+        for (uint64 offset = 0; offset < a->file.get_size(); offset += 4096)
+            sink ^= data[offset];
+        (void)sink;
+    } else {
+        a->failed = !load_texture_data(a->image, a->path.c_str());
+    }
+}
+
+void asset_loader::finalize() {
+    std::vector<asset*> done;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        done.swap(finished);
+    }
+
+    for (asset* a : done) {
+        num_pending--;
+        a->finalized = true;
+
+        if (a->failed) {
+            spdlog::error("Could not load '{0}'", a->path);
+            a->texture_targets.clear();
+            a->mesh_targets.clear();
+            continue;
+        }
+
+        startup_timer timer("upload", a->path.c_str());
+        if (a->is_mesh) {
+            a->mesh.upload_baked(a->file, 1.0f, 1.0f, 1.0f);
+            a->file.close();
+            for (const mesh_target& t : a->mesh_targets)
+                t.mesh->share_from(a->mesh, t.scale.x, t.scale.y, t.scale.z);
+            a->mesh_targets.clear();
+        } else {
+            a->tex.upload(a->image);
+            a->image.release();
+            for (texture* t : a->texture_targets)
+                *t = a->tex;
+            a->texture_targets.clear();
+        }
+
+        spdlog::info("'{0}' loaded", a->path);
+    }
+}
+
+void asset_loader::wait_idle() {
+    while (num_pending > 0) {
+        finalize();
+        if (num_pending > 0)
+            std::this_thread::yield();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "defines.h"
+
+#include "mesh.h"
+#include "texture.h"
+#include "texture_cache.h"
+#include "mapped_file.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads textures and baked meshes in the background.
+//
+// Requests return right away. Worker threads decode images (or map their
+// texture cache) and map and check mesh files; the GL uploads happen in finalize() on the render
+// thread. Each path is loaded once and shared by every texture or mesh that
+// asks for it. Until then textures show a 1x1 white placeholder and meshes
+// are empty (draw nothing).
+//
+// Targets are written from finalize(), so they have to outlive the loader
+// or the request.
+struct asset_loader {
+    asset_loader() {}
+    ~asset_loader();
+
+    // creates the placeholder and starts the workers, needs a GL context
+    void init();
+    // stops the workers; unfinished requests are dropped
+    void shutdown();
+
+    void load_texture(texture* target, const char* filename);
+    void load_mesh(triangle_mesh* target, const char* filename, float scale_factor = 1.0f);
+    void load_mesh(triangle_mesh* target, const char* filename, float x_scale_factor, float y_scale_factor, float z_scale_factor);
+
+    // uploads whatever the workers have finished, render thread only
+    void finalize();
+    // blocks (finalizing as it goes) until every request is uploaded
+    void wait_idle();
+
+    uint32 get_num_pending() const { return num_pending; }
+
+private:
+    struct mesh_target {
+        triangle_mesh* mesh;
+        vec3f scale;
+    };
+
+    struct asset {
+        std::string path;
+        bool is_mesh = false;
+        bool finalized = false; // render thread
+        bool failed = false;    // set by the worker before it's finished
+
+        // from the worker
+        texture_data image;
+        mapped_file file;
+
+        // the loaded copy every target shares
+        texture tex;
+        triangle_mesh mesh;
+
+        std::vector<texture*> texture_targets;
+        std::vector<mesh_target> mesh_targets;
+    };
+
+    // render thread only
+    std::unordered_map<std::string, std::unique_ptr<asset>> assets;
+    texture placeholder;
+    uint32 num_pending = 0;
+
+    // shared with the workers
+    std::mutex queue_mutex;
+    std::condition_variable queue_signal;
+    std::deque<asset*> jobs;
+    std::vector<asset*> finished;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    asset* request(const char* filename, bool is_mesh);
+    void worker_loop();
+    static void decode(asset* a);
+};
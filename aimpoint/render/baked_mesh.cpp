@@ -0,0 +1,213 @@
+#include "baked_mesh.h"
+
+#include "mapped_file.h"
+#include "log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// bounds-checked reads through a .mesh file
+struct mesh_reader {
+    const uint8* data;
+    uint64 size;
+    uint64 offset;
+    bool ok;
+
+    const uint8* take(uint64 count) {
+        if (!ok || count > size - offset) {
+            ok = false;
+            return nullptr;
+        }
+        const uint8* p = data + offset;
+        offset += count;
+        return p;
+    }
+    template <typename T> T read() {
+        T value{};
+        const uint8* p = take(sizeof(T));
+        if (p)
+            memcpy(&value, p, sizeof(T));
+        return value;
+    }
+    void skip(uint64 count) { take(count); }
+};
+
+// vertex layout in .mesh files
+struct mesh_file_vertex {
+    float position[3];
+    float normal[3];
+    float tangent[3];
+    float bitangent[3];
+    float texcoord[2];
+};
+
+static uint32 pack_snorm10(float v) {
+    v = fminf(fmaxf(v, -1.0f), 1.0f);
+    int32 q = (int32)lrintf(v*511.0f);
+    return (uint32)q & 0x3FF;
+}
+
+static uint16 pack_unorm16(float v) {
+    v = fminf(fmaxf(v, 0.0f), 1.0f);
+    return (uint16)lrintf(v*65535.0f);
+}
+
+static void pad_to_alignment(std::vector<uint8>& out) {
+    while (out.size() % baked_mesh_alignment)
+        out.push_back(0);
+}
+
+template <typename T> static void append(std::vector<uint8>& out, const T& value) {
+    const uint8* p = (const uint8*)&value;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+bool bake_mesh_file(const char* mesh_filename, const char* baked_filename, const baked_mesh_options& options) {
+    mapped_file file;
+    if (!file.open(mesh_filename)) {
+        spdlog::error("Could not open mesh file '{0}'", mesh_filename);
+        return false;
+    }
+
+    mesh_reader in = { file.get_data(), file.get_size(), 0, true };
+    const uint8* magic = in.take(4);
+    if (!magic || memcmp(magic, "MESH", 4) != 0) {
+        spdlog::error("'{0}' is not a mesh file", mesh_filename);
+        return false;
+    }
+    in.read<uint32>(); // file size
+    in.read<uint32>(); // version
+    in.read<uint64>(); // timestamp
+    in.read<uint32>(); // flag
+    uint16 num_prims = in.read<uint16>();
+
+    // materials aren't used by the renderer
+    for (uint32 n = 0; n < num_prims && in.ok; n++) {
+        in.skip(4);
+        uint32 mat_flag = in.read<uint32>();
+        in.skip(40);
+        in.skip(in.read<uint8>()); // name
+        for (uint32 bit = 0x02; bit <= 0x10; bit <<= 1) {
+            if (mat_flag & bit)
+                in.skip(in.read<uint8>()); // texture path
+        }
+    }
+
+    struct prim_source {
+        uint32 num_verts, num_inds, mat_idx;
+        const uint8* indices;
+        const uint8* vertices;
+    };
+    std::vector<prim_source> prims(num_prims);
+    for (uint32 n = 0; n < num_prims && in.ok; n++) {
+        in.skip(4); // "PRIM"
+        prims[n].num_verts = in.read<uint32>();
+        prims[n].num_inds = in.read<uint32>();
+        prims[n].mat_idx = in.read<uint32>();
+        prims[n].indices = in.take((uint64)prims[n].num_inds*sizeof(uint32));
+        prims[n].vertices = in.take((uint64)prims[n].num_verts*sizeof(mesh_file_vertex));
+    }
+    if (!in.ok) {
+        spdlog::error("'{0}' is truncated", mesh_filename);
+        return false;
+    }
+
+    // header and primitive table first, filled in as the blocks are laid out
+    std::vector<uint8> out(sizeof(baked_mesh_header) + sizeof(baked_mesh_prim)*num_prims, 0);
+    pad_to_alignment(out);
+
+    std::vector<baked_mesh_prim> table(num_prims);
+    float bounding_radius = 0.0f;
+    for (uint32 n = 0; n < num_prims; n++) {
+        const prim_source& src = prims[n];
+        baked_mesh_prim& dst = table[n];
+        dst.num_verts = src.num_verts;
+        dst.num_inds = src.num_inds;
+        dst.mat_idx = src.mat_idx;
+
+        std::vector<mesh_file_vertex> verts(src.num_verts);
+        memcpy(verts.data(), src.vertices, sizeof(mesh_file_vertex)*src.num_verts);
+
+        dst.format = 0;
+        if (options.pack_normals)
+            dst.format |= BAKED_NORMAL_PACKED;
+        if (options.quantize_texcoords) {
+            bool unit_range = true;
+            for (const mesh_file_vertex& v : verts) {
+                for (int c = 0; c < 2; c++)
+                    unit_range = unit_range && v.texcoord[c] >= 0.0f && v.texcoord[c] <= 1.0f;
+            }
+            if (unit_range)
+                dst.format |= BAKED_TEXCOORD_UNORM16;
+        }
+        if (options.short_indices && src.num_verts <= 65536)
+            dst.format |= BAKED_INDEX_16;
+
+        dst.vertex_offset = out.size();
+        for (const mesh_file_vertex& v : verts) {
+            for (int c = 0; c < 3; c++)
+                append(out, v.position[c]);
+            float radius = sqrtf(v.position[0]*v.position[0] + v.position[1]*v.position[1] + v.position[2]*v.position[2]);
+            bounding_radius = fmaxf(bounding_radius, radius);
+
+            if (dst.format & BAKED_NORMAL_PACKED) {
+                uint32 packed = pack_snorm10(v.normal[0]) | (pack_snorm10(v.normal[1]) << 10) | (pack_snorm10(v.normal[2]) << 20);
+                append(out, packed);
+            } else {
+                for (int c = 0; c < 3; c++)
+                    append(out, v.normal[c]);
+            }
+
+            if (dst.format & BAKED_TEXCOORD_UNORM16) {
+                append(out, pack_unorm16(v.texcoord[0]));
+                append(out, pack_unorm16(v.texcoord[1]));
+            } else {
+                append(out, v.texcoord[0]);
+                append(out, v.texcoord[1]);
+            }
+        }
+        pad_to_alignment(out);
+
+        dst.index_offset = out.size();
+        for (uint32 i = 0; i < src.num_inds; i++) {
+            uint32 index;
+            memcpy(&index, src.indices + sizeof(uint32)*i, sizeof(uint32));
+            if (index >= src.num_verts) {
+                spdlog::error("'{0}' primitive {1} has an index past its vertices", mesh_filename, n);
+                return false;
+            }
+            if (dst.format & BAKED_INDEX_16)
+                append(out, (uint16)index);
+            else
+                append(out, index);
+        }
+        pad_to_alignment(out);
+    }
+
+    baked_mesh_header header = {};
+    memcpy(header.magic, "BMSH", 4);
+    header.version = baked_mesh_version;
+    header.num_prims = num_prims;
+    header.bounding_radius = bounding_radius;
+    header.file_size = out.size();
+    memcpy(out.data(), &header, sizeof(header));
+    if (num_prims > 0)
+        memcpy(out.data() + sizeof(header), table.data(), sizeof(baked_mesh_prim)*num_prims);
+
+    FILE* fid = fopen(baked_filename, "wb");
+    if (fid == nullptr) {
+        spdlog::error("Could not create '{0}'", baked_filename);
+        return false;
+    }
+    bool written = fwrite(out.data(), 1, out.size(), fid) == out.size();
+    fclose(fid);
+    if (!written) {
+        spdlog::error("Failed writing '{0}'", baked_filename);
+        return false;
+    }
+
+    spdlog::info("Baked '{0}' ({1} bytes) to '{2}' ({3} bytes)", mesh_filename, file.get_size(), baked_filename, out.size());
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "defines.h"
+
+// Baked mesh files (.bmesh): vertex and index blocks stored in the layout
+// the GPU takes them in, so triangle_mesh::load_from_baked_file can map the
+// file and upload each block straight from the mapping. Blocks start on
+// baked_mesh_alignment byte boundaries.
+//
+//   baked_mesh_header
+//   baked_mesh_prim[num_prims]
+//   per primitive: vertices, then indices
+//
+// Vertices are position (3 floats), normal (3 floats, or packed signed
+// 2_10_10_10) and texcoord (2 floats, or 2 unorm16), interleaved.
+
+static const uint32 baked_mesh_version = 1;
+static const uint64 baked_mesh_alignment = 16;
+
+enum baked_mesh_format : uint32 {
+    BAKED_NORMAL_PACKED = 0x01, // GL_INT_2_10_10_10_REV, w unused
+    BAKED_TEXCOORD_UNORM16 = 0x02, // only when all texcoords are in [0, 1]
+    BAKED_INDEX_16 = 0x04,
+};
+
+struct baked_mesh_header {
+    char magic[4]; // "BMSH"
+    uint32 version;
+    uint32 num_prims;
+    float bounding_radius; // about the origin, unscaled
+    uint64 file_size;
+    uint32 reserved[2];
+};
+
+struct baked_mesh_prim {
+    uint32 num_verts;
+    uint32 num_inds;
+    uint32 mat_idx;
+    uint32 format; // baked_mesh_format bits
+    uint64 vertex_offset; // bytes from the start of the file
+    uint64 index_offset;
+};
+
+static_assert(sizeof(baked_mesh_header) == 32, "baked_mesh_header layout");
+static_assert(sizeof(baked_mesh_prim) == 32, "baked_mesh_prim layout");
+
+inline uint32 baked_mesh_vertex_size(uint32 format) {
+    return 3*sizeof(float)
+         + ((format & BAKED_NORMAL_PACKED) ? sizeof(uint32) : 3*sizeof(float))
+         + ((format & BAKED_TEXCOORD_UNORM16) ? 2*sizeof(uint16) : 2*sizeof(float));
+}
+
+inline uint32 baked_mesh_index_size(uint32 format) {
+    return (format & BAKED_INDEX_16) ? sizeof(uint16) : sizeof(uint32);
+}
+
+struct baked_mesh_options {
+    bool pack_normals = true;
+    bool quantize_texcoords = true;
+    bool short_indices = true; // for primitives with at most 65536 vertices
+};
+
+// Converts a .mesh file to a .bmesh file
+bool bake_mesh_file(const char* mesh_filename, const char* baked_filename,
+                    const baked_mesh_options& options = baked_mesh_options());
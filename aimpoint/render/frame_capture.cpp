@@ -0,0 +1,179 @@
+#include "frame_capture.h"
+
+#include "log.h"
+
+#include "glad/gl.h"
+
+frame_capture::~frame_capture() {
+    // no GL here, shutdown() frees the buffers
+    stop_worker();
+}
+
+void frame_capture::init(int32 set_width, int32 set_height, uint32 set_latency, frame_sink set_sink) {
+    width = set_width;
+    height = set_height;
+    latency = set_latency;
+    sink = set_sink;
+    frame_count = 0;
+    next_slot = 0;
+
+    // default GL_PACK_ALIGNMENT of 4
+    row_pitch = ((uint32)width*3 + 3) & ~3u;
+
+    // one buffer per frame in flight, and one the worker can hold on to
+    slots.resize(latency + 2);
+    for (slot& s : slots) {
+        glGenBuffers(1, &s.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)row_pitch*height, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    stopping = false;
+    worker = std::thread(&frame_capture::worker_loop, this);
+
+    spdlog::info("Capturing {0}x{1} with {2} frames of latency", width, height, latency);
+}
+
+void frame_capture::shutdown() {
+    if (slots.empty())
+        return;
+
+    while (!reading.empty()) {
+        collect(reading.front());
+        reading.pop_front();
+    }
+    stop_worker();
+    reclaim();
+
+    for (slot& s : slots)
+        glDeleteBuffers(1, &s.pbo);
+    slots.clear();
+}
+
+void frame_capture::read() {
+    if (slots.empty())
+        return;
+
+    reclaim();
+
+    uint32 index = next_slot;
+    next_slot = (next_slot + 1) % slots.size();
+    bool waited = false;
+    {
+        // the worker may be marking this slot delivered right now
+        std::unique_lock<std::mutex> lock(slot_mutex);
+        if (slots[index].state != SLOT_FREE) {
+            // the sink is behind, wait for it to hand this buffer back
+            done_signal.wait(lock, [this, index] { return slots[index].state == SLOT_DELIVERED; });
+            waited = true;
+        }
+    }
+    if (waited)
+        reclaim();
+
+    slot& s = slots[index];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = frame_count++;
+    s.state = SLOT_READING;
+    reading.push_back(index);
+
+    while (!reading.empty() && frame_count - slots[reading.front()].frame > latency) {
+        collect(reading.front());
+        reading.pop_front();
+    }
+}
+
+// waits for the read (normally long done), maps it and passes it on
+void frame_capture::collect(uint32 index) {
+    slot& s = slots[index];
+
+    GLsync fence = (GLsync)s.fence;
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, 0, 1000000); // 1 ms
+    glDeleteSync(fence);
+    s.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    s.pixels = (const uint8*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)row_pitch*height, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (result == GL_WAIT_FAILED || s.pixels == nullptr) {
+        spdlog::error("Dropped captured frame {0}", s.frame);
+        if (s.pixels) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            s.pixels = nullptr;
+        }
+        s.state = SLOT_FREE;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        s.state = SLOT_MAPPED;
+        mapped.push_back(index);
+    }
+    work_signal.notify_one();
+}
+
+// unmaps what the worker has finished with, GL thread only
+void frame_capture::reclaim() {
+    std::vector<uint32> done;
+    {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        for (uint32 n = 0; n < slots.size(); n++) {
+            if (slots[n].state == SLOT_DELIVERED)
+                done.push_back(n);
+        }
+    }
+
+    for (uint32 index : done) {
+        slot& s = slots[index];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        s.pixels = nullptr;
+        s.state = SLOT_FREE;
+    }
+    if (!done.empty())
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void frame_capture::stop_worker() {
+    if (!worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(slot_mutex);
+        stopping = true;
+    }
+    work_signal.notify_all();
+    worker.join();
+}
+
+void frame_capture::worker_loop() {
+    for (;;) {
+        uint32 index;
+        {
+            std::unique_lock<std::mutex> lock(slot_mutex);
+            // finish what's queued before stopping
+            work_signal.wait(lock, [this] { return stopping || !mapped.empty(); });
+            if (mapped.empty())
+                return;
+            index = mapped.front();
+            mapped.pop_front();
+        }
+
+        sink(slots[index].pixels, width, height, row_pitch);
+
+        {
+            std::lock_guard<std::mutex> lock(slot_mutex);
+            slots[index].state = SLOT_DELIVERED;
+        }
+        done_signal.notify_all();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "defines.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Asynchronous readback of the back buffer, for video capture.
+//
+// read() starts a glReadPixels into one of a ring of pixel buffer objects
+// and puts a fence behind it, without waiting on either. The frame is
+// collected `latency` frames later, when the GPU has normally finished: the
+// buffer is mapped and handed to a worker thread, which passes the pixels
+// to the sink (RGB, bottom row first, rows padded to 4 bytes). The render
+// thread only waits if the sink falls behind and every buffer in the ring
+// is still in use.
+struct frame_capture {
+    typedef std::function<void(const uint8* pixels, int32 width, int32 height, uint32 row_pitch)> frame_sink;
+
+    frame_capture() {}
+    ~frame_capture();
+
+    frame_capture(const frame_capture&) = delete;
+    frame_capture& operator=(const frame_capture&) = delete;
+
+    // needs a GL context, sink is called on the worker thread
+    void init(int32 width, int32 height, uint32 latency, frame_sink sink);
+    // delivers every frame still in flight, then frees the buffers
+    void shutdown();
+
+    // reads the back buffer, call before swapping
+    void read();
+
+    bool is_running() const { return !slots.empty(); }
+
+private:
+    enum slot_state {
+        SLOT_FREE,
+        SLOT_READING,   // glReadPixels queued, fence pending
+        SLOT_MAPPED,    // with the worker
+        SLOT_DELIVERED, // worker done, still mapped
+    };
+
+    struct slot {
+        uint32 pbo = 0;
+        void* fence = nullptr; // GLsync
+        const uint8* pixels = nullptr;
+        uint64 frame = 0;
+        slot_state state = SLOT_FREE;
+    };
+
+    int32 width = 0;
+    int32 height = 0;
+    uint32 row_pitch = 0;
+    uint32 latency = 0;
+    uint64 frame_count = 0;
+    uint32 next_slot = 0;
+    frame_sink sink;
+
+    std::vector<slot> slots;
+    std::deque<uint32> reading; // slots in the order they were read
+
+    // shared with the worker
+    std::mutex slot_mutex;
+    std::condition_variable work_signal;
+    std::condition_variable done_signal;
+    std::deque<uint32> mapped;
+    bool stopping = false;
+    std::thread worker;
+
+    void collect(uint32 index);
+    void reclaim();
+    void stop_worker();
+    void worker_loop();
+};
@@ -0,0 +1,124 @@
+#include "ground_track.h"
+
+#include "glad/gl.h"
+
+#include <cmath>
+
+static uint32 pack_color(const vec3f& color, float alpha) {
+    auto channel = [](float c) { return (uint32)(fminf(fmaxf(c, 0.0f), 1.0f)*255.0f + 0.5f); };
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (channel(alpha) << 24);
+}
+
+void ground_track_history::init(uint32 set_num_tracks, uint32 set_history_length) {
+    num_tracks = set_num_tracks;
+    history_length = set_history_length;
+    staging.assign((size_t)num_tracks*history_length*vertices_per_sample, vertex{ 0.0f, 0.0f, 0 });
+    colors.assign(num_tracks, pack_color(vec3f(1.0f, 1.0f, 1.0f), 1.0f));
+    last_lat.assign(num_tracks, NAN);
+    last_lon.assign(num_tracks, NAN);
+    next_slot = 0;
+    num_filled = 0;
+    dirty_begin = 0;
+    dirty_count = 0;
+}
+
+void ground_track_history::set_color(uint32 track, const vec3f& color, float alpha) {
+    colors[track] = pack_color(color, alpha);
+}
+
+void ground_track_history::clear() {
+    for (uint32 t = 0; t < num_tracks; t++) {
+        last_lat[t] = NAN;
+        last_lon[t] = NAN;
+    }
+    next_slot = 0;
+    num_filled = 0;
+    dirty_begin = 0;
+    dirty_count = 0;
+}
+
+void ground_track_history::append(const float* lat, const float* lon) {
+    if (history_length == 0)
+        return;
+
+    vertex* out = &staging[(size_t)next_slot*num_tracks*vertices_per_sample];
+    for (uint32 t = 0; t < num_tracks; t++, out += vertices_per_sample) {
+        uint32 color = colors[t];
+        float lat0 = last_lat[t], lon0 = last_lon[t];
+        float lat1 = lat[t], lon1 = lon[t];
+        last_lat[t] = lat1;
+        last_lon[t] = lon1;
+
+        // degenerate segments where there's nothing to connect
+        if (std::isnan(lat0) || std::isnan(lat1)) {
+            float x = std::isnan(lat1) ? 0.0f : lon1;
+            float y = std::isnan(lat1) ? 0.0f : lat1;
+            for (uint32 v = 0; v < vertices_per_sample; v++)
+                out[v] = { x, y, 0 };
+            continue;
+        }
+
+        float dlon = lon1 - lon0;
+        if (fabsf(dlon) <= 180.0f) {
+            out[0] = { lon0, lat0, color };
+            out[1] = { lon1, lat1, color };
+            out[2] = { lon1, lat1, 0 };
+            out[3] = { lon1, lat1, 0 };
+        } else {
+            // crosses the antimeridian: end at the edge and pick up on the other side
+            float edge = lon0 > 0.0f ? 180.0f : -180.0f;
+            float unwrapped = lon1 + 2.0f*edge;
+            float f = (edge - lon0) / (unwrapped - lon0);
+            float lat_edge = lat0 + f*(lat1 - lat0);
+            out[0] = { lon0, lat0, color };
+            out[1] = { edge, lat_edge, color };
+            out[2] = { -edge, lat_edge, color };
+            out[3] = { lon1, lat1, color };
+        }
+    }
+
+    if (dirty_count == 0)
+        dirty_begin = next_slot;
+    if (dirty_count < history_length)
+        dirty_count++;
+    else
+        dirty_begin = (next_slot + 1) % history_length;
+
+    next_slot = (next_slot + 1) % history_length;
+    if (num_filled < history_length)
+        num_filled++;
+}
+
+void ground_track_history::upload() {
+    const size_t slot_bytes = sizeof(vertex)*num_tracks*vertices_per_sample;
+
+    if (handle == 0) {
+        glGenVertexArrays(1, &handle);
+        glGenBuffers(1, &vbo);
+
+        glBindVertexArray(handle);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, slot_bytes*history_length, nullptr, GL_DYNAMIC_DRAW);
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(vertex), (void*)(2*sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindVertexArray(0);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    }
+
+    if (dirty_count > 0) {
+        // at most two ranges, either side of the wrap
+        uint32 first = dirty_count < history_length - dirty_begin ? dirty_count : history_length - dirty_begin;
+        glBufferSubData(GL_ARRAY_BUFFER, slot_bytes*dirty_begin, slot_bytes*first,
+                        &staging[(size_t)dirty_begin*num_tracks*vertices_per_sample]);
+        if (dirty_count > first)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, slot_bytes*(dirty_count - first), &staging[0]);
+        dirty_count = 0;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
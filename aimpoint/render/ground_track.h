@@ -0,0 +1,52 @@
+#pragma once
+#include "defines.h"
+
+#include <vector>
+
+// Ground track history of a group of bodies, kept in one GPU ring buffer.
+//
+// Every track gets a sample at the same times, so each append fills one
+// contiguous slot of the ring and is uploaded with a single glBufferSubData
+// the next time the tracks are drawn. Samples are stored as line segments
+// from the previous sample, split at the antimeridian, so the whole ring
+// draws with one GL_LINES call in any order.
+struct ground_track_history {
+    ground_track_history() {}
+
+    // history_length samples per track
+    void init(uint32 num_tracks, uint32 history_length);
+    void set_color(uint32 track, const vec3f& color, float alpha = 1.0f);
+    void clear();
+
+    // one sample for every track, deg. NaN latitude leaves a gap.
+    void append(const float* lat, const float* lon);
+
+    uint32 get_num_tracks() const { return num_tracks; }
+
+private:
+    struct vertex {
+        float lon, lat;
+        uint32 color; // RGBA8
+    };
+    static const uint32 vertices_per_sample = 4; // up to two segments
+
+    uint32 num_tracks = 0;
+    uint32 history_length = 0;
+    uint32 next_slot = 0;
+    uint32 num_filled = 0;
+
+    std::vector<vertex> staging; // CPU copy of the ring
+    std::vector<uint32> colors;
+    std::vector<float> last_lat, last_lon;
+
+    // slots written since the last upload, [dirty_begin, dirty_begin + dirty_count) mod history_length
+    uint32 dirty_begin = 0;
+    uint32 dirty_count = 0;
+
+    uint32 handle = 0, vbo = 0;
+
+    // sends dirty slots to the GPU, creating the buffer on first use
+    void upload();
+
+    friend struct opengl_renderer;
+};
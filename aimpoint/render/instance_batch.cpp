@@ -0,0 +1,82 @@
+#include "instance_batch.h"
+
+#include "glad/gl.h"
+
+void instance_batch::reserve(size_t capacity) {
+    instances.reserve(capacity);
+    visible.reserve(capacity);
+}
+
+void instance_batch::clear() {
+    instances.clear();
+}
+
+void instance_batch::add(const vec3f& position, const laml::Quat& orientation) {
+    instances.push_back({ { position.x, position.y, position.z, 0.0f },
+                          { orientation.x, orientation.y, orientation.z, orientation.w } });
+}
+
+void instance_batch::add_soa(const std::vector<double> position[3], const int32* status) {
+    size_t count = position[0].size();
+    instances.reserve(instances.size() + count);
+    for (size_t n = 0; n < count; n++) {
+        if (status && status[n] != 0)
+            continue;
+        instances.push_back({ { (float)position[0][n], (float)position[1][n], (float)position[2][n], 0.0f },
+                              { 0.0f, 0.0f, 0.0f, 1.0f } });
+    }
+}
+
+void instance_batch::cull_and_upload(const view_frustum& frustum, float radius, float impostor_pixels) {
+    const size_t count = instances.size();
+    visible.resize(count);
+
+    // meshes fill from the front, impostors from the back, then the
+    // impostors are moved down behind the meshes
+    size_t num_meshes = 0, back = count;
+    const float impostor_radius = 0.5f*impostor_pixels;
+    for (size_t n = 0; n < count; n++) {
+        const instance& inst = instances[n];
+        float x = inst.position[0], y = inst.position[1], z = inst.position[2];
+
+        bool inside = true;
+        for (int k = 0; k < 6; k++) {
+            const laml::Vec4& p = frustum.planes[k];
+            if (p.x*x + p.y*y + p.z*z + p.w < -radius) {
+                inside = false;
+                break;
+            }
+        }
+        if (!inside)
+            continue;
+
+        const laml::Vec4& d = frustum.depth_row;
+        float depth = d.x*x + d.y*y + d.z*z + d.w;
+        if (radius*frustum.pixels_per_unit < impostor_radius*depth)
+            visible[--back] = inst;
+        else
+            visible[num_meshes++] = inst;
+    }
+    size_t num_impostors = count - back;
+    for (size_t n = 0; n < num_impostors; n++)
+        visible[num_meshes + n] = visible[back + n];
+
+    num_drawn_meshes = (uint32)num_meshes;
+    num_drawn_impostors = (uint32)num_impostors;
+    num_culled = (uint32)(count - num_meshes - num_impostors);
+
+    if (ssbo == 0) {
+        glGenBuffers(1, &ssbo);
+        // points need a VAO bound but read everything from the storage buffer
+        glGenVertexArrays(1, &point_handle);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+    if (gpu_capacity < count) {
+        gpu_capacity = count + count/2;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(instance)*gpu_capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (num_meshes + num_impostors > 0)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(instance)*(num_meshes + num_impostors), visible.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "defines.h"
+
+#include <vector>
+
+// Clip planes and projection scale of the current 3D frame, in the frame the
+// instance positions are given in (i.e. before the renderer's render frame).
+struct view_frustum {
+    laml::Vec4 planes[6]; // normalized, inside is dot(n, p) + w >= 0
+    laml::Vec4 depth_row; // clip w of a point, the distance along the view axis
+    float pixels_per_unit; // at unit depth
+};
+
+// Many copies of one mesh, e.g. a whole catalog of satellites.
+//
+// Instances are filled on the CPU, culled against the view frustum when
+// drawn, and the survivors go to the GPU in one shader storage buffer
+// update. Everything big enough on screen draws with one instanced call per
+// mesh primitive; the rest draw as point impostors in a single call.
+struct instance_batch {
+    instance_batch() {}
+
+    void reserve(size_t capacity);
+    void clear();
+    size_t size() const { return instances.size(); }
+
+    void add(const vec3f& position, const laml::Quat& orientation = laml::Quat());
+    // positions from SoA state arrays ([x..., y..., z...]), identity
+    // orientation. Objects with a nonzero status are skipped.
+    void add_soa(const std::vector<double> position[3], const int32* status = nullptr);
+
+    // from the last draw
+    uint32 num_drawn_meshes = 0;
+    uint32 num_drawn_impostors = 0;
+    uint32 num_culled = 0;
+
+private:
+    struct instance {
+        float position[4]; // xyz, w unused (std430 vec4)
+        float orientation[4]; // quaternion xyzw
+    };
+
+    std::vector<instance> instances;
+    std::vector<instance> visible; // meshes first, then impostors
+
+    uint32 ssbo = 0, point_handle = 0;
+    size_t gpu_capacity = 0;
+
+    // sorts the visible instances into meshes and impostors and uploads them
+    void cull_and_upload(const view_frustum& frustum, float radius, float impostor_pixels);
+
+    friend struct opengl_renderer;
+};
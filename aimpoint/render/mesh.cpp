@@ -1,15 +1,20 @@
 #include "mesh.h"
 
+#include "baked_mesh.h"
+#include "mapped_file.h"
 #include "log.h"
 
 #include "glad/gl.h"
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 
 triangle_mesh::~triangle_mesh() {
     free(handles);
     free(num_verts);
     free(num_inds);
     free(mat_idxs);
+    free(index_types);
 }
 
 bool triangle_mesh::load_from_mesh_file(const char* filename, float scale_factor) {
@@ -53,6 +58,7 @@ bool triangle_mesh::load_from_mesh_file(const char* filename, float x_scale_fact
     num_verts = (uint32*)malloc(sizeof(uint32)*num_prims);
     num_inds = (uint32*)malloc(sizeof(uint32)*num_prims);
     mat_idxs = (uint32*)malloc(sizeof(uint32)*num_prims);
+    index_types = (uint32*)malloc(sizeof(uint32)*num_prims);
 
     // skip materials
     for (int prim_idx = 0; prim_idx < num_prims; prim_idx++) {
@@ -133,6 +139,10 @@ bool triangle_mesh::load_from_mesh_file(const char* filename, float x_scale_fact
             vertices[n*num_attr + 1] = y_scale_factor*vertices_file[n].position.y;
             vertices[n*num_attr + 2] = z_scale_factor*vertices_file[n].position.z;
 
+            float radius = laml::length(vec3f(vertices[n*num_attr + 0], vertices[n*num_attr + 1], vertices[n*num_attr + 2]));
+            if (radius > bounding_radius)
+                bounding_radius = radius;
+
             vertices[n*num_attr + 3] = vertices_file[n].normal.x;
             vertices[n*num_attr + 4] = vertices_file[n].normal.y;
             vertices[n*num_attr + 5] = vertices_file[n].normal.z;
@@ -171,6 +181,7 @@ bool triangle_mesh::load_from_mesh_file(const char* filename, float x_scale_fact
         free(vertices);
 
         handles[prim_idx] = VAO;
+        index_types[prim_idx] = GL_UNSIGNED_INT;
         spdlog::debug("    handle: {0}", handles[prim_idx]);
     }
 
@@ -190,10 +201,12 @@ bool triangle_mesh::create_plane(vec3f normal, float sizeX, float sizeY) {
     num_verts = (uint32*)malloc(sizeof(uint32)*num_prims);
     num_inds  = (uint32*)malloc(sizeof(uint32)*num_prims);
     mat_idxs  = (uint32*)malloc(sizeof(uint32)*num_prims);
+    index_types = (uint32*)malloc(sizeof(uint32)*num_prims);
 
     num_verts[0] = 4;
     num_inds[0] = 6;
     mat_idxs[0] = 0;
+    index_types[0] = GL_UNSIGNED_INT;
     int32 num_attr = 8;
 
     // determine frame
@@ -215,6 +228,7 @@ bool triangle_mesh::create_plane(vec3f normal, float sizeX, float sizeY) {
     vec3f V1 = sizeX*( bitangent) + sizeY*( tangent);
     vec3f V2 = sizeX*( bitangent) + sizeY*(-tangent);
     vec3f V3 = sizeX*(-bitangent) + sizeY*(-tangent);
+    bounding_radius = sqrtf(sizeX*sizeX + sizeY*sizeY);
 
     // create simple plane mesh
     float verts[] = {V0.x, V0.y, V0.z, normal.x, normal.y, normal.z, 0.0f, 0.0f,
@@ -253,4 +267,152 @@ bool triangle_mesh::create_plane(vec3f normal, float sizeX, float sizeY) {
     glBindVertexArray(0);
 
     return true;
-}
\ No newline at end of file
+}
+bool triangle_mesh::load_from_baked_file(const char* filename, float scale_factor) {
+    return load_from_baked_file(filename, scale_factor, scale_factor, scale_factor);
+}
+bool triangle_mesh::load_from_baked_file(const char* filename, float x_scale_factor, float y_scale_factor, float z_scale_factor) {
+    mapped_file file;
+    if (!open_baked_file(file, filename))
+        return false;
+
+    upload_baked(file, x_scale_factor, y_scale_factor, z_scale_factor);
+
+    spdlog::info("'{0}' loaded", filename);
+    return true;
+}
+
+bool triangle_mesh::open_baked_file(mapped_file& file, const char* filename) {
+    if (!file.open(filename)) {
+        // try up to two directories up
+        char up_filename[256];
+        snprintf(up_filename, 256, "../%s", filename);
+        if (!file.open(up_filename)) {
+            snprintf(up_filename, 256, "../../%s", filename);
+            if (!file.open(up_filename)) {
+                spdlog::critical("Could not open baked mesh file '{0}'", filename);
+                return false;
+            }
+        }
+    }
+
+    const uint8* data = file.get_data();
+    const uint64 size = file.get_size();
+
+    baked_mesh_header header;
+    if (size < sizeof(header)) {
+        spdlog::critical("'{0}' is not a baked mesh", filename);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "BMSH", 4) != 0 || header.version != baked_mesh_version ||
+        header.file_size != size || header.num_prims > 0xFFFF ||
+        sizeof(header) + sizeof(baked_mesh_prim)*(uint64)header.num_prims > size) {
+        spdlog::critical("'{0}' is not a version {1} baked mesh", filename, baked_mesh_version);
+        return false;
+    }
+    const baked_mesh_prim* prims = (const baked_mesh_prim*)(data + sizeof(header));
+
+    // check every block is inside the file before touching the GPU
+    for (uint32 n = 0; n < header.num_prims; n++) {
+        const baked_mesh_prim& prim = prims[n];
+        uint64 vertex_bytes = (uint64)prim.num_verts*baked_mesh_vertex_size(prim.format);
+        uint64 index_bytes = (uint64)prim.num_inds*baked_mesh_index_size(prim.format);
+        if (prim.vertex_offset > size || vertex_bytes > size - prim.vertex_offset ||
+            prim.index_offset > size || index_bytes > size - prim.index_offset) {
+            spdlog::critical("'{0}' primitive {1} runs past the end of the file", filename, n);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void triangle_mesh::upload_baked(const mapped_file& file, float x_scale_factor, float y_scale_factor, float z_scale_factor) {
+    const uint8* data = file.get_data();
+    baked_mesh_header header;
+    memcpy(&header, data, sizeof(header));
+    const baked_mesh_prim* prims = (const baked_mesh_prim*)(data + sizeof(header));
+
+    num_prims = (uint16)header.num_prims;
+    handles     = (uint32*)malloc(sizeof(uint32)*num_prims);
+    num_verts   = (uint32*)malloc(sizeof(uint32)*num_prims);
+    num_inds    = (uint32*)malloc(sizeof(uint32)*num_prims);
+    mat_idxs    = (uint32*)malloc(sizeof(uint32)*num_prims);
+    index_types = (uint32*)malloc(sizeof(uint32)*num_prims);
+
+    for (uint32 n = 0; n < num_prims; n++) {
+        const baked_mesh_prim& prim = prims[n];
+        const uint32 stride = baked_mesh_vertex_size(prim.format);
+        const bool packed_normal = prim.format & BAKED_NORMAL_PACKED;
+        const bool unorm_texcoord = prim.format & BAKED_TEXCOORD_UNORM16;
+
+        num_verts[n] = prim.num_verts;
+        num_inds[n] = prim.num_inds;
+        mat_idxs[n] = prim.mat_idx;
+        index_types[n] = (prim.format & BAKED_INDEX_16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        unsigned int VBO, VAO, EBO;
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+
+        // straight from the mapping
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, (uint64)stride*prim.num_verts, data + prim.vertex_offset, GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (uint64)baked_mesh_index_size(prim.format)*prim.num_inds,
+                     data + prim.index_offset, GL_STATIC_DRAW);
+
+        size_t offset = 0;
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glEnableVertexAttribArray(0);
+        offset += 3*sizeof(float);
+
+        if (packed_normal) {
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offset);
+            offset += sizeof(uint32);
+        } else {
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+            offset += 3*sizeof(float);
+        }
+        glEnableVertexAttribArray(1);
+
+        if (unorm_texcoord)
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offset);
+        else
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glEnableVertexAttribArray(2);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        handles[n] = VAO;
+    }
+
+    scale = vec3f(x_scale_factor, y_scale_factor, z_scale_factor);
+    bounding_radius = header.bounding_radius *
+        fmaxf(fabsf(x_scale_factor), fmaxf(fabsf(y_scale_factor), fabsf(z_scale_factor)));
+}
+
+void triangle_mesh::share_from(const triangle_mesh& other, float x_scale_factor, float y_scale_factor, float z_scale_factor) {
+    num_prims = other.num_prims;
+    flag = other.flag;
+
+    uint32** arrays[] = { &handles, &num_verts, &num_inds, &mat_idxs, &index_types };
+    uint32* const sources[] = { other.handles, other.num_verts, other.num_inds, other.mat_idxs, other.index_types };
+    for (int k = 0; k < 5; k++) {
+        free(*arrays[k]);
+        *arrays[k] = (uint32*)malloc(sizeof(uint32)*num_prims);
+        memcpy(*arrays[k], sources[k], sizeof(uint32)*num_prims);
+    }
+
+    // other's scale is 1 for anything the asset loader shares
+    float unscaled_radius = other.bounding_radius /
+        fmaxf(fabsf(other.scale.x), fmaxf(fabsf(other.scale.y), fabsf(other.scale.z)));
+    scale = vec3f(x_scale_factor, y_scale_factor, z_scale_factor);
+    bounding_radius = unscaled_radius *
+        fmaxf(fabsf(x_scale_factor), fmaxf(fabsf(y_scale_factor), fabsf(z_scale_factor)));
+}
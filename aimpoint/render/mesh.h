@@ -1,6 +1,8 @@
 #pragma once
 #include "defines.h"
 
+struct mapped_file;
+
 struct triangle_mesh {
     ~triangle_mesh();
 
@@ -12,16 +14,33 @@ struct triangle_mesh {
     bool load_from_mesh_file(const char* filename, float scale_factor = 1.0f);
     bool load_from_mesh_file(const char* filename, float x_scale_factor, float y_scale_factor, float z_scale_factor);
 
+    // Baked meshes (see baked_mesh.h) are mapped and uploaded as stored, so
+    // the scale is applied when drawn instead of to the vertices.
+    bool load_from_baked_file(const char* filename, float scale_factor = 1.0f);
+    bool load_from_baked_file(const char* filename, float x_scale_factor, float y_scale_factor, float z_scale_factor);
+
     bool create_plane(vec3f normal, float sizeX, float sizeY);
 
+    float bounding_radius = 0.0f; // about the mesh origin, after scaling
+    vec3f scale = vec3f(1.0f, 1.0f, 1.0f); // applied when drawn
+
 private:
     uint16 num_prims = 0;
     uint32* handles = nullptr;
     uint32* num_verts = nullptr;
     uint32* num_inds = nullptr;
     uint32* mat_idxs = nullptr;
+    uint32* index_types = nullptr; // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
 
     uint32 flag = 0;
 
+    // baked loading split so the file can be opened and checked off the GL
+    // thread; open_baked_file does no GL calls
+    static bool open_baked_file(mapped_file& file, const char* filename);
+    void upload_baked(const mapped_file& file, float x_scale_factor, float y_scale_factor, float z_scale_factor);
+    // same GL buffers as other, with a scale of its own
+    void share_from(const triangle_mesh& other, float x_scale_factor, float y_scale_factor, float z_scale_factor);
+
     friend struct opengl_renderer;
+    friend struct asset_loader;
 };
\ No newline at end of file
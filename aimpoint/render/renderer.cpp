@@ -10,9 +10,17 @@
 #include <implot.h>
 
 #include "log.h"
+#include "startup_profile.h"
 
 #include "base_app.h"
 
+#include <algorithm>
+#include <string.h>
+
+// uniform buffer binding of the camera_data block in the 3D shaders
+static const uint32 camera_block_binding = 0;
+static const size_t camera_matrix_size = 16*sizeof(float);
+
 // silly function :/
 const char* find_imgui_ini_file() {
     FILE* fid = fopen("data/imgui.ini", "r");
@@ -59,6 +67,8 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
     window_width = width;
     window_height = height;
 
+    startup_timer context_timer("window and context");
+
     // setup glfw
     if (!glfwInit()) {
         // init failed
@@ -88,6 +98,7 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
 
     glfwMakeContextCurrent(window);
     gladLoadGL(glfwGetProcAddress);
+    context_timer.stop();
 
     
     glDebugMessageCallback(openGL_debug_msg_callback, nullptr);
@@ -100,13 +111,19 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
 
     glEnable(GL_DEPTH_TEST);
 
+    // view and projection shared by every 3D shader, written once per change
+    glGenBuffers(1, &camera_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, 2*camera_matrix_size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, camera_block_binding, camera_ubo);
+
     // create basic shader
     const char *vertexShaderSource = "#version 430 core\n"
                                      "layout (location = 0) in vec3 a_Position;\n"
                                      "layout (location = 1) in vec3 a_Normal;\n"
                                      "layout (location = 2) in vec2 a_TexCoord;\n"
-                                     "layout (location = 1) uniform mat4 r_View;\n"
-                                     "layout (location = 2) uniform mat4 r_Projection;\n"
+                                     "layout (std140, binding = 0) uniform camera_data { mat4 r_View; mat4 r_Projection; };\n"
                                      "layout (location = 3) uniform mat4 r_Transform;\n"
                                      "out vec3 out_normal;\n"
                                      "out vec2 out_texcoord;\n"
@@ -130,15 +147,17 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
                                        "   FragColor = vec4(ambient + dot(light_dir, out_normal) * tex_color, 1.0f);\n"
                                        "   FragColor = vec4(tex_color, 1.0f);\n"
                                        "}\0";
-    if (!basic_shader.create_shader_from_source(vertexShaderSource, fragmentShaderSource)) {
-        return 3;
+    {
+        startup_timer timer("shader", "basic");
+        if (!basic_shader.create_shader_from_source(vertexShaderSource, fragmentShaderSource)) {
+            return 3;
+        }
     }
 
     // create Line shader
     const char *lineVertexShaderSource = "#version 430 core\n"
                                          "layout (location = 0) in vec3 a_Position;\n"
-                                         "layout (location = 1) uniform mat4 r_View;\n"
-                                         "layout (location = 2) uniform mat4 r_Projection;\n"
+                                         "layout (std140, binding = 0) uniform camera_data { mat4 r_View; mat4 r_Projection; };\n"
                                          "layout (location = 3) uniform mat4 r_Transform;\n"
                                          "void main() {\n"
                                          "    gl_Position = r_Projection * r_View * r_Transform * vec4(a_Position, 1.0);\n"
@@ -154,8 +173,72 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
                                            "   FragColor = vec4(r_color, r_alpha);\n"
                                            "}\0";
 
-    if (!line_shader.create_shader_from_source(lineVertexShaderSource, lineFragmentShaderSource)) {
-        return 3;
+    {
+        startup_timer timer("shader", "line");
+        if (!line_shader.create_shader_from_source(lineVertexShaderSource, lineFragmentShaderSource)) {
+            return 3;
+        }
+    }
+
+    // create instanced shader, transforms come from a storage buffer
+    const char *instancedVertexShaderSource = "#version 430 core\n"
+                                              "layout (location = 0) in vec3 a_Position;\n"
+                                              "layout (location = 1) in vec3 a_Normal;\n"
+                                              "layout (location = 2) in vec2 a_TexCoord;\n"
+                                              "struct instance { vec4 position; vec4 orientation; };\n"
+                                              "layout (std430, binding = 0) readonly buffer instance_data { instance instances[]; };\n"
+                                              "layout (std140, binding = 0) uniform camera_data { mat4 r_View; mat4 r_Projection; };\n"
+                                              "layout (location = 3) uniform mat4 r_Transform;\n"
+                                              "layout (location = 4) uniform vec3 r_scale;\n"
+                                              "out vec3 out_normal;\n"
+                                              "out vec2 out_texcoord;\n"
+                                              "vec3 rotate(vec4 q, vec3 v) {\n"
+                                              "    return v + 2.0*cross(q.xyz, cross(q.xyz, v) + q.w*v);\n"
+                                              "}\n"
+                                              "void main() {\n"
+                                              "    instance inst = instances[gl_InstanceID];\n"
+                                              "    vec3 world = inst.position.xyz + rotate(inst.orientation, r_scale*a_Position);\n"
+                                              "    gl_Position = r_Projection * r_View * r_Transform * vec4(world, 1.0);\n"
+                                              "    out_normal = vec3(r_Transform * vec4(rotate(inst.orientation, a_Normal), 0.0f));\n"
+                                              "    out_texcoord = a_TexCoord;\n"
+                                              "}\n";
+
+    {
+        startup_timer timer("shader", "instanced");
+        if (!instanced_shader.create_shader_from_source(instancedVertexShaderSource, fragmentShaderSource)) {
+            return 3;
+        }
+    }
+
+    // create impostor shader, one round point per instance
+    const char *impostorVertexShaderSource = "#version 430 core\n"
+                                             "struct instance { vec4 position; vec4 orientation; };\n"
+                                             "layout (std430, binding = 0) readonly buffer instance_data { instance instances[]; };\n"
+                                             "layout (std140, binding = 0) uniform camera_data { mat4 r_View; mat4 r_Projection; };\n"
+                                             "layout (location = 3) uniform mat4 r_Transform;\n"
+                                             "layout (location = 4) uniform int r_first;\n"
+                                             "layout (location = 5) uniform float r_point_size;\n"
+                                             "void main() {\n"
+                                             "    vec3 world = instances[r_first + gl_VertexID].position.xyz;\n"
+                                             "    gl_Position = r_Projection * r_View * r_Transform * vec4(world, 1.0);\n"
+                                             "    gl_PointSize = r_point_size;\n"
+                                             "}\n";
+
+    const char *impostorFragmentShaderSource = "#version 430 core\n"
+                                               "out vec4 FragColor;\n"
+                                               "layout (location = 6) uniform vec3 r_color;\n"
+                                               "void main()\n"
+                                               "{\n"
+                                               "   vec2 d = 2.0*gl_PointCoord - 1.0;\n"
+                                               "   if (dot(d, d) > 1.0) discard;\n"
+                                               "   FragColor = vec4(r_color, 1.0f);\n"
+                                               "}\0";
+
+    {
+        startup_timer timer("shader", "impostor");
+        if (!impostor_shader.create_shader_from_source(impostorVertexShaderSource, impostorFragmentShaderSource)) {
+            return 3;
+        }
     }
 
     // create 2D shader
@@ -184,19 +267,49 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
                                            "   FragColor = vec4(r_color*tex_color, tex_alpha*r_alpha);\n"
                                            "}\0";
 
-    if (!basic_2D_shader.create_shader_from_source(twoDVertexShaderSource, twoDFragmentShaderSource)) {
-        return 3;
+    {
+        startup_timer timer("shader", "2D");
+        if (!basic_2D_shader.create_shader_from_source(twoDVertexShaderSource, twoDFragmentShaderSource)) {
+            return 3;
+        }
     }
     basic_2D_shader.set_uniform("diffuse_tex", uint32(0));
 
+    // create 2D ground track shader (per-vertex color)
+    const char *trackVertexShaderSource = "#version 430 core\n"
+                                          "layout (location = 0) in vec2 a_Position;\n"
+                                          "layout (location = 1) in vec4 a_Color;\n"
+                                          "out vec4 out_color;\n"
+                                          "layout (location = 1) uniform mat4 r_Projection;\n"
+                                          "void main() {\n"
+                                          "    gl_Position = r_Projection * vec4(a_Position, 0.0, 1.0);\n"
+                                          "    out_color = a_Color;\n"
+                                          "}\n";
+
+    const char *trackFragmentShaderSource = "#version 430 core\n"
+                                            "out vec4 FragColor;\n"
+                                            "in vec4 out_color;\n"
+                                            "void main()\n"
+                                            "{\n"
+                                            "   FragColor = out_color;\n"
+                                            "}\0";
+
+    {
+        startup_timer timer("shader", "2D track");
+        if (!track_2D_shader.create_shader_from_source(trackVertexShaderSource, trackFragmentShaderSource)) {
+            return 3;
+        }
+    }
+
     // OpenGL settings
     glLineWidth(4.0f);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // load primitives
-    vector_mesh.load_from_mesh_file("data/vector.mesh", 1.0f, 0.7f, 0.7f);
-    blank_tex.load_texture_file("data/circle.png");
+    assets.init();
+    assets.load_mesh(&vector_mesh, "data/vector.bmesh", 1.0f, 0.7f, 0.7f);
+    assets.load_texture(&blank_tex, "data/circle.png");
 
     // create simple plane mesh
     {
@@ -324,6 +437,7 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
     }
 
     // Setup Dear ImGui context
+    startup_timer imgui_timer("imgui");
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImPlot::CreateContext();
@@ -343,20 +457,20 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     const char* glsl_version = "#version 130";
     ImGui_ImplOpenGL3_Init(glsl_version);
+    imgui_timer.stop();
 
     // initialize shaders
     float AR = ((float)window_width / (float)window_height);
     //laml::transform::create_projection_perspective(projection_matrix, 75.0f, AR, 1000.0f, 50'000'000.0f);
     laml::transform::create_projection_perspective(projection_matrix, 75.0f, AR, 0.1f, 1000.0f);
-    basic_shader.bind();
-    basic_shader.set_uniform("r_Projection", projection_matrix);
-    line_shader.bind();
-    line_shader.set_uniform("r_Projection", projection_matrix);
+    set_projection(projection_matrix);
 
     basic_2D_shader.bind();
     laml::Mat4 projection_matrix_2D;
     laml::transform::create_projection_orthographic(projection_matrix_2D, -180.0f, 180.0f, -90.0f, 90.0f, -1.0f, 1.0f);
     basic_2D_shader.set_uniform("r_Projection", projection_matrix_2D);
+    track_2D_shader.bind();
+    track_2D_shader.set_uniform("r_Projection", projection_matrix_2D);
 
     init_recording();
 
@@ -366,15 +480,43 @@ int32 opengl_renderer::init_gl_glfw(base_app* app_ptr, int32 width, int32 height
 void opengl_renderer::set_projection(const laml::Mat4& mat) {
     projection_matrix = mat;
 
-    basic_shader.bind();
-    basic_shader.set_uniform("r_Projection", projection_matrix);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, camera_matrix_size, camera_matrix_size, projection_matrix._data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
 
-    line_shader.bind();
-    line_shader.set_uniform("r_Projection", projection_matrix);
+// Planes of the clip matrix from the view and render frame back to the
+// positions instances are given in (Gribb & Hartmann).
+void opengl_renderer::update_frustum(const mat4f& view_matrix) {
+    mat4f clip = laml::mul(projection_matrix, laml::mul(view_matrix, mat4f(render_frame)));
+    auto row = [&clip](int r) {
+        // column-major storage
+        return laml::Vec4(clip._data[r], clip._data[4 + r], clip._data[8 + r], clip._data[12 + r]);
+    };
+    laml::Vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    laml::Vec4 planes[6] = {
+        laml::Vec4(r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w),
+        laml::Vec4(r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w),
+        laml::Vec4(r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w),
+        laml::Vec4(r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w),
+        laml::Vec4(r3.x + r2.x, r3.y + r2.y, r3.z + r2.z, r3.w + r2.w),
+        laml::Vec4(r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w),
+    };
+    for (int k = 0; k < 6; k++) {
+        const laml::Vec4& p = planes[k];
+        float inv_length = 1.0f / sqrtf(p.x*p.x + p.y*p.y + p.z*p.z);
+        frustum.planes[k] = laml::Vec4(p.x*inv_length, p.y*inv_length, p.z*inv_length, p.w*inv_length);
+    }
+
+    frustum.depth_row = r3;
+    frustum.pixels_per_unit = 0.5f*window_height*projection_matrix._data[5];
 }
 
 void opengl_renderer::shutdown() {
     // Cleanup
+    assets.shutdown();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImPlot::DestroyContext();
@@ -437,77 +579,208 @@ void opengl_renderer::setup_frame(const laml::Vec3& cam_pos, float cam_yaw, floa
                                   float new_render_scale){
     render_frame = new_render_frame;
     render_scale = new_render_scale;
+    camera_position = cam_pos;
 
-    {
-        line_shader.bind();
-
-        laml::Mat4 cam_transform, view_matrix;
-        laml::transform::create_transform(cam_transform, cam_yaw, cam_pitch, 0.0f, cam_pos);
-        laml::transform::create_view_matrix_from_transform(view_matrix, cam_transform);
-        line_shader.set_uniform("r_View", view_matrix);
+    laml::Mat4 cam_transform, view_matrix;
+    laml::transform::create_transform(cam_transform, cam_yaw, cam_pitch, 0.0f, cam_pos);
+    laml::transform::create_view_matrix_from_transform(view_matrix, cam_transform);
 
-        vec3f color(1.0f, 1.0f, 1.0f);
-        line_shader.set_uniform("r_color", color);
-
-        float alpha = 1.0f;
-        line_shader.set_uniform("r_alpha", alpha);
-    }
+    // one upload for every 3D shader
+    glBindBuffer(GL_UNIFORM_BUFFER, camera_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, camera_matrix_size, view_matrix._data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    {
-        basic_shader.bind();
+    update_frustum(view_matrix);
 
-        laml::Mat4 cam_transform, view_matrix;
-        laml::transform::create_transform(cam_transform, cam_yaw, cam_pitch, 0.0f, cam_pos);
-        laml::transform::create_view_matrix_from_transform(view_matrix, cam_transform);
-        line_shader.set_uniform("r_View", view_matrix);
-    }
+    line_shader.set_uniform("r_color", vec3f(1.0f, 1.0f, 1.0f));
+    line_shader.set_uniform("r_alpha", 1.0f);
 }
 
 void opengl_renderer::bind_texture(const texture& tex) {
+    current_texture = tex.handle;
+    if (recording_draw_list)
+        return;
+
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, tex.handle);
 }
 
+// deferred draw list
+void opengl_renderer::begin_draw_list() {
+    draw_list.clear();
+    recording_draw_list = true;
+}
+
+void opengl_renderer::end_draw_list() {
+    recording_draw_list = false;
+
+    // opaque first, grouped by shader, then texture, then vertex array;
+    // translucent after, farthest first. Stable so equal keys keep their
+    // submission order.
+    std::stable_sort(draw_list.begin(), draw_list.end(), [](const draw_command& a, const draw_command& b) {
+        return a.sort_key < b.sort_key;
+    });
+
+    const shader_program* bound_shader = nullptr;
+    uint32 bound_texture = 0xFFFFFFFF;
+    uint32 bound_handle = 0xFFFFFFFF;
+    vec3f bound_color(-1.0f, -1.0f, -1.0f);
+    float bound_alpha = -1.0f;
+
+    for (const draw_command& cmd : draw_list) {
+        if (cmd.shader != bound_shader) {
+            cmd.shader->bind();
+            bound_shader = cmd.shader;
+            bound_alpha = -1.0f;
+            bound_color = vec3f(-1.0f, -1.0f, -1.0f);
+        }
+        if (cmd.shader == &basic_shader && cmd.texture != bound_texture) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, cmd.texture);
+            bound_texture = cmd.texture;
+        }
+
+        cmd.shader->set_uniform("r_Transform", cmd.transform);
+        if (cmd.shader == &line_shader) {
+            if (cmd.color.x != bound_color.x || cmd.color.y != bound_color.y || cmd.color.z != bound_color.z) {
+                line_shader.set_uniform("r_color", cmd.color);
+                bound_color = cmd.color;
+            }
+            if (cmd.alpha != bound_alpha) {
+                line_shader.set_uniform("r_alpha", cmd.alpha);
+                bound_alpha = cmd.alpha;
+            }
+        }
+
+        if (cmd.handle != bound_handle) {
+            glBindVertexArray(cmd.handle);
+            bound_handle = cmd.handle;
+        }
+        glDrawElements(cmd.mode, cmd.count, cmd.index_type, 0);
+    }
+    glBindVertexArray(0);
+
+    // leave the last texture bound like immediate mode would
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, current_texture);
+
+    draw_list.clear();
+}
+
+void opengl_renderer::submit(const shader_program& shader, uint32 handle, uint32 mode, uint32 count, uint32 index_type,
+                             const mat4f& transform, const vec3f& color, float alpha,
+                             const vec3f& position) {
+    if (!recording_draw_list) {
+        shader.bind();
+        shader.set_uniform("r_Transform", transform);
+        if (&shader == &line_shader) {
+            line_shader.set_uniform("r_color", color);
+            line_shader.set_uniform("r_alpha", alpha);
+        }
+        glBindVertexArray(handle);
+        glDrawElements(mode, count, index_type, 0);
+        return;
+    }
+
+    draw_command cmd;
+    cmd.shader = &shader;
+    cmd.handle = handle;
+    cmd.mode = mode;
+    cmd.count = count;
+    cmd.index_type = index_type;
+    cmd.texture = current_texture;
+    cmd.transform = transform;
+    cmd.color = color;
+    cmd.alpha = alpha;
+
+    if (alpha < 1.0f) {
+        // back to front by distance to the camera; non-negative floats sort
+        // like their bit patterns, so invert them for descending order
+        float depth = laml::length(laml::transform::transform_point(render_frame, position) - camera_position);
+        uint32 depth_bits;
+        memcpy(&depth_bits, &depth, sizeof(depth_bits));
+        cmd.sort_key = (uint64(1) << 63) | uint64(~depth_bits);
+    } else {
+        bool textured = (&shader == &basic_shader);
+        uint64 shader_index = textured ? 0 : 1;
+        uint64 texture_bits = textured ? (cmd.texture & 0xFFFFF) : 0;
+        cmd.sort_key = (shader_index << 56) | (texture_bits << 32) | uint64(handle);
+    }
+    draw_list.push_back(cmd);
+}
+
 void opengl_renderer::draw_mesh(const triangle_mesh& mesh, 
                                 const laml::Vec3& position, 
                                 const laml::Quat& orientation) {
-    basic_shader.bind();
-
     laml::Mat4 transform_matrix;
     //laml::transform::create_transform_translate(transform_matrix, position);
     //transform_matrix = laml::mul(laml::Mat4(render_frame), transform_matrix);
     laml::Quat r = laml::transform::quat_from_mat(render_frame);
-    vec3f scale_vec(render_scale, render_scale, render_scale);
+    vec3f scale_vec(render_scale*mesh.scale.x, render_scale*mesh.scale.y, render_scale*mesh.scale.z);
 
     //laml::transform::create_transform(transform_matrix, laml::mul(r, orientation), laml::transform::transform_point(render_frame, position), scale_vec);
     laml::transform::create_transform(transform_matrix, orientation, position, scale_vec);
-    basic_shader.set_uniform("r_Transform", laml::mul(mat4f(render_frame), transform_matrix));
+    transform_matrix = laml::mul(mat4f(render_frame), transform_matrix);
 
     for (int n = 0; n < mesh.num_prims; n++) {
-        glBindVertexArray(mesh.handles[n]);
-        glDrawElements(GL_TRIANGLES, mesh.num_inds[n], GL_UNSIGNED_INT, 0);
+        submit(basic_shader, mesh.handles[n], GL_TRIANGLES, mesh.num_inds[n], mesh.index_types[n], transform_matrix,
+               vec3f(1.0f, 1.0f, 1.0f), 1.0f, position);
     }
 }
 
-void opengl_renderer::draw_path(uint32 handle, uint32 N, vec3f color, float alpha) {
-    line_shader.bind();
+void opengl_renderer::draw_mesh_instanced(const triangle_mesh& mesh, instance_batch& batch,
+                                          float impostor_pixels, vec3f impostor_color) {
+    if (batch.size() == 0)
+        return;
+
+    batch.cull_and_upload(frustum, mesh.bounding_radius*render_scale, impostor_pixels);
+    if (recording_draw_list) {
+        // drawn right away, so it needs the texture the list hasn't bound yet
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, current_texture);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, batch.ssbo);
+
+    mat4f frame_matrix(render_frame);
+
+    if (batch.num_drawn_meshes > 0) {
+        instanced_shader.bind();
+        instanced_shader.set_uniform("r_Transform", frame_matrix);
+        instanced_shader.set_uniform("r_scale", render_scale*mesh.scale);
+
+        for (int n = 0; n < mesh.num_prims; n++) {
+            glBindVertexArray(mesh.handles[n]);
+            glDrawElementsInstanced(GL_TRIANGLES, mesh.num_inds[n], mesh.index_types[n], 0, batch.num_drawn_meshes);
+        }
+    }
 
+    if (batch.num_drawn_impostors > 0) {
+        impostor_shader.bind();
+        impostor_shader.set_uniform("r_Transform", frame_matrix);
+        impostor_shader.set_uniform("r_first", batch.num_drawn_meshes);
+        impostor_shader.set_uniform("r_point_size", impostor_pixels);
+        impostor_shader.set_uniform("r_color", impostor_color);
+
+        glEnable(GL_PROGRAM_POINT_SIZE);
+        glBindVertexArray(batch.point_handle);
+        glDrawArrays(GL_POINTS, 0, batch.num_drawn_impostors);
+        glDisable(GL_PROGRAM_POINT_SIZE);
+    }
+
+    glBindVertexArray(0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+}
+
+void opengl_renderer::draw_path(uint32 handle, uint32 N, vec3f color, float alpha) {
     laml::Mat4 transform_matrix;
     laml::Quat r = laml::transform::quat_from_mat(render_frame);
 
     laml::transform::create_transform_rotation(transform_matrix, r);
-    line_shader.set_uniform("r_Transform", transform_matrix);
-
-    line_shader.set_uniform("r_color", color);
-    line_shader.set_uniform("r_alpha", alpha);
 
-    glBindVertexArray(handle);
-    glDrawElements(GL_LINE_LOOP, N, GL_UNSIGNED_INT, 0);
+    submit(line_shader, handle, GL_LINE_LOOP, N, GL_UNSIGNED_INT, transform_matrix, color, alpha);
 }
 
 void opengl_renderer::draw_plane(vec3f normal, float scale, vec3f color, float alpha) {
-    line_shader.bind();
-
     vec3f Z_vec(0.0f, 0.0f, 1.0f);
 
     vec3f tangent = laml::cross(Z_vec, normal);
@@ -523,16 +796,12 @@ void opengl_renderer::draw_plane(vec3f normal, float scale, vec3f color, float a
     mat3f rot(normal, tangent, bitangent);
     laml::Mat4 transform_matrix(laml::mul(render_frame, rot*scale));
 
-    line_shader.set_uniform("r_Transform", transform_matrix);
-    line_shader.set_uniform("r_color", color);
-    line_shader.set_uniform("r_alpha", alpha);
-
-    glBindVertexArray(plane_handle);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    submit(line_shader, plane_handle, GL_TRIANGLES, 6, GL_UNSIGNED_INT, transform_matrix, color, alpha);
 }
 
 void opengl_renderer::draw_vector(vec3f vector, float scale, vec3f color, float alpha) {
-    line_shader.bind();
+    if (vector_mesh.num_prims == 0)
+        return; // still loading
 
     vector = laml::normalize(vector);
     vec3f Z_vec(0.0f, 0.0f, 1.0f);
@@ -547,16 +816,12 @@ void opengl_renderer::draw_vector(vec3f vector, float scale, vec3f color, float
     }
     vec3f bitangent = laml::cross(vector, tangent);
 
-    mat3f rot(vector, tangent, bitangent);
+    const vec3f& mesh_scale = vector_mesh.scale;
+    mat3f rot(vector*mesh_scale.x, tangent*mesh_scale.y, bitangent*mesh_scale.z);
     laml::Mat4 transform_matrix(laml::mul(render_frame, rot*scale*render_scale));
 
-    line_shader.set_uniform("r_Transform", transform_matrix);
-
-    line_shader.set_uniform("r_color", color);
-    line_shader.set_uniform("r_alpha", alpha);
-
-    glBindVertexArray(vector_mesh.handles[0]);
-    glDrawElements(GL_TRIANGLES, vector_mesh.num_inds[0], GL_UNSIGNED_INT, 0);
+    submit(line_shader, vector_mesh.handles[0], GL_TRIANGLES, vector_mesh.num_inds[0], vector_mesh.index_types[0],
+           transform_matrix, color, alpha);
 }
 
 // 2D pass
@@ -593,6 +858,21 @@ void opengl_renderer::draw_dot(float lat, float lon, const vec3f& color, float a
     glBindVertexArray(dot_handle);
     glDrawElements(GL_TRIANGLES, num_dot_inds, GL_UNSIGNED_INT, 0);
 }
+
+void opengl_renderer::draw_ground_tracks(ground_track_history& tracks) {
+    if (tracks.num_filled == 0)
+        return;
+
+    tracks.upload();
+
+    track_2D_shader.bind();
+    glLineWidth(2.0f);
+    glBindVertexArray(tracks.handle);
+    glDrawArrays(GL_LINES, 0, tracks.num_filled*tracks.num_tracks*ground_track_history::vertices_per_sample);
+    glBindVertexArray(0);
+    glLineWidth(4.0f);
+}
+
 void opengl_renderer::end_2D_render() {
     glEnable(GL_DEPTH_TEST);
 
@@ -615,37 +895,14 @@ void opengl_renderer::end_debug_UI() {
 }
 
 void opengl_renderer::end_frame(){
-    glfwSwapBuffers((GLFWwindow*)raw_glfw_window);
-
     // RECORDING
 #if USE_DTV
-    atg_dtv::Frame *frame = encoder.newFrame(false);
-    if (frame) {
-        if (encoder.getError() != atg_dtv::Encoder::Error::None) {
-            spdlog::error("RTV Error!");
-        }
-
-        // NOTE: This is very SLOW!! possibly need to look into pixel buffer objects?
-        //       not an issue rn tho...
-        //glReadPixels(0, 0, window_width, window_height, GL_RGB, GL_UNSIGNED_BYTE, frame->m_rgb);
-
-        if (tmp_buffer == nullptr) {
-            tmp_buffer = new uint8[(size_t)frame->m_maxHeight * frame->m_lineWidth];
-        }
-        glReadPixels(0, 0, window_width, window_height, GL_RGB, GL_UNSIGNED_BYTE, tmp_buffer);
-        const int lineWidth = frame->m_lineWidth;
-        for (int y = 0; y < frame->m_maxHeight; ++y) {
-            uint8_t *row_src = &tmp_buffer[(frame->m_maxHeight - y - 1) * lineWidth];
-            uint8_t *row_dst = &frame->m_rgb[y * lineWidth];
-
-            memcpy(row_dst, row_src, frame->m_lineWidth);
-        }
-
-        encoder.submitFrame();
-    } else {
-        spdlog::info("RTV Done!");
-    }
+    // the back buffer is undefined after the swap, so read it first. the
+    // read is asynchronous, the frame reaches the encoder a few frames later
+    capture.read();
 #endif
+
+    glfwSwapBuffers((GLFWwindow*)raw_glfw_window);
 }
 
 bool opengl_renderer::init_recording() {
@@ -671,19 +928,44 @@ bool opengl_renderer::init_recording() {
     const int FrameCount = VideoLengthSeconds * settings.frameRate;
 
     encoder.run(settings, 2);
+
+    // runs on the capture thread, flips rows into the encoder's frame
+    capture.init(window_width, window_height, DTV_CAPTURE_LATENCY,
+                 [this, done = false](const uint8* pixels, int32 width, int32 height, uint32 row_pitch) mutable {
+        atg_dtv::Frame *frame = encoder.newFrame(false);
+        if (frame == nullptr) {
+            if (!done)
+                spdlog::info("RTV Done!");
+            done = true;
+            return;
+        }
+        if (encoder.getError() != atg_dtv::Encoder::Error::None) {
+            spdlog::error("RTV Error!");
+        }
+
+        const int lineWidth = frame->m_lineWidth;
+        const int rows = frame->m_maxHeight < height ? frame->m_maxHeight : height;
+        const size_t row_size = (uint32)lineWidth < row_pitch ? (size_t)lineWidth : (size_t)row_pitch;
+        for (int y = 0; y < rows; ++y) {
+            const uint8 *row_src = &pixels[(size_t)(height - y - 1) * row_pitch];
+            uint8_t *row_dst = &frame->m_rgb[y * lineWidth];
+
+            memcpy(row_dst, row_src, row_size);
+        }
+
+        encoder.submitFrame();
+    });
 #endif
     return true;
 }
 
 bool opengl_renderer::stop_recording() {
 #if USE_DTV
+    // flush the frames still in flight before closing the file
+    capture.shutdown();
+
     encoder.commit();
     encoder.stop();
-
-    if (tmp_buffer) {
-        delete[] tmp_buffer;
-    }
-    tmp_buffer = nullptr;
 #endif
     return true;
 }
@@ -4,10 +4,16 @@
 #include "mesh.h"
 #include "texture.h"
 #include "shader_program.h"
+#include "ground_track.h"
+#include "instance_batch.h"
+#include "asset_loader.h"
+
+#include <vector>
 
 // for recording
 #if USE_DTV
 #include "dtv.h"
+#include "frame_capture.h"
 #endif
 
 struct base_app;
@@ -21,9 +27,11 @@ struct opengl_renderer {
     bool should_window_close();
     double get_time();
     float get_AR() const { return ((float)window_width / (float)window_height); }
+    int32 get_height() const { return window_height; }
 
     void start_2D_render(const texture& bg);
     void draw_dot(float lat, float lon, const vec3f& color = vec3f(1.0f, 1.0f, 1.0f), float alpha = 1.0f);
+    void draw_ground_tracks(ground_track_history& tracks); // uploads new samples, then one draw call
     void end_2D_render();
     uint32 get_2D_output() const { return handle_2D_render_output; }
 
@@ -33,10 +41,21 @@ struct opengl_renderer {
                      const laml::Mat3& render_frame = laml::Mat3(),
                      float render_scale = 1.0f);
     
+    // Opt-in deferred drawing. In between, the 3D draw calls below are
+    // recorded instead of issued, then sorted by shader, texture and mesh
+    // (translucent ones last, back to front) and drawn with only the state
+    // changes between neighbours. draw_mesh_instanced still draws right away.
+    void begin_draw_list();
+    void end_draw_list();
+
     void bind_texture(const texture& tex);
     void draw_mesh(const triangle_mesh& mesh,
                    const laml::Vec3& position = laml::Vec3(),
                    const laml::Quat& orientation = laml::Quat());
+    // every instance in the batch: culled to the view, then one instanced draw
+    // per primitive, with anything under impostor_pixels across drawn as a dot
+    void draw_mesh_instanced(const triangle_mesh& mesh, instance_batch& batch,
+                             float impostor_pixels = 3.0f, vec3f impostor_color = vec3f(1.0f, 1.0f, 1.0f));
 
     void draw_path(uint32 handle, uint32 N,     vec3f color = vec3f(1.0f, 1.0f, 1.0f), float alpha = 1.0f);
     void draw_plane(vec3f normal, float scale,  vec3f color = vec3f(1.0f, 1.0f, 1.0f), float alpha = 1.0f);
@@ -47,14 +66,20 @@ struct opengl_renderer {
 
     void end_frame();
 
+    // background texture/mesh loading, finalized by base_app each frame
+    asset_loader assets;
+
 private:
     int32 window_width, window_height;
 
     void* raw_glfw_window;
 
     shader_program basic_2D_shader;
+    shader_program track_2D_shader;
     shader_program basic_shader;
     shader_program line_shader;
+    shader_program instanced_shader;
+    shader_program impostor_shader;
 
     uint32 box_2D_handle;
     uint32 handle_2D_render_output;
@@ -66,15 +91,38 @@ private:
     uint32 num_dot_inds;
     texture blank_tex;
 
+    struct draw_command {
+        uint64 sort_key;
+        const shader_program* shader;
+        uint32 handle, mode, count, index_type;
+        uint32 texture;
+        mat4f transform;
+        vec3f color;
+        float alpha;
+    };
+    std::vector<draw_command> draw_list;
+    bool recording_draw_list = false;
+    uint32 current_texture = 0;
+
+    // draws now, or records it while a draw list is open. position is only
+    // used to sort translucent draws.
+    void submit(const shader_program& shader, uint32 handle, uint32 mode, uint32 count, uint32 index_type,
+                const mat4f& transform, const vec3f& color, float alpha,
+                const vec3f& position = vec3f(0.0f, 0.0f, 0.0f));
+
     mat3f render_frame;
     float render_scale;
+    vec3f camera_position;
+    uint32 camera_ubo;
     mat4f projection_matrix;
+    view_frustum frustum;
+
+    void update_frustum(const mat4f& view_matrix);
 
     // video recording
 #if USE_DTV
     atg_dtv::Encoder encoder;
-
-    uint8 *tmp_buffer = nullptr;
+    frame_capture capture;
 #endif
     bool init_recording();
     bool stop_recording();
@@ -4,6 +4,7 @@
 
 #include "glad/gl.h"
 #include <stdio.h>
+#include <string.h>
 
 static int success;
 static char infoLog[512];
@@ -36,6 +37,7 @@ bool shader_program::create_shader_from_source(const char* vertex_src, const cha
     }
 
     handle = shaderProgram; //save handle
+    cache_uniform_locations();
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
@@ -82,23 +84,49 @@ void shader_program::bind() const {
     glUseProgram(handle);
 }
 
-void shader_program::set_uniform(const char* name, uint32 value){
-    int location = glGetUniformLocation(handle, name);
-    glUniform1i(location, value);
+void shader_program::cache_uniform_locations() {
+    uniforms.clear();
+
+    int32 num_uniforms = 0;
+    glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &num_uniforms);
+    for (int32 n = 0; n < num_uniforms; n++) {
+        uniform_location u;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(handle, n, sizeof(u.name), nullptr, &size, &type, u.name);
+
+        // arrays are reported as "name[0]"
+        char* bracket = strchr(u.name, '[');
+        if (bracket)
+            *bracket = '\0';
+
+        // block members have no location of their own
+        u.location = glGetUniformLocation(handle, u.name);
+        if (u.location >= 0)
+            uniforms.push_back(u);
+    }
+}
+
+int32 shader_program::get_uniform_location(const char* name) const {
+    for (const uniform_location& u : uniforms) {
+        if (strcmp(u.name, name) == 0)
+            return u.location;
+    }
+    return -1;
+}
+
+void shader_program::set_uniform(const char* name, uint32 value) const {
+    glProgramUniform1i(handle, get_uniform_location(name), value);
+}
+void shader_program::set_uniform(const char* name, float value) const {
+    glProgramUniform1f(handle, get_uniform_location(name), value);
 }
-void shader_program::set_uniform(const char* name, float value){
-    int location = glGetUniformLocation(handle, name);
-    glUniform1f(location, value);
+void shader_program::set_uniform(const char* name, const laml::Vec2& value) const {
+    glProgramUniform2fv(handle, get_uniform_location(name), 1, value._data);
 }
-void shader_program::set_uniform(const char* name, const laml::Vec2& value){
-    int location = glGetUniformLocation(handle, name);
-    glUniform2fv(location, 1, value._data);
+void shader_program::set_uniform(const char* name, const vec3f& value) const {
+    glProgramUniform3fv(handle, get_uniform_location(name), 1, value._data);
 }
-void shader_program::set_uniform(const char* name, const vec3f& value){
-    int location = glGetUniformLocation(handle, name);
-    glUniform3fv(location, 1, value._data);
+void shader_program::set_uniform(const char* name, const mat4f& value) const {
+    glProgramUniformMatrix4fv(handle, get_uniform_location(name), 1, GL_FALSE, value._data);
 }
-void shader_program::set_uniform(const char* name, const mat4f& value){
-    int location = glGetUniformLocation(handle, name);
-    glUniformMatrix4fv(location, 1, GL_FALSE, value._data);
-}
\ No newline at end of file
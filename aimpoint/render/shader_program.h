@@ -1,21 +1,35 @@
 #pragma once
 #include "defines.h"
 
+#include <vector>
+
 struct shader_program {
 
     bool create_shader_from_source(const char* vertex_src, const char* fragment_src);
 
     void bind() const;
 
-    void set_uniform(const char* name, uint32 value);
-    void set_uniform(const char* name, float value);
-    void set_uniform(const char* name, const laml::Vec2& value);
-    void set_uniform(const char* name, const vec3f& value);
-    void set_uniform(const char* name, const mat4f& value);
+    // Set on this program whether or not it's bound. Locations are looked up
+    // once at link time; unknown names are ignored like GL's -1.
+    void set_uniform(const char* name, uint32 value) const;
+    void set_uniform(const char* name, float value) const;
+    void set_uniform(const char* name, const laml::Vec2& value) const;
+    void set_uniform(const char* name, const vec3f& value) const;
+    void set_uniform(const char* name, const mat4f& value) const;
+
+    int32 get_uniform_location(const char* name) const;
 
 private:
     uint32 handle = 0;
 
+    struct uniform_location {
+        char name[64];
+        int32 location;
+    };
+    std::vector<uniform_location> uniforms;
+
+    void cache_uniform_locations();
+
     enum class stage {
         vertex = 1,
         geometry,
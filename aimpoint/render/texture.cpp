@@ -1,69 +1,47 @@
 #include "texture.h"
+#include "texture_cache.h"
 
 #include "log.h"
 
 #include "stb/stb_image.h"
 #include "glad/gl.h"
-#include <stdio.h>
 
 bool texture::load_texture_file(const char* filename) {
     // load texture
     stbi_set_flip_vertically_on_load(true);
-    int width_, height_, num_comp_;
-    uint8* data = stbi_load(filename, &width_, &height_, &num_comp_, 0);
-
-    if (data == nullptr) {
-        // try one more directory up
-        char new_filename[256];
-        snprintf(new_filename, 256, "../%s", filename);
-
-        data = stbi_load(new_filename, &width_, &height_, &num_comp_, 0);
-        if (data == nullptr) {
-            char new_new_filename[256];
-            snprintf(new_new_filename, 256, "../%s", new_filename);
-
-            data = stbi_load(new_new_filename, &width_, &height_, &num_comp_, 0);
-
-            if (data == nullptr) {
-                spdlog::critical("Could not open image file!\n");
-                return false;
-            }
-        }
+    texture_data data;
+    if (!load_texture_data(data, filename)) {
+        spdlog::critical("Could not open image file!\n");
+        return false;
     }
 
-    width = width_;
-    height = height_;
-    num_components = num_comp_;
-    spdlog::info("Loaded image! {0}x{1}x{2}", width, height, num_components);
+    upload(data);
 
-    glGenTextures(1, &handle);
-    glBindTexture(GL_TEXTURE_2D, handle);
+    return true;
+}
 
-    GLenum InternalFormat = 0;
-    GLenum Format = 0;
+static void get_formats(uint32 num_components, GLenum* internal_format, GLenum* format) {
     switch (num_components) {
         case 1: {
-            InternalFormat = GL_R8;
-            Format = GL_RED;
+            *internal_format = GL_R8;
+            *format = GL_RED;
         } break;
         case 2: {
-            InternalFormat = GL_RG8;
-            Format = GL_RG;
+            *internal_format = GL_RG8;
+            *format = GL_RG;
         } break;
         case 3: {
-            InternalFormat = GL_RGB8;
-            Format = GL_RGB;
+            *internal_format = GL_RGB8;
+            *format = GL_RGB;
         } break;
         case 4: {
-            InternalFormat = GL_RGBA8;
-            Format = GL_RGBA;
+            *internal_format = GL_RGBA8;
+            *format = GL_RGBA;
         } break;
     }
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, width, height, 0, Format, GL_UNSIGNED_BYTE, data);
-    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, ResolutionX, ResolutionY, 0, GL_RED, GL_UNSIGNED_BYTE, Bitmap);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
+static void set_parameters() {
     // This for font texture
     //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
@@ -76,8 +54,50 @@ bool texture::load_texture_file(const char* filename) {
     GLfloat val;
     glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &val);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY , val);
+}
 
-    stbi_image_free(data);
+void texture::upload(const texture_data& data) {
+    width = data.width;
+    height = data.height;
+    num_components = data.num_components;
+    spdlog::info("Loaded image! {0}x{1}x{2}, {3} levels", width, height, num_components, data.num_levels);
 
-    return true;
+    glGenTextures(1, &handle);
+    glBindTexture(GL_TEXTURE_2D, handle);
+
+    GLenum InternalFormat = 0;
+    GLenum Format = 0;
+    get_formats(num_components, &InternalFormat, &Format);
+
+    // mips come precomputed, one upload per level. rows are tightly packed,
+    // which the small RGB levels need
+    glTexStorage2D(GL_TEXTURE_2D, data.num_levels, InternalFormat, width, height);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32 n = 0; n < data.num_levels; n++) {
+        glTexSubImage2D(GL_TEXTURE_2D, n, 0, 0, data.levels[n].width, data.levels[n].height,
+                        Format, GL_UNSIGNED_BYTE, data.get_level(n));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    set_parameters();
+}
+
+void texture::upload(const uint8* data, uint32 set_width, uint32 set_height, uint32 set_num_components) {
+    width = set_width;
+    height = set_height;
+    num_components = set_num_components;
+    spdlog::info("Loaded image! {0}x{1}x{2}", width, height, num_components);
+
+    glGenTextures(1, &handle);
+    glBindTexture(GL_TEXTURE_2D, handle);
+
+    GLenum InternalFormat = 0;
+    GLenum Format = 0;
+    get_formats(num_components, &InternalFormat, &Format);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, width, height, 0, Format, GL_UNSIGNED_BYTE, data);
+    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, ResolutionX, ResolutionY, 0, GL_RED, GL_UNSIGNED_BYTE, Bitmap);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    set_parameters();
 }
\ No newline at end of file
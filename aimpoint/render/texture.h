@@ -1,6 +1,8 @@
 #pragma once
 #include "defines.h"
 
+struct texture_data;
+
 struct texture {
 
     bool load_texture_file(const char* filename);
@@ -13,5 +15,10 @@ private:
 
     uint32 handle = 0;
 
+    // split so decoding can happen off the GL thread (see texture_cache.h)
+    void upload(const texture_data& data);
+    void upload(const uint8* data, uint32 width, uint32 height, uint32 num_components);
+
     friend struct opengl_renderer;
+    friend struct asset_loader;
 };
\ No newline at end of file
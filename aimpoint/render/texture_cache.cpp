@@ -0,0 +1,177 @@
+#include "texture_cache.h"
+
+#include "log.h"
+
+#include "stb/stb_image.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static uint64 hash_bytes(const uint8* data, uint64 size) {
+    uint64 hash = 0xcbf29ce484222325ull;
+    for (uint64 n = 0; n < size; n++) {
+        hash ^= data[n];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64 align_up(uint64 offset) {
+    return (offset + texture_cache_alignment - 1) & ~(texture_cache_alignment - 1);
+}
+
+// 2x2 box filter, the last row/column is reused on odd sizes
+static void downsample(const uint8* src, uint32 src_width, uint32 src_height,
+                       uint8* dst, uint32 dst_width, uint32 dst_height, uint32 num_components) {
+    for (uint32 y = 0; y < dst_height; y++) {
+        const uint8* row0 = src + (uint64)src_width*num_components*(2*y < src_height ? 2*y : src_height-1);
+        const uint8* row1 = src + (uint64)src_width*num_components*(2*y+1 < src_height ? 2*y+1 : src_height-1);
+        for (uint32 x = 0; x < dst_width; x++) {
+            uint32 x0 = (2*x < src_width ? 2*x : src_width-1)*num_components;
+            uint32 x1 = (2*x+1 < src_width ? 2*x+1 : src_width-1)*num_components;
+            for (uint32 c = 0; c < num_components; c++) {
+                uint32 sum = row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c];
+                dst[((uint64)y*dst_width + x)*num_components + c] = (uint8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+const uint8* texture_data::get_level(uint32 level) const {
+    const uint8* base = cache.is_open() ? cache.get_data() : built.data();
+    return base + levels[level].offset;
+}
+
+void texture_data::release() {
+    cache.close();
+    built.clear();
+    built.shrink_to_fit();
+}
+
+// checks a mapped cache against the source it was built from
+static bool read_cache(const mapped_file& cache, uint64 source_hash, uint64 source_size,
+                       texture_cache_header& header, texture_cache_level* levels) {
+    const uint64 size = cache.get_size();
+    if (size < sizeof(header))
+        return false;
+    memcpy(&header, cache.get_data(), sizeof(header));
+    if (memcmp(header.magic, "TXCH", 4) != 0 || header.version != texture_cache_version ||
+        header.source_hash != source_hash || header.source_size != source_size || header.file_size != size ||
+        header.num_levels == 0 || header.num_levels > texture_cache_max_levels ||
+        header.num_components == 0 || header.num_components > 4)
+        return false;
+    if (sizeof(header) + sizeof(texture_cache_level)*header.num_levels > size)
+        return false;
+    memcpy(levels, cache.get_data() + sizeof(header), sizeof(texture_cache_level)*header.num_levels);
+
+    for (uint32 n = 0; n < header.num_levels; n++) {
+        const texture_cache_level& level = levels[n];
+        if (level.size != (uint64)level.width*level.height*header.num_components ||
+            level.offset > size || level.size > size - level.offset)
+            return false;
+    }
+    return true;
+}
+
+static bool write_cache(const std::string& cache_filename, const std::vector<uint8>& contents) {
+    // written aside and renamed, so a reader never maps half a file
+    std::string temp_filename = cache_filename + ".tmp";
+    FILE* fid = fopen(temp_filename.c_str(), "wb");
+    if (fid == nullptr)
+        return false;
+    bool written = fwrite(contents.data(), 1, contents.size(), fid) == contents.size();
+    fclose(fid);
+
+    remove(cache_filename.c_str());
+    if (!written || rename(temp_filename.c_str(), cache_filename.c_str()) != 0) {
+        remove(temp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_texture_data(texture_data& data, const char* filename) {
+    data.release();
+
+    mapped_file source;
+    std::string source_filename = filename;
+    if (!source.open(source_filename.c_str())) {
+        // try up to two directories up
+        source_filename = std::string("../") + filename;
+        if (!source.open(source_filename.c_str())) {
+            source_filename = std::string("../../") + filename;
+            if (!source.open(source_filename.c_str()))
+                return false;
+        }
+    }
+
+    const uint64 source_hash = hash_bytes(source.get_data(), source.get_size());
+    const std::string cache_filename = source_filename + ".tcache";
+
+    texture_cache_header header;
+    if (data.cache.open(cache_filename.c_str())) {
+        if (read_cache(data.cache, source_hash, source.get_size(), header, data.levels)) {
+            data.width = header.width;
+            data.height = header.height;
+            data.num_components = header.num_components;
+            data.num_levels = header.num_levels;
+            return true;
+        }
+        data.cache.close();
+        spdlog::info("Texture cache for '{0}' is out of date", filename);
+    }
+
+    int width, height, num_components;
+    uint8* pixels = stbi_load_from_memory(source.get_data(), (int)source.get_size(), &width, &height, &num_components, 0);
+    if (pixels == nullptr)
+        return false;
+
+    // lay out the whole file, every level down to 1x1
+    uint32 num_levels = 1;
+    while (num_levels < texture_cache_max_levels && ((width >> num_levels) > 0 || (height >> num_levels) > 0))
+        num_levels++;
+
+    uint64 offset = align_up(sizeof(texture_cache_header) + sizeof(texture_cache_level)*num_levels);
+    for (uint32 n = 0; n < num_levels; n++) {
+        texture_cache_level& level = data.levels[n];
+        level.width = (width >> n) > 0 ? (width >> n) : 1;
+        level.height = (height >> n) > 0 ? (height >> n) : 1;
+        level.offset = offset;
+        level.size = (uint64)level.width*level.height*num_components;
+        offset = align_up(offset + level.size);
+    }
+
+    data.built.assign(offset, 0);
+    uint8* out = data.built.data();
+    memcpy(out + data.levels[0].offset, pixels, data.levels[0].size);
+    stbi_image_free(pixels);
+    for (uint32 n = 1; n < num_levels; n++) {
+        const texture_cache_level& src = data.levels[n-1];
+        const texture_cache_level& dst = data.levels[n];
+        downsample(out + src.offset, src.width, src.height, out + dst.offset, dst.width, dst.height, num_components);
+    }
+
+    header = {};
+    memcpy(header.magic, "TXCH", 4);
+    header.version = texture_cache_version;
+    header.source_hash = source_hash;
+    header.source_size = source.get_size();
+    header.width = width;
+    header.height = height;
+    header.num_components = num_components;
+    header.num_levels = num_levels;
+    header.file_size = offset;
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), data.levels, sizeof(texture_cache_level)*num_levels);
+
+    data.width = width;
+    data.height = height;
+    data.num_components = num_components;
+    data.num_levels = num_levels;
+
+    if (write_cache(cache_filename, data.built))
+        spdlog::info("Wrote texture cache '{0}'", cache_filename);
+    else
+        spdlog::warn("Could not write texture cache '{0}'", cache_filename);
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "defines.h"
+
+#include "mapped_file.h"
+
+#include <vector>
+
+// Texture cache files (.tcache), written next to the source image. They
+// hold the decoded pixels and the whole mip chain in the layout
+// glTexSubImage2D takes, so a warm start maps the file and uploads each
+// level straight from the mapping. A cache is only used while the hash of
+// the source file matches; otherwise it's rebuilt. Levels start on
+// texture_cache_alignment byte boundaries.
+//
+//   texture_cache_header
+//   texture_cache_level[num_levels]
+//   pixels for each level, largest first
+//
+// Images are stored flipped, as every loader here asks stbi for them.
+
+static const uint32 texture_cache_version = 1;
+static const uint64 texture_cache_alignment = 16;
+static const uint32 texture_cache_max_levels = 16;
+
+struct texture_cache_header {
+    char magic[4]; // "TXCH"
+    uint32 version;
+    uint64 source_hash; // FNV-1a of the source file
+    uint64 source_size;
+    uint32 width;
+    uint32 height;
+    uint32 num_components;
+    uint32 num_levels;
+    uint64 file_size;
+};
+
+struct texture_cache_level {
+    uint32 width;
+    uint32 height;
+    uint64 offset; // bytes from the start of the file
+    uint64 size;
+};
+
+static_assert(sizeof(texture_cache_header) == 48, "texture_cache_header layout");
+static_assert(sizeof(texture_cache_level) == 24, "texture_cache_level layout");
+
+// An image and its mip chain, either mapped from a cache file or built from
+// the source. Levels are laid out the same way in both.
+struct texture_data {
+    uint32 width = 0;
+    uint32 height = 0;
+    uint32 num_components = 0;
+    uint32 num_levels = 0;
+    texture_cache_level levels[texture_cache_max_levels];
+
+    const uint8* get_level(uint32 level) const;
+    void release();
+
+private:
+    mapped_file cache;
+    std::vector<uint8> built; // a whole cache file, when it had to be rebuilt
+
+    friend bool load_texture_data(texture_data& data, const char* filename);
+};
+
+// Loads an image with every mip level, from its cache when that's current
+// and from the source otherwise (writing a new cache). No GL calls, so this
+// can run off the render thread.
+bool load_texture_data(texture_data& data, const char* filename);
@@ -0,0 +1,864 @@
+#include "sgp4.h"
+
+#include <cmath>
+
+// WGS-72, the constants the element sets are fitted with
+static const double radius_earth = 6378.135; // km
+static const double mu_earth = 398600.8;     // km^3/s^2
+static const double j2 = 0.001082616;
+static const double j3 = -0.00000253881;
+static const double j4 = -0.00000165597;
+static const double j3oj2 = j3 / j2;
+static const double xke = 60.0 / sqrt(radius_earth*radius_earth*radius_earth / mu_earth); // sqrt(GM) in er^1.5/min
+static const double tumin = 1.0 / xke;
+
+static const double pi = 3.14159265358979323846;
+static const double twopi = 2.0 * pi;
+static const double x2o3 = 2.0 / 3.0;
+
+// guard for 1 + cos(i) near i = 180 deg
+static const double temp4 = 1.5e-12;
+
+double sgp4_gmst(double jd_ut1) {
+    double tut1 = (jd_ut1 - 2451545.0) / 36525.0;
+    double temp = -6.2e-6*tut1*tut1*tut1 + 0.093104*tut1*tut1 +
+                  (876600.0*3600.0 + 8640184.812866)*tut1 + 67310.54841; // s
+    temp = fmod(temp * (pi/180.0) / 240.0, twopi);
+    if (temp < 0.0)
+        temp += twopi;
+    return temp;
+}
+
+// Lunar-solar long period periodics
+static void dpper(const sgp4_record& rec, double t,
+                  double* ep, double* inclp, double* nodep, double* argpp, double* mp) {
+    const double zns = 1.19459e-5;
+    const double zes = 0.01675;
+    const double znl = 1.5835218e-4;
+    const double zel = 0.05490;
+
+    // solar
+    double zm = rec.zmos + zns*t;
+    double zf = zm + 2.0*zes*sin(zm);
+    double sinzf = sin(zf);
+    double f2 = 0.5*sinzf*sinzf - 0.25;
+    double f3 = -0.5*sinzf*cos(zf);
+    double ses = rec.se2*f2 + rec.se3*f3;
+    double sis = rec.si2*f2 + rec.si3*f3;
+    double sls = rec.sl2*f2 + rec.sl3*f3 + rec.sl4*sinzf;
+    double sghs = rec.sgh2*f2 + rec.sgh3*f3 + rec.sgh4*sinzf;
+    double shs = rec.sh2*f2 + rec.sh3*f3;
+
+    // lunar
+    zm = rec.zmol + znl*t;
+    zf = zm + 2.0*zel*sin(zm);
+    sinzf = sin(zf);
+    f2 = 0.5*sinzf*sinzf - 0.25;
+    f3 = -0.5*sinzf*cos(zf);
+    double sel = rec.ee2*f2 + rec.e3*f3;
+    double sil = rec.xi2*f2 + rec.xi3*f3;
+    double sll = rec.xl2*f2 + rec.xl3*f3 + rec.xl4*sinzf;
+    double sghl = rec.xgh2*f2 + rec.xgh3*f3 + rec.xgh4*sinzf;
+    double shll = rec.xh2*f2 + rec.xh3*f3;
+
+    double pe = ses + sel - rec.peo;
+    double pinc = sis + sil - rec.pinco;
+    double pl = sls + sll - rec.plo;
+    double pgh = sghs + sghl - rec.pgho;
+    double ph = shs + shll - rec.pho;
+
+    *inclp += pinc;
+    *ep += pe;
+    double sinip = sin(*inclp);
+    double cosip = cos(*inclp);
+
+    // apply directly above 0.2 rad (perturbed inclination), otherwise use
+    // the Lyddane modification to stay well behaved near zero inclination
+    if (*inclp >= 0.2) {
+        ph = ph / sinip;
+        pgh = pgh - cosip*ph;
+        *argpp += pgh;
+        *nodep += ph;
+        *mp += pl;
+    } else {
+        double sinop = sin(*nodep);
+        double cosop = cos(*nodep);
+        double alfdp = sinip*sinop;
+        double betdp = sinip*cosop;
+        double dalf = ph*cosop + pinc*cosip*sinop;
+        double dbet = -ph*sinop + pinc*cosip*cosop;
+        alfdp += dalf;
+        betdp += dbet;
+        *nodep = fmod(*nodep, twopi);
+        double xls = *mp + *argpp + cosip*(*nodep);
+        double dls = pl + pgh - pinc*(*nodep)*sinip;
+        xls += dls;
+        double xnoh = *nodep;
+        *nodep = atan2(alfdp, betdp);
+        if (fabs(xnoh - *nodep) > pi) {
+            if (*nodep < xnoh)
+                *nodep += twopi;
+            else
+                *nodep -= twopi;
+        }
+        *mp += pl;
+        *argpp = xls - *mp - cosip*(*nodep);
+    }
+}
+
+// Lunar-solar terms shared by dpper and dsinit
+struct dscom_out {
+    double snodm, cnodm, sinim, cosim, sinomm, cosomm, day, em, emsq, gam, rtemsq, nm;
+    double s1, s2, s3, s4, s5, s6, s7;
+    double ss1, ss2, ss3, ss4, ss5, ss6, ss7;
+    double sz1, sz2, sz3, sz11, sz12, sz13, sz21, sz22, sz23, sz31, sz32, sz33;
+    double z1, z2, z3, z11, z12, z13, z21, z22, z23, z31, z32, z33;
+};
+
+static void dscom(double epoch_days, double ep, double argpp, double tc, double inclp, double nodep, double np,
+                  sgp4_record& rec, dscom_out& d) {
+    const double zes = 0.01675;
+    const double zel = 0.05490;
+    const double c1ss = 2.9864797e-6;
+    const double c1l = 4.7968065e-7;
+    const double zsinis = 0.39785416;
+    const double zcosis = 0.91744867;
+    const double zcosgs = 0.1945905;
+    const double zsings = -0.98088458;
+
+    d.nm = np;
+    d.em = ep;
+    d.snodm = sin(nodep);
+    d.cnodm = cos(nodep);
+    d.sinomm = sin(argpp);
+    d.cosomm = cos(argpp);
+    d.sinim = sin(inclp);
+    d.cosim = cos(inclp);
+    d.emsq = d.em*d.em;
+    double betasq = 1.0 - d.emsq;
+    d.rtemsq = sqrt(betasq);
+
+    rec.peo = 0.0;
+    rec.pinco = 0.0;
+    rec.plo = 0.0;
+    rec.pgho = 0.0;
+    rec.pho = 0.0;
+
+    d.day = epoch_days + 18261.5 + tc/1440.0;
+    double xnodce = fmod(4.5236020 - 9.2422029e-4*d.day, twopi);
+    double stem = sin(xnodce);
+    double ctem = cos(xnodce);
+    double zcosil = 0.91375164 - 0.03568096*ctem;
+    double zsinil = sqrt(1.0 - zcosil*zcosil);
+    double zsinhl = 0.089683511*stem / zsinil;
+    double zcoshl = sqrt(1.0 - zsinhl*zsinhl);
+    d.gam = 5.8351514 + 0.0019443680*d.day;
+    double zx = 0.39785416*stem / zsinil;
+    double zy = zcoshl*ctem + 0.91744867*zsinhl*stem;
+    zx = atan2(zx, zy);
+    zx = d.gam + zx - xnodce;
+    double zcosgl = cos(zx);
+    double zsingl = sin(zx);
+
+    // first pass is the Sun, second the Moon
+    double zcosg = zcosgs;
+    double zsing = zsings;
+    double zcosi = zcosis;
+    double zsini = zsinis;
+    double zcosh = d.cnodm;
+    double zsinh = d.snodm;
+    double cc = c1ss;
+    double xnoi = 1.0 / d.nm;
+
+    for (int lsflg = 1; lsflg <= 2; lsflg++) {
+        double a1 = zcosg*zcosh + zsing*zcosi*zsinh;
+        double a3 = -zsing*zcosh + zcosg*zcosi*zsinh;
+        double a7 = -zcosg*zsinh + zsing*zcosi*zcosh;
+        double a8 = zsing*zsini;
+        double a9 = zsing*zsinh + zcosg*zcosi*zcosh;
+        double a10 = zcosg*zsini;
+        double a2 = d.cosim*a7 + d.sinim*a8;
+        double a4 = d.cosim*a9 + d.sinim*a10;
+        double a5 = -d.sinim*a7 + d.cosim*a8;
+        double a6 = -d.sinim*a9 + d.cosim*a10;
+
+        double x1 = a1*d.cosomm + a2*d.sinomm;
+        double x2 = a3*d.cosomm + a4*d.sinomm;
+        double x3 = -a1*d.sinomm + a2*d.cosomm;
+        double x4 = -a3*d.sinomm + a4*d.cosomm;
+        double x5 = a5*d.sinomm;
+        double x6 = a6*d.sinomm;
+        double x7 = a5*d.cosomm;
+        double x8 = a6*d.cosomm;
+
+        d.z31 = 12.0*x1*x1 - 3.0*x3*x3;
+        d.z32 = 24.0*x1*x2 - 6.0*x3*x4;
+        d.z33 = 12.0*x2*x2 - 3.0*x4*x4;
+        d.z1 = 3.0*(a1*a1 + a2*a2) + d.z31*d.emsq;
+        d.z2 = 6.0*(a1*a3 + a2*a4) + d.z32*d.emsq;
+        d.z3 = 3.0*(a3*a3 + a4*a4) + d.z33*d.emsq;
+        d.z11 = -6.0*a1*a5 + d.emsq*(-24.0*x1*x7 - 6.0*x3*x5);
+        d.z12 = -6.0*(a1*a6 + a3*a5) + d.emsq*(-24.0*(x2*x7 + x1*x8) - 6.0*(x3*x6 + x4*x5));
+        d.z13 = -6.0*a3*a6 + d.emsq*(-24.0*x2*x8 - 6.0*x4*x6);
+        d.z21 = 6.0*a2*a5 + d.emsq*(24.0*x1*x5 - 6.0*x3*x7);
+        d.z22 = 6.0*(a4*a5 + a2*a6) + d.emsq*(24.0*(x2*x5 + x1*x6) - 6.0*(x4*x7 + x3*x8));
+        d.z23 = 6.0*a4*a6 + d.emsq*(24.0*x2*x6 - 6.0*x4*x8);
+        d.z1 = d.z1 + d.z1 + betasq*d.z31;
+        d.z2 = d.z2 + d.z2 + betasq*d.z32;
+        d.z3 = d.z3 + d.z3 + betasq*d.z33;
+        d.s3 = cc*xnoi;
+        d.s2 = -0.5*d.s3 / d.rtemsq;
+        d.s4 = d.s3*d.rtemsq;
+        d.s1 = -15.0*d.em*d.s4;
+        d.s5 = x1*x3 + x2*x4;
+        d.s6 = x2*x3 + x1*x4;
+        d.s7 = x2*x4 - x1*x3;
+
+        if (lsflg == 1) {
+            d.ss1 = d.s1; d.ss2 = d.s2; d.ss3 = d.s3; d.ss4 = d.s4;
+            d.ss5 = d.s5; d.ss6 = d.s6; d.ss7 = d.s7;
+            d.sz1 = d.z1; d.sz2 = d.z2; d.sz3 = d.z3;
+            d.sz11 = d.z11; d.sz12 = d.z12; d.sz13 = d.z13;
+            d.sz21 = d.z21; d.sz22 = d.z22; d.sz23 = d.z23;
+            d.sz31 = d.z31; d.sz32 = d.z32; d.sz33 = d.z33;
+            zcosg = zcosgl;
+            zsing = zsingl;
+            zcosi = zcosil;
+            zsini = zsinil;
+            zcosh = zcoshl*d.cnodm + zsinhl*d.snodm;
+            zsinh = d.snodm*zcoshl - d.cnodm*zsinhl;
+            cc = c1l;
+        }
+    }
+
+    rec.zmol = fmod(4.7199672 + 0.22997150*d.day - d.gam, twopi);
+    rec.zmos = fmod(6.2565837 + 0.017201977*d.day, twopi);
+
+    // solar
+    rec.se2 = 2.0*d.ss1*d.ss6;
+    rec.se3 = 2.0*d.ss1*d.ss7;
+    rec.si2 = 2.0*d.ss2*d.sz12;
+    rec.si3 = 2.0*d.ss2*(d.sz13 - d.sz11);
+    rec.sl2 = -2.0*d.ss3*d.sz2;
+    rec.sl3 = -2.0*d.ss3*(d.sz3 - d.sz1);
+    rec.sl4 = -2.0*d.ss3*(-21.0 - 9.0*d.emsq)*zes;
+    rec.sgh2 = 2.0*d.ss4*d.sz32;
+    rec.sgh3 = 2.0*d.ss4*(d.sz33 - d.sz31);
+    rec.sgh4 = -18.0*d.ss4*zes;
+    rec.sh2 = -2.0*d.ss2*d.sz22;
+    rec.sh3 = -2.0*d.ss2*(d.sz23 - d.sz21);
+
+    // lunar
+    rec.ee2 = 2.0*d.s1*d.s6;
+    rec.e3 = 2.0*d.s1*d.s7;
+    rec.xi2 = 2.0*d.s2*d.z12;
+    rec.xi3 = 2.0*d.s2*(d.z13 - d.z11);
+    rec.xl2 = -2.0*d.s3*d.z2;
+    rec.xl3 = -2.0*d.s3*(d.z3 - d.z1);
+    rec.xl4 = -2.0*d.s3*(-21.0 - 9.0*d.emsq)*zel;
+    rec.xgh2 = 2.0*d.s4*d.z32;
+    rec.xgh3 = 2.0*d.s4*(d.z33 - d.z31);
+    rec.xgh4 = -18.0*d.s4*zel;
+    rec.xh2 = -2.0*d.s2*d.z22;
+    rec.xh3 = -2.0*d.s2*(d.z23 - d.z21);
+}
+
+// Deep space secular rates and resonance setup
+static void dsinit(sgp4_record& rec, dscom_out& d, double tc, double xpidot, double eccsq,
+                   double* em, double* argpm, double* inclm, double* mm, double* nm, double* nodem) {
+    const double q22 = 1.7891679e-6;
+    const double q31 = 2.1460748e-6;
+    const double q33 = 2.2123015e-7;
+    const double root22 = 1.7891679e-6;
+    const double root44 = 7.3636953e-9;
+    const double root54 = 2.1765803e-9;
+    const double rptim = 4.37526908801129966e-3; // Earth rotation, rad/min
+    const double root32 = 3.7393792e-7;
+    const double root52 = 1.1428639e-7;
+    const double znl = 1.5835218e-4;
+    const double zns = 1.19459e-5;
+
+    // 24 h (synchronous) and 12 h eccentric (Molniya) resonances
+    rec.irez = 0;
+    if ((*nm < 0.0052359877) && (*nm > 0.0034906585))
+        rec.irez = 1;
+    if ((*nm >= 8.26e-3) && (*nm <= 9.24e-3) && (*em >= 0.5))
+        rec.irez = 2;
+
+    // solar
+    double ses = d.ss1*zns*d.ss5;
+    double sis = d.ss2*zns*(d.sz11 + d.sz13);
+    double sls = -zns*d.ss3*(d.sz1 + d.sz3 - 14.0 - 6.0*d.emsq);
+    double sghs = d.ss4*zns*(d.sz31 + d.sz33 - 6.0);
+    double shs = -zns*d.ss2*(d.sz21 + d.sz23);
+    if ((*inclm < 5.2359877e-2) || (*inclm > pi - 5.2359877e-2))
+        shs = 0.0;
+    if (d.sinim != 0.0)
+        shs = shs / d.sinim;
+    double sgs = sghs - d.cosim*shs;
+
+    // lunar
+    rec.dedt = ses + d.s1*znl*d.s5;
+    rec.didt = sis + d.s2*znl*(d.z11 + d.z13);
+    rec.dmdt = sls - znl*d.s3*(d.z1 + d.z3 - 14.0 - 6.0*d.emsq);
+    double sghl = d.s4*znl*(d.z31 + d.z33 - 6.0);
+    double shll = -znl*d.s2*(d.z21 + d.z23);
+    if ((*inclm < 5.2359877e-2) || (*inclm > pi - 5.2359877e-2))
+        shll = 0.0;
+    rec.domdt = sgs + sghl;
+    rec.dnodt = shs;
+    if (d.sinim != 0.0) {
+        rec.domdt = rec.domdt - d.cosim / d.sinim*shll;
+        rec.dnodt = rec.dnodt + shll / d.sinim;
+    }
+
+    double dndt = 0.0;
+    double theta = fmod(rec.gsto + tc*rptim, twopi);
+    *em += rec.dedt*rec.t;
+    *inclm += rec.didt*rec.t;
+    *argpm += rec.domdt*rec.t;
+    *nodem += rec.dnodt*rec.t;
+    *mm += rec.dmdt*rec.t;
+
+    if (rec.irez == 0)
+        return;
+
+    double aonv = pow(*nm / xke, x2o3);
+
+    if (rec.irez == 2) {
+        double cosisq = d.cosim*d.cosim;
+        double emo = *em;
+        *em = rec.ecco;
+        double emsqo = d.emsq;
+        d.emsq = eccsq;
+        double e = *em;
+        double esq = d.emsq;
+        double eoc = e*esq;
+        double g201 = -0.306 - (e - 0.64)*0.440;
+        double g211, g310, g322, g410, g422, g520, g521, g532, g533;
+
+        if (e <= 0.65) {
+            g211 = 3.616 - 13.2470*e + 16.2900*esq;
+            g310 = -19.302 + 117.3900*e - 228.4190*esq + 156.5910*eoc;
+            g322 = -18.9068 + 109.7927*e - 214.6334*esq + 146.5816*eoc;
+            g410 = -41.122 + 242.6940*e - 471.0940*esq + 313.9530*eoc;
+            g422 = -146.407 + 841.8800*e - 1629.014*esq + 1083.4350*eoc;
+            g520 = -532.114 + 3017.977*e - 5740.032*esq + 3708.2760*eoc;
+        } else {
+            g211 = -72.099 + 331.819*e - 508.738*esq + 266.724*eoc;
+            g310 = -346.844 + 1582.851*e - 2415.925*esq + 1246.113*eoc;
+            g322 = -342.585 + 1554.908*e - 2366.899*esq + 1215.972*eoc;
+            g410 = -1052.797 + 4758.686*e - 7193.992*esq + 3651.957*eoc;
+            g422 = -3581.690 + 16178.110*e - 24462.770*esq + 12422.520*eoc;
+            if (e > 0.715)
+                g520 = -5149.66 + 29936.92*e - 54087.36*esq + 31324.56*eoc;
+            else
+                g520 = 1464.74 - 4664.75*e + 3763.64*esq;
+        }
+        if (e < 0.7) {
+            g533 = -919.22770 + 4988.6100*e - 9064.7700*esq + 5542.21*eoc;
+            g521 = -822.71072 + 4568.6173*e - 8491.4146*esq + 5337.524*eoc;
+            g532 = -853.66600 + 4690.2500*e - 8624.7700*esq + 5341.4*eoc;
+        } else {
+            g533 = -37995.780 + 161616.52*e - 229838.20*esq + 109377.94*eoc;
+            g521 = -51752.104 + 218913.95*e - 309468.16*esq + 146349.42*eoc;
+            g532 = -40023.880 + 170470.89*e - 242699.48*esq + 115605.82*eoc;
+        }
+
+        double sinim = d.sinim, cosim = d.cosim;
+        double sini2 = sinim*sinim;
+        double f220 = 0.75*(1.0 + 2.0*cosim + cosisq);
+        double f221 = 1.5*sini2;
+        double f321 = 1.875*sinim*(1.0 - 2.0*cosim - 3.0*cosisq);
+        double f322 = -1.875*sinim*(1.0 + 2.0*cosim - 3.0*cosisq);
+        double f441 = 35.0*sini2*f220;
+        double f442 = 39.3750*sini2*sini2;
+        double f522 = 9.84375*sinim*(sini2*(1.0 - 2.0*cosim - 5.0*cosisq) +
+                                     0.33333333*(-2.0 + 4.0*cosim + 6.0*cosisq));
+        double f523 = sinim*(4.92187512*sini2*(-2.0 - 4.0*cosim + 10.0*cosisq) +
+                             6.56250012*(1.0 + 2.0*cosim - 3.0*cosisq));
+        double f542 = 29.53125*sinim*(2.0 - 8.0*cosim + cosisq*(-12.0 + 8.0*cosim + 10.0*cosisq));
+        double f543 = 29.53125*sinim*(-2.0 - 8.0*cosim + cosisq*(12.0 + 8.0*cosim - 10.0*cosisq));
+
+        double xno2 = (*nm)*(*nm);
+        double ainv2 = aonv*aonv;
+        double temp1 = 3.0*xno2*ainv2;
+        double temp = temp1*root22;
+        rec.d2201 = temp*f220*g201;
+        rec.d2211 = temp*f221*g211;
+        temp1 = temp1*aonv;
+        temp = temp1*root32;
+        rec.d3210 = temp*f321*g310;
+        rec.d3222 = temp*f322*g322;
+        temp1 = temp1*aonv;
+        temp = 2.0*temp1*root44;
+        rec.d4410 = temp*f441*g410;
+        rec.d4422 = temp*f442*g422;
+        temp1 = temp1*aonv;
+        temp = temp1*root52;
+        rec.d5220 = temp*f522*g520;
+        rec.d5232 = temp*f523*g532;
+        temp = 2.0*temp1*root54;
+        rec.d5421 = temp*f542*g521;
+        rec.d5433 = temp*f543*g533;
+        rec.xlamo = fmod(rec.mo + rec.nodeo + rec.nodeo - theta - theta, twopi);
+        rec.xfact = rec.mdot + rec.dmdt + 2.0*(rec.nodedot + rec.dnodt - rptim) - rec.no_unkozai;
+        *em = emo;
+        d.emsq = emsqo;
+    }
+
+    if (rec.irez == 1) {
+        double emsq = d.emsq, cosim = d.cosim, sinim = d.sinim;
+        double g200 = 1.0 + emsq*(-2.5 + 0.8125*emsq);
+        double g310 = 1.0 + 2.0*emsq;
+        double g300 = 1.0 + emsq*(-6.0 + 6.60937*emsq);
+        double f220 = 0.75*(1.0 + cosim)*(1.0 + cosim);
+        double f311 = 0.9375*sinim*sinim*(1.0 + 3.0*cosim) - 0.75*(1.0 + cosim);
+        double f330 = 1.0 + cosim;
+        f330 = 1.875*f330*f330*f330;
+        rec.del1 = 3.0*(*nm)*(*nm)*aonv*aonv;
+        rec.del2 = 2.0*rec.del1*f220*g200*q22;
+        rec.del3 = 3.0*rec.del1*f330*g300*q33*aonv;
+        rec.del1 = rec.del1*f311*g310*q31*aonv;
+        rec.xlamo = fmod(rec.mo + rec.nodeo + rec.argpo - theta, twopi);
+        rec.xfact = rec.mdot + xpidot - rptim + rec.dmdt + rec.domdt + rec.dnodt - rec.no_unkozai;
+    }
+
+    rec.xli = rec.xlamo;
+    rec.xni = rec.no_unkozai;
+    rec.atime = 0.0;
+    *nm = rec.no_unkozai + dndt;
+}
+
+// Deep space secular effects and the resonance integrator
+static void dspace(sgp4_record& rec, double tc,
+                   double* em, double* argpm, double* inclm, double* mm, double* nodem, double* nm) {
+    const double fasx2 = 0.13130908;
+    const double fasx4 = 2.8843198;
+    const double fasx6 = 0.37448087;
+    const double g22 = 5.7686396;
+    const double g32 = 0.95240898;
+    const double g44 = 1.8014998;
+    const double g52 = 1.0508330;
+    const double g54 = 4.4108898;
+    const double rptim = 4.37526908801129966e-3;
+    const double stepp = 720.0;
+    const double stepn = -720.0;
+    const double step2 = 259200.0;
+
+    const double t = rec.t;
+    double theta = fmod(rec.gsto + tc*rptim, twopi);
+    *em += rec.dedt*t;
+    *inclm += rec.didt*t;
+    *argpm += rec.domdt*t;
+    *nodem += rec.dnodt*t;
+    *mm += rec.dmdt*t;
+
+    if (rec.irez == 0)
+        return;
+
+    // restart from epoch when going the other way or backwards in time,
+    // otherwise continue from where the last call left off
+    if ((rec.atime == 0.0) || (t*rec.atime <= 0.0) || (fabs(t) < fabs(rec.atime))) {
+        rec.atime = 0.0;
+        rec.xni = rec.no_unkozai;
+        rec.xli = rec.xlamo;
+    }
+    double delt = (t > 0.0) ? stepp : stepn;
+
+    double xndt, xldot, xnddt, ft;
+    while (true) {
+        if (rec.irez != 2) {
+            // near synchronous
+            xndt = rec.del1*sin(rec.xli - fasx2) + rec.del2*sin(2.0*(rec.xli - fasx4)) +
+                   rec.del3*sin(3.0*(rec.xli - fasx6));
+            xldot = rec.xni + rec.xfact;
+            xnddt = rec.del1*cos(rec.xli - fasx2) + 2.0*rec.del2*cos(2.0*(rec.xli - fasx4)) +
+                    3.0*rec.del3*cos(3.0*(rec.xli - fasx6));
+            xnddt = xnddt*xldot;
+        } else {
+            // near half day
+            double xomi = rec.argpo + rec.argpdot*rec.atime;
+            double x2omi = xomi + xomi;
+            double x2li = rec.xli + rec.xli;
+            double xli = rec.xli;
+            xndt = rec.d2201*sin(x2omi + xli - g22) + rec.d2211*sin(xli - g22) +
+                   rec.d3210*sin(xomi + xli - g32) + rec.d3222*sin(-xomi + xli - g32) +
+                   rec.d4410*sin(x2omi + x2li - g44) + rec.d4422*sin(x2li - g44) +
+                   rec.d5220*sin(xomi + xli - g52) + rec.d5232*sin(-xomi + xli - g52) +
+                   rec.d5421*sin(xomi + x2li - g54) + rec.d5433*sin(-xomi + x2li - g54);
+            xldot = rec.xni + rec.xfact;
+            xnddt = rec.d2201*cos(x2omi + xli - g22) + rec.d2211*cos(xli - g22) +
+                    rec.d3210*cos(xomi + xli - g32) + rec.d3222*cos(-xomi + xli - g32) +
+                    rec.d5220*cos(xomi + xli - g52) + rec.d5232*cos(-xomi + xli - g52) +
+                    2.0*(rec.d4410*cos(x2omi + x2li - g44) + rec.d4422*cos(x2li - g44) +
+                         rec.d5421*cos(xomi + x2li - g54) + rec.d5433*cos(-xomi + x2li - g54));
+            xnddt = xnddt*xldot;
+        }
+
+        if (fabs(t - rec.atime) < stepp) {
+            ft = t - rec.atime;
+            break;
+        }
+
+        rec.xli = rec.xli + xldot*delt + xndt*step2;
+        rec.xni = rec.xni + xndt*delt + xnddt*step2;
+        rec.atime = rec.atime + delt;
+    }
+
+    *nm = rec.xni + xndt*ft + xnddt*ft*ft*0.5;
+    double xl = rec.xli + xldot*ft + xndt*ft*ft*0.5;
+    if (rec.irez != 1)
+        *mm = xl - 2.0*(*nodem) + 2.0*theta;
+    else
+        *mm = xl - *nodem - *argpm + theta;
+    double dndt = *nm - rec.no_unkozai;
+    *nm = rec.no_unkozai + dndt;
+}
+
+int32 sgp4_record::init(const sgp4_elements& elements) {
+    double jd_whole, jd_frac;
+    elements.element_epoch.to_jd(TIME_SCALE_UTC, &jd_whole, &jd_frac);
+    jd_epoch = jd_whole + jd_frac;
+    // days since 1949 December 31 00:00 UT
+    double epoch_days = (jd_whole - 2433281.5) + jd_frac;
+
+    bstar = elements.bstar;
+    ecco = elements.eccentricity;
+    argpo = elements.arg_perigee;
+    inclo = elements.inclination;
+    mo = elements.mean_anomaly;
+    no_kozai = elements.mean_motion;
+    nodeo = elements.raan;
+
+    isimp = 0;
+    method = 'n';
+    aycof = con41 = cc1 = cc4 = cc5 = d2 = d3 = d4 = delmo = eta = argpdot = omgcof = 0.0;
+    sinmao = t2cof = t3cof = t4cof = t5cof = x1mth2 = x7thm1 = mdot = nodedot = 0.0;
+    xlcof = xmcof = nodecf = 0.0;
+
+    irez = 0;
+    d2201 = d2211 = d3210 = d3222 = d4410 = d4422 = d5220 = d5232 = d5421 = d5433 = 0.0;
+    dedt = del1 = del2 = del3 = didt = dmdt = dnodt = domdt = 0.0;
+    e3 = ee2 = peo = pgho = pho = pinco = plo = 0.0;
+    se2 = se3 = sgh2 = sgh3 = sgh4 = sh2 = sh3 = si2 = si3 = sl2 = sl3 = sl4 = 0.0;
+    xfact = xgh2 = xgh3 = xgh4 = xh2 = xh3 = xi2 = xi3 = xl2 = xl3 = xl4 = 0.0;
+    xlamo = zmol = zmos = atime = xli = xni = 0.0;
+
+    // density function altitudes
+    double ss = 78.0 / radius_earth + 1.0;
+    double qzms2ttemp = (120.0 - 78.0) / radius_earth;
+    double qzms2t = qzms2ttemp*qzms2ttemp*qzms2ttemp*qzms2ttemp;
+
+    t = 0.0;
+    error = SGP4_OK;
+
+    // epoch quantities, and recover the original (Brouwer) mean motion
+    double eccsq = ecco*ecco;
+    double omeosq = 1.0 - eccsq;
+    double rteosq = sqrt(omeosq);
+    double cosio = cos(inclo);
+    double cosio2 = cosio*cosio;
+
+    double ak = pow(xke / no_kozai, x2o3);
+    double d1 = 0.75*j2*(3.0*cosio2 - 1.0) / (rteosq*omeosq);
+    double del = d1 / (ak*ak);
+    double adel = ak*(1.0 - del*del - del*(1.0/3.0 + 134.0*del*del / 81.0));
+    del = d1 / (adel*adel);
+    no_unkozai = no_kozai / (1.0 + del);
+
+    double ao = pow(xke / no_unkozai, x2o3);
+    double sinio = sin(inclo);
+    double po = ao*omeosq;
+    double con42 = 1.0 - 5.0*cosio2;
+    con41 = -con42 - cosio2 - cosio2;
+    double posq = po*po;
+    double rp = ao*(1.0 - ecco);
+
+    gsto = sgp4_gmst(jd_epoch);
+
+    a = pow(no_unkozai*tumin, -x2o3);
+    alta = a*(1.0 + ecco) - 1.0;
+    altp = a*(1.0 - ecco) - 1.0;
+
+    if (omeosq >= 0.0 || no_unkozai >= 0.0) {
+        isimp = 0;
+        if (rp < (220.0 / radius_earth + 1.0))
+            isimp = 1;
+        double sfour = ss;
+        double qzms24 = qzms2t;
+        double perige = (rp - 1.0)*radius_earth;
+
+        // for perigees below 156 km, s and qoms2t are altered
+        if (perige < 156.0) {
+            sfour = perige - 78.0;
+            if (perige < 98.0)
+                sfour = 20.0;
+            double qzms24temp = (120.0 - sfour) / radius_earth;
+            qzms24 = qzms24temp*qzms24temp*qzms24temp*qzms24temp;
+            sfour = sfour / radius_earth + 1.0;
+        }
+        double pinvsq = 1.0 / posq;
+
+        double tsi = 1.0 / (ao - sfour);
+        eta = ao*ecco*tsi;
+        double etasq = eta*eta;
+        double eeta = ecco*eta;
+        double psisq = fabs(1.0 - etasq);
+        double coef = qzms24*pow(tsi, 4.0);
+        double coef1 = coef / pow(psisq, 3.5);
+        double cc2 = coef1*no_unkozai*(ao*(1.0 + 1.5*etasq + eeta*(4.0 + etasq)) +
+                     0.375*j2*tsi / psisq*con41*(8.0 + 3.0*etasq*(8.0 + etasq)));
+        cc1 = bstar*cc2;
+        double cc3 = 0.0;
+        if (ecco > 1.0e-4)
+            cc3 = -2.0*coef*tsi*j3oj2*no_unkozai*sinio / ecco;
+        x1mth2 = 1.0 - cosio2;
+        cc4 = 2.0*no_unkozai*coef1*ao*omeosq*
+              (eta*(2.0 + 0.5*etasq) + ecco*(0.5 + 2.0*etasq) -
+               j2*tsi / (ao*psisq)*(-3.0*con41*(1.0 - 2.0*eeta + etasq*(1.5 - 0.5*eeta)) +
+               0.75*x1mth2*(2.0*etasq - eeta*(1.0 + etasq))*cos(2.0*argpo)));
+        cc5 = 2.0*coef1*ao*omeosq*(1.0 + 2.75*(etasq + eeta) + eeta*etasq);
+        double cosio4 = cosio2*cosio2;
+        double temp1 = 1.5*j2*pinvsq*no_unkozai;
+        double temp2 = 0.5*temp1*j2*pinvsq;
+        double temp3 = -0.46875*j4*pinvsq*pinvsq*no_unkozai;
+        mdot = no_unkozai + 0.5*temp1*rteosq*con41 +
+               0.0625*temp2*rteosq*(13.0 - 78.0*cosio2 + 137.0*cosio4);
+        argpdot = -0.5*temp1*con42 + 0.0625*temp2*(7.0 - 114.0*cosio2 + 395.0*cosio4) +
+                  temp3*(3.0 - 36.0*cosio2 + 49.0*cosio4);
+        double xhdot1 = -temp1*cosio;
+        nodedot = xhdot1 + (0.5*temp2*(4.0 - 19.0*cosio2) + 2.0*temp3*(3.0 - 7.0*cosio2))*cosio;
+        double xpidot = argpdot + nodedot;
+        omgcof = bstar*cc3*cos(argpo);
+        xmcof = 0.0;
+        if (ecco > 1.0e-4)
+            xmcof = -x2o3*coef*bstar / eeta;
+        nodecf = 3.5*omeosq*xhdot1*cc1;
+        t2cof = 1.5*cc1;
+        if (fabs(cosio + 1.0) > 1.5e-12)
+            xlcof = -0.25*j3oj2*sinio*(3.0 + 5.0*cosio) / (1.0 + cosio);
+        else
+            xlcof = -0.25*j3oj2*sinio*(3.0 + 5.0*cosio) / temp4;
+        aycof = -0.5*j3oj2*sinio;
+        double delmotemp = 1.0 + eta*cos(mo);
+        delmo = delmotemp*delmotemp*delmotemp;
+        sinmao = sin(mo);
+        x7thm1 = 7.0*cosio2 - 1.0;
+
+        // deep space for periods of 225 min and up
+        if ((twopi / no_unkozai) >= 225.0) {
+            method = 'd';
+            isimp = 1;
+            double tc = 0.0;
+            double inclm = inclo;
+
+            dscom_out d = {};
+            dscom(epoch_days, ecco, argpo, tc, inclo, nodeo, no_unkozai, *this, d);
+
+            double em = d.em, nm = d.nm;
+            double argpm = 0.0, nodem = 0.0, mm = 0.0;
+            dsinit(*this, d, tc, xpidot, eccsq, &em, &argpm, &inclm, &mm, &nm, &nodem);
+        }
+
+        if (isimp != 1) {
+            double cc1sq = cc1*cc1;
+            d2 = 4.0*ao*tsi*cc1sq;
+            double temp = d2*tsi*cc1 / 3.0;
+            d3 = (17.0*ao + sfour)*temp;
+            d4 = 0.5*temp*ao*tsi*(221.0*ao + 31.0*sfour)*cc1;
+            t3cof = d2 + 2.0*cc1sq;
+            t4cof = 0.25*(3.0*d3 + cc1*(12.0*d2 + 10.0*cc1sq));
+            t5cof = 0.2*(3.0*d4 + 12.0*cc1*d3 + 6.0*d2*d2 + 15.0*cc1sq*(2.0*d2 + cc1sq));
+        }
+    }
+
+    double r[3], v[3];
+    propagate(0.0, r, v);
+
+    return error;
+}
+
+int32 sgp4_record::propagate(double tsince, double r[3], double v[3]) {
+    const double vkmpersec = radius_earth*xke / 60.0;
+
+    t = tsince;
+    error = SGP4_OK;
+
+    // secular gravity and atmospheric drag
+    double xmdf = mo + mdot*t;
+    double argpdf = argpo + argpdot*t;
+    double nodedf = nodeo + nodedot*t;
+    double argpm = argpdf;
+    double mm = xmdf;
+    double t2 = t*t;
+    double nodem = nodedf + nodecf*t2;
+    double tempa = 1.0 - cc1*t;
+    double tempe = bstar*cc4*t;
+    double templ = t2cof*t2;
+
+    if (isimp != 1) {
+        double delomg = omgcof*t;
+        double delmtemp = 1.0 + eta*cos(xmdf);
+        double delm = xmcof*(delmtemp*delmtemp*delmtemp - delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2*t;
+        double t4 = t3*t;
+        tempa = tempa - d2*t2 - d3*t3 - d4*t4;
+        tempe = tempe + bstar*cc5*(sin(mm) - sinmao);
+        templ = templ + t3cof*t3 + t4*(t4cof + t*t5cof);
+    }
+
+    double nm = no_unkozai;
+    double em = ecco;
+    double inclm = inclo;
+    if (method == 'd') {
+        dspace(*this, t, &em, &argpm, &inclm, &mm, &nodem, &nm);
+    }
+
+    if (nm <= 0.0) {
+        error = SGP4_BAD_MEAN_MOTION;
+        return error;
+    }
+    double am = pow(xke / nm, x2o3)*tempa*tempa;
+    nm = xke / pow(am, 1.5);
+    em = em - tempe;
+
+    if ((em >= 1.0) || (em < -0.001)) {
+        error = SGP4_BAD_ECCENTRICITY;
+        return error;
+    }
+    if (em < 1.0e-6)
+        em = 1.0e-6;
+    mm = mm + no_unkozai*templ;
+    double xlm = mm + argpm + nodem;
+
+    nodem = fmod(nodem, twopi);
+    argpm = fmod(argpm, twopi);
+    xlm = fmod(xlm, twopi);
+    mm = fmod(xlm - argpm - nodem, twopi);
+
+    double sinim = sin(inclm);
+    double cosim = cos(inclm);
+
+    // lunar-solar periodics
+    double ep = em;
+    double xincp = inclm;
+    double argpp = argpm;
+    double nodep = nodem;
+    double mp = mm;
+    double sinip = sinim;
+    double cosip = cosim;
+    if (method == 'd') {
+        dpper(*this, t, &ep, &xincp, &nodep, &argpp, &mp);
+        if (xincp < 0.0) {
+            xincp = -xincp;
+            nodep = nodep + pi;
+            argpp = argpp - pi;
+        }
+        if ((ep < 0.0) || (ep > 1.0)) {
+            error = SGP4_BAD_PERTURBED_ECCENTRICITY;
+            return error;
+        }
+
+        // long period periodics depend on the perturbed inclination
+        sinip = sin(xincp);
+        cosip = cos(xincp);
+        aycof = -0.5*j3oj2*sinip;
+        if (fabs(cosip + 1.0) > 1.5e-12)
+            xlcof = -0.25*j3oj2*sinip*(3.0 + 5.0*cosip) / (1.0 + cosip);
+        else
+            xlcof = -0.25*j3oj2*sinip*(3.0 + 5.0*cosip) / temp4;
+    }
+
+    // long period periodics
+    double axnl = ep*cos(argpp);
+    double temp = 1.0 / (am*(1.0 - ep*ep));
+    double aynl = ep*sin(argpp) + temp*aycof;
+    double xl = mp + argpp + nodep + temp*xlcof*axnl;
+
+    // Kepler's equation in equinoctial form, steps limited for stability
+    double u = fmod(xl - nodep, twopi);
+    double eo1 = u;
+    double tem5 = 9999.9;
+    double sineo1 = 0.0, coseo1 = 1.0;
+    for (int ktr = 1; fabs(tem5) >= 1.0e-12 && ktr <= 10; ktr++) {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        tem5 = 1.0 - coseo1*axnl - sineo1*aynl;
+        tem5 = (u - aynl*coseo1 + axnl*sineo1 - eo1) / tem5;
+        if (fabs(tem5) >= 0.95)
+            tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 = eo1 + tem5;
+    }
+
+    // short period preliminary quantities
+    double ecose = axnl*coseo1 + aynl*sineo1;
+    double esine = axnl*sineo1 - aynl*coseo1;
+    double el2 = axnl*axnl + aynl*aynl;
+    double pl = am*(1.0 - el2);
+    if (pl < 0.0) {
+        error = SGP4_BAD_SEMI_LATUS;
+        return error;
+    }
+
+    double rl = am*(1.0 - ecose);
+    double rdotl = sqrt(am)*esine / rl;
+    double rvdotl = sqrt(pl) / rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl*(sineo1 - aynl - axnl*temp);
+    double cosu = am / rl*(coseo1 - axnl + aynl*temp);
+    double su = atan2(sinu, cosu);
+    double sin2u = (cosu + cosu)*sinu;
+    double cos2u = 1.0 - 2.0*sinu*sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5*j2*temp;
+    double temp2 = temp1*temp;
+
+    // short period periodics
+    if (method == 'd') {
+        double cosisq = cosip*cosip;
+        con41 = 3.0*cosisq - 1.0;
+        x1mth2 = 1.0 - cosisq;
+        x7thm1 = 7.0*cosisq - 1.0;
+    }
+    double mrt = rl*(1.0 - 1.5*temp2*betal*con41) + 0.5*temp1*x1mth2*cos2u;
+    su = su - 0.25*temp2*x7thm1*sin2u;
+    double xnode = nodep + 1.5*temp2*cosip*sin2u;
+    double xinc = xincp + 1.5*temp2*cosip*sinip*cos2u;
+    double mvt = rdotl - nm*temp1*x1mth2*sin2u / xke;
+    double rvdot = rvdotl + nm*temp1*(x1mth2*cos2u + 1.5*con41) / xke;
+
+    // orientation vectors
+    double sinsu = sin(su);
+    double cossu = cos(su);
+    double snod = sin(xnode);
+    double cnod = cos(xnode);
+    double sini = sin(xinc);
+    double cosi = cos(xinc);
+    double xmx = -snod*cosi;
+    double xmy = cnod*cosi;
+    double ux = xmx*sinsu + cnod*cossu;
+    double uy = xmy*sinsu + snod*cossu;
+    double uz = sini*sinsu;
+    double vx = xmx*cossu - cnod*sinsu;
+    double vy = xmy*cossu - snod*sinsu;
+    double vz = sini*cossu;
+
+    r[0] = (mrt*ux)*radius_earth;
+    r[1] = (mrt*uy)*radius_earth;
+    r[2] = (mrt*uz)*radius_earth;
+    v[0] = (mvt*ux + rvdot*vx)*vkmpersec;
+    v[1] = (mvt*uy + rvdot*vy)*vkmpersec;
+    v[2] = (mvt*uz + rvdot*vz)*vkmpersec;
+
+    if (mrt < 1.0) {
+        error = SGP4_DECAYED;
+        return error;
+    }
+
+    return error;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "defines.h"
+
+#include "epoch.h"
+
+enum sgp4_error : int {
+    SGP4_OK = 0,
+    SGP4_BAD_ECCENTRICITY = 1, // mean eccentricity outside [0, 1)
+    SGP4_BAD_MEAN_MOTION = 2,
+    SGP4_BAD_PERTURBED_ECCENTRICITY = 3,
+    SGP4_BAD_SEMI_LATUS = 4,
+    SGP4_DECAYED = 6,
+};
+
+// Mean elements as they come out of a TLE or OMM, already converted to
+// radians and radians/minute. These are SGP4 (Kozai) mean elements and are
+// only meaningful when fed back through SGP4.
+struct sgp4_elements {
+    uint32 catalog_number;
+    char name[25]; // object name if the source had one, NUL terminated
+    epoch element_epoch;
+    double bstar;       // 1/earth radii
+    double ndot;        // rad/min^2 (not used by SGP4)
+    double nddot;       // rad/min^3 (not used by SGP4)
+    double eccentricity;
+    double inclination; // rad
+    double raan;        // rad
+    double arg_perigee; // rad
+    double mean_anomaly; // rad
+    double mean_motion; // rad/min, Kozai
+};
+
+// SGP4/SDP4 (Spacetrack report #3, as revised by Vallado et al. 2006) with
+// WGS-72 constants and the improved (non-AFSPC) sidereal time and Lyddane
+// handling. Orbits with periods over 225 min use the deep space (SDP4) terms,
+// including the 12 h and 24 h resonances.
+//
+// Outputs are in the TEME frame, km and km/s, with time in minutes from the
+// element epoch.
+struct sgp4_record {
+    int32 init(const sgp4_elements& elements);
+
+    // not const: the deep space resonance integrator keeps its last state to
+    // restart from, so each record should only be propagated by one thread
+    int32 propagate(double tsince, double r[3], double v[3]);
+
+    bool deep_space() const { return method == 'd'; }
+
+    int32 error = SGP4_OK;
+    double t = 0.0;
+
+    // elements
+    double bstar, ecco, inclo, nodeo, argpo, mo, no_kozai, no_unkozai;
+    double a, alta, altp, jd_epoch;
+    double gsto;
+
+    char method = 'n';
+
+    // near earth
+    int32 isimp;
+    double aycof, con41, cc1, cc4, cc5, d2, d3, d4, delmo, eta, argpdot, omgcof,
+           sinmao, t2cof, t3cof, t4cof, t5cof, x1mth2, x7thm1, mdot, nodedot,
+           xlcof, xmcof, nodecf;
+
+    // deep space
+    int32 irez;
+    double d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433,
+           dedt, del1, del2, del3, didt, dmdt, dnodt, domdt, e3, ee2, peo, pgho,
+           pho, pinco, plo, se2, se3, sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2,
+           sl3, sl4, xfact, xgh2, xgh3, xgh4, xh2, xh3, xi2, xi3, xl2, xl3, xl4,
+           xlamo, zmol, zmos, atime, xli, xni;
+};
+
+// Greenwich mean sidereal time (IAU 1982) as used by SGP4, rad
+double sgp4_gmst(double jd_ut1);
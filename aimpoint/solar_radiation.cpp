@@ -0,0 +1,183 @@
+#include "solar_radiation.h"
+
+#include "log.h"
+
+#include <cmath>
+
+static const double default_sun_radius = 6.957e8; // m
+static const double pi_d = 3.14159265358979323846;
+
+// shared by the scalar and batch versions. a, b are the apparent radii of the
+// Sun and the occulting body, c their apparent separation, all in radians.
+static inline double shadow_from_angles(double a, double b, double c) {
+    // partial overlap of two disks
+    double inv_c = 1.0 / (c > 1.0e-12 ? c : 1.0e-12);
+    double x = 0.5*(c*c + a*a - b*b) * inv_c;
+    double y2 = a*a - x*x;
+    double y = sqrt(y2 > 0.0 ? y2 : 0.0);
+    double xa = x / a;
+    double cb = (c - x) / b;
+    xa = xa < -1.0 ? -1.0 : (xa > 1.0 ? 1.0 : xa);
+    cb = cb < -1.0 ? -1.0 : (cb > 1.0 ? 1.0 : cb);
+    double area = a*a*acos(xa) + b*b*acos(cb) - c*y;
+    double nu_partial = 1.0 - area / (pi_d*a*a);
+
+    // Sun disk entirely behind the occulting body, or the body entirely
+    // inside the Sun disk (annular)
+    double nu_annular = 1.0 - (b*b) / (a*a);
+
+    double nu = nu_partial;
+    nu = (c < a - b) ? nu_annular : nu;
+    nu = (c < b - a) ? 0.0 : nu;
+    nu = (c >= a + b) ? 1.0 : nu;
+    return nu;
+}
+
+double shadow_function(vec3d pos, vec3d sun_pos, double occulting_radius) {
+    vec3d to_sun = sun_pos - pos;
+    double r = laml::length(pos);
+    double d = laml::length(to_sun);
+
+    double a = asin(default_sun_radius / d);
+    double b = asin(occulting_radius < r ? occulting_radius / r : 1.0);
+    double cos_c = -laml::dot(pos, to_sun) / (r*d);
+    double c = acos(cos_c < -1.0 ? -1.0 : (cos_c > 1.0 ? 1.0 : cos_c));
+
+    return shadow_from_angles(a, b, c);
+}
+
+void shadow_function_batch(const double* pos_x, const double* pos_y, const double* pos_z, size_t count,
+                           vec3d sun_pos, double occulting_radius, double* nu_out) {
+    const double sx = sun_pos.x, sy = sun_pos.y, sz = sun_pos.z;
+
+    for (size_t n = 0; n < count; n++) {
+        double px = pos_x[n], py = pos_y[n], pz = pos_z[n];
+        double dx = sx - px, dy = sy - py, dz = sz - pz;
+
+        double r = sqrt(px*px + py*py + pz*pz);
+        double d = sqrt(dx*dx + dy*dy + dz*dz);
+
+        double a = asin(default_sun_radius / d);
+        double sb = occulting_radius / r;
+        double b = asin(sb < 1.0 ? sb : 1.0);
+        double cos_c = -(px*dx + py*dy + pz*dz) / (r*d);
+        cos_c = cos_c < -1.0 ? -1.0 : (cos_c > 1.0 ? 1.0 : cos_c);
+        double c = acos(cos_c);
+
+        nu_out[n] = shadow_from_angles(a, b, c);
+    }
+}
+
+eclipse_state eclipse_state_from_shadow(double nu) {
+    if (nu >= 1.0)
+        return ECLIPSE_SUNLIT;
+    if (nu <= 0.0)
+        return ECLIPSE_UMBRA;
+    return ECLIPSE_PENUMBRA;
+}
+
+void solar_radiation::init(planet* new_body, ephemeris* sun_source) {
+    body = new_body;
+    sun = sun_source;
+
+    if (sun == nullptr) {
+        spdlog::warn("Solar radiation pressure without a Sun ephemeris, SRP disabled");
+    }
+}
+
+double solar_radiation::shadow(vec3d pos_inertial, double t) {
+    if (sun == nullptr)
+        return 1.0;
+
+    return shadow_function(pos_inertial, sun->at(t).sun_position, body->equatorial_radius);
+}
+
+vec3d solar_radiation::srp_accel(vec3d pos_inertial, double t, double reflect_area_over_mass, double* nu_out) {
+    if (sun == nullptr) {
+        if (nu_out)
+            *nu_out = 1.0;
+        return vec3d(0.0, 0.0, 0.0);
+    }
+
+    vec3d sun_pos = sun->at(t).sun_position;
+    double nu = shadow_function(pos_inertial, sun_pos, body->equatorial_radius);
+    if (nu_out)
+        *nu_out = nu;
+
+    // pressure falls off as 1/d^2 from its 1 AU value, pushing away from the Sun
+    vec3d from_sun = pos_inertial - sun_pos;
+    double d = laml::length(from_sun);
+    double scale = nu * solar_pressure * reflect_area_over_mass * (astronomical_unit*astronomical_unit) / (d*d*d);
+
+    return scale * from_sun;
+}
+
+void eclipse_monitor::resize(uint32 num_bodies) {
+    prev_t.resize(num_bodies, 0.0);
+    prev_nu.resize(num_bodies, 1.0);
+    has_prev.resize(num_bodies, 0);
+}
+
+// linear estimate of when nu crossed 'level' between two samples
+static double crossing_time(double t0, double nu0, double t1, double nu1, double level) {
+    double dnu = nu1 - nu0;
+    if (fabs(dnu) < 1.0e-15)
+        return t1;
+    double f = (level - nu0) / dnu;
+    f = f < 0.0 ? 0.0 : (f > 1.0 ? 1.0 : f);
+    return t0 + f*(t1 - t0);
+}
+
+uint32 eclipse_monitor::update(uint32 body_index, double t, double nu) {
+    if (body_index >= has_prev.size())
+        resize(body_index + 1);
+
+    if (!has_prev[body_index]) {
+        has_prev[body_index] = 1;
+        prev_t[body_index] = t;
+        prev_nu[body_index] = nu;
+        return 0;
+    }
+
+    double t0 = prev_t[body_index];
+    double nu0 = prev_nu[body_index];
+    eclipse_state from = eclipse_state_from_shadow(nu0);
+    eclipse_state to = eclipse_state_from_shadow(nu);
+
+    prev_t[body_index] = t;
+    prev_nu[body_index] = nu;
+
+    if (from == to)
+        return 0;
+
+    // a coarse step may jump straight through the penumbra, report both edges in order
+    uint32 num_new = 0;
+    if (from == ECLIPSE_SUNLIT && to == ECLIPSE_UMBRA) {
+        events.push_back({ body_index, crossing_time(t0, nu0, t, nu, 1.0), ECLIPSE_SUNLIT, ECLIPSE_PENUMBRA });
+        events.push_back({ body_index, crossing_time(t0, nu0, t, nu, 0.0), ECLIPSE_PENUMBRA, ECLIPSE_UMBRA });
+        num_new = 2;
+    } else if (from == ECLIPSE_UMBRA && to == ECLIPSE_SUNLIT) {
+        events.push_back({ body_index, crossing_time(t0, nu0, t, nu, 0.0), ECLIPSE_UMBRA, ECLIPSE_PENUMBRA });
+        events.push_back({ body_index, crossing_time(t0, nu0, t, nu, 1.0), ECLIPSE_PENUMBRA, ECLIPSE_SUNLIT });
+        num_new = 2;
+    } else {
+        // penumbra boundary on the sunlit side is nu = 1, on the umbra side nu = 0
+        bool sunlit_edge = (from == ECLIPSE_SUNLIT || to == ECLIPSE_SUNLIT);
+        double level = sunlit_edge ? 1.0 : 0.0;
+        events.push_back({ body_index, crossing_time(t0, nu0, t, nu, level), from, to });
+        num_new = 1;
+    }
+
+    return num_new;
+}
+
+uint32 eclipse_monitor::update_batch(double t, const double* nu, uint32 count) {
+    if (count > has_prev.size())
+        resize(count);
+
+    uint32 num_new = 0;
+    for (uint32 n = 0; n < count; n++) {
+        num_new += update(n, t, nu[n]);
+    }
+    return num_new;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "defines.h"
+
+#include "planet.h"
+#include "ephemeris.h"
+
+#include <vector>
+
+enum eclipse_state : int {
+    ECLIPSE_SUNLIT = 0,
+    ECLIPSE_PENUMBRA = 1,
+    ECLIPSE_UMBRA = 2,
+};
+
+// Conical shadow function (Montenbruck & Gill 3.4.2): fraction of the solar
+// disk visible from pos, 1 = full sun, 0 = umbra. Positions Earth-centered.
+double shadow_function(vec3d pos, vec3d sun_pos, double occulting_radius);
+
+// Same for a batch of positions in SoA layout. The loop body has no branches
+// (every case is computed and selected), so it vectorizes with the
+// compiler's vector math library.
+void shadow_function_batch(const double* pos_x, const double* pos_y, const double* pos_z, size_t count,
+                           vec3d sun_pos, double occulting_radius, double* nu_out);
+
+eclipse_state eclipse_state_from_shadow(double nu);
+
+// Cannonball solar radiation pressure with eclipses by the planet.
+struct solar_radiation {
+    void init(planet* body, ephemeris* sun_source);
+
+    // reflect_area_over_mass = Cr*A/m [m^2/kg]
+    vec3d srp_accel(vec3d pos_inertial, double t, double reflect_area_over_mass, double* nu_out = nullptr);
+
+    double shadow(vec3d pos_inertial, double t);
+
+    double solar_pressure = 4.56e-6;           // N/m^2 at 1 AU
+    double astronomical_unit = 1.495978707e11; // m
+
+private:
+    planet* body = nullptr;
+    ephemeris* sun = nullptr;
+};
+
+struct eclipse_event {
+    uint32 body_index;
+    double t;        // interpolated crossing time
+    eclipse_state from;
+    eclipse_state to;
+};
+
+// Turns sampled shadow values into entry/exit events per body.
+struct eclipse_monitor {
+    void resize(uint32 num_bodies);
+
+    // returns the number of new events appended to 'events'
+    uint32 update(uint32 body_index, double t, double nu);
+    uint32 update_batch(double t, const double* nu, uint32 count);
+
+    std::vector<eclipse_event> events;
+
+private:
+    std::vector<double> prev_t;
+    std::vector<double> prev_nu;
+    std::vector<uint8> has_prev;
+};
@@ -0,0 +1,159 @@
+#include "startup_profile.h"
+
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct startup_phase {
+    std::string name;
+    double start;
+    double end; // < 0 while running, == start for marks
+    uint32 thread;
+    uint32 depth;
+    bool is_mark;
+};
+
+// initialized before main, close enough to process start
+static const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
+
+static std::mutex phase_mutex;
+static std::vector<startup_phase> phases;
+static std::string trace_filename;
+static bool reported = false;
+
+static std::atomic<uint32> next_thread_index(0);
+static thread_local int32 this_thread_index = -1;
+static thread_local uint32 this_thread_depth = 0;
+
+static uint32 get_thread_index() {
+    if (this_thread_index < 0)
+        this_thread_index = (int32)next_thread_index++;
+    return (uint32)this_thread_index;
+}
+
+double startup_elapsed() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - process_start).count();
+}
+
+static int32 add_phase(std::string name, bool is_mark) {
+    double now = startup_elapsed();
+    uint32 thread = get_thread_index();
+
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    if (reported)
+        return -1;
+    phases.push_back({ std::move(name), now, is_mark ? now : -1.0, thread, this_thread_depth, is_mark });
+    return (int32)phases.size() - 1;
+}
+
+startup_timer::startup_timer(const char* name) {
+    index = add_phase(name, false);
+    if (index >= 0)
+        this_thread_depth++;
+}
+
+startup_timer::startup_timer(const char* name, const char* detail) {
+    index = add_phase(std::string(name) + " " + detail, false);
+    if (index >= 0)
+        this_thread_depth++;
+}
+
+startup_timer::~startup_timer() {
+    stop();
+}
+
+void startup_timer::stop() {
+    if (index < 0)
+        return;
+    this_thread_depth--;
+
+    double now = startup_elapsed();
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    if (!reported)
+        phases[index].end = now;
+    index = -1;
+}
+
+void startup_profile_mark(const char* name) {
+    add_phase(name, true);
+}
+
+void set_startup_trace_file(const char* filename) {
+    std::lock_guard<std::mutex> lock(phase_mutex);
+    trace_filename = filename ? filename : "";
+}
+
+static void write_json_string(FILE* fid, const std::string& s) {
+    fputc('"', fid);
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            fputc('\\', fid);
+        fputc(c, fid);
+    }
+    fputc('"', fid);
+}
+
+static bool write_trace(const char* filename, const std::vector<startup_phase>& list, double now) {
+    FILE* fid = fopen(filename, "w");
+    if (fid == nullptr)
+        return false;
+
+    // Chrome trace event format, times in microseconds
+    fprintf(fid, "{\"traceEvents\":[\n");
+    for (size_t n = 0; n < list.size(); n++) {
+        const startup_phase& p = list[n];
+        fprintf(fid, "  {\"name\":");
+        write_json_string(fid, p.name);
+        if (p.is_mark) {
+            fprintf(fid, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.1f", p.start*1e6);
+        } else {
+            double end = p.end < 0.0 ? now : p.end;
+            fprintf(fid, ",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f", p.start*1e6, (end - p.start)*1e6);
+        }
+        fprintf(fid, ",\"pid\":1,\"tid\":%u}%s\n", p.thread, n + 1 < list.size() ? "," : "");
+    }
+    fprintf(fid, "]}\n");
+
+    bool ok = (ferror(fid) == 0);
+    fclose(fid);
+    return ok;
+}
+
+void startup_profile_report() {
+    std::vector<startup_phase> list;
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(phase_mutex);
+        if (reported)
+            return;
+        reported = true;
+        list.swap(phases);
+        filename = trace_filename;
+    }
+    double now = startup_elapsed();
+
+    spdlog::info("Startup took {0:.1f} ms:", now*1000.0);
+    for (const startup_phase& p : list) {
+        std::string indent(2*p.depth, ' ');
+        std::string thread = p.thread ? " (thread " + std::to_string(p.thread) + ")" : std::string();
+        if (p.is_mark) {
+            spdlog::info("  {0:8.1f} ms            {1}-- {2}{3}", p.start*1000.0, indent, p.name, thread);
+        } else if (p.end < 0.0) {
+            spdlog::info("  {0:8.1f} ms   running  {1}{2}{3}", p.start*1000.0, indent, p.name, thread);
+        } else {
+            spdlog::info("  {0:8.1f} ms {1:8.1f} ms {2}{3}{4}", p.start*1000.0, (p.end - p.start)*1000.0, indent, p.name, thread);
+        }
+    }
+
+    if (!filename.empty()) {
+        if (write_trace(filename.c_str(), list, now))
+            spdlog::info("Wrote startup trace '{0}'", filename);
+        else
+            spdlog::error("Could not write startup trace '{0}'", filename);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "defines.h"
+
+// Wall-clock breakdown of startup, from process start to the first
+// presented frame. Phases are timed with startup_timer (from any thread)
+// and reported once by startup_profile_report(); after that the timers do
+// nothing, so they can stay in code that also runs later.
+struct startup_timer {
+    startup_timer(const char* name);
+    startup_timer(const char* name, const char* detail); // e.g. a file name
+    ~startup_timer();
+
+    void stop(); // end early, before going out of scope
+
+    startup_timer(const startup_timer&) = delete;
+    startup_timer& operator=(const startup_timer&) = delete;
+
+private:
+    int32 index;
+};
+
+// seconds since the process started
+double startup_elapsed();
+
+// also write the phases as a Chrome trace (chrome://tracing, Perfetto)
+void set_startup_trace_file(const char* filename);
+
+// records an instant, e.g. "first frame presented"
+void startup_profile_mark(const char* name);
+
+// logs the breakdown at info level and writes the trace, if any. Only the
+// first call does anything.
+void startup_profile_report();
@@ -0,0 +1,613 @@
+#include "tle_catalog.h"
+
+#include "mapped_file.h"
+#include "parallel.h"
+#include "log.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static const size_t parse_chunk_bytes = 256 * 1024;
+static const size_t sgp4_chunk_size = 256;
+static const double minutes_per_day = 1440.0;
+static const double twopi = 6.283185307179586476925287;
+static const double xpdotp = minutes_per_day / twopi; // rev/day -> rad/min
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+};
+
+static double scale_by_ten(double x, int32 exponent) {
+    if (exponent >= 0 && exponent <= 20)
+        return x * powers_of_ten[exponent];
+    if (exponent < 0 && exponent >= -20)
+        return x / powers_of_ten[-exponent];
+    return x * pow(10.0, (double)exponent);
+}
+
+// [+-]digits[.digits][(e|E)[+-]digits], blanks around it allowed
+static bool parse_number(const char* s, const char* end, double* out) {
+    while (s < end && *s == ' ') s++;
+    while (end > s && (end[-1] == ' ' || end[-1] == '\r')) end--;
+    if (s == end)
+        return false;
+
+    bool negative = false;
+    if (*s == '+' || *s == '-') {
+        negative = (*s == '-');
+        s++;
+    }
+
+    uint64 mantissa = 0;
+    int32 num_digits = 0;
+    int32 exponent = 0;
+    bool any = false;
+    for (; s < end && *s >= '0' && *s <= '9'; s++, any = true) {
+        if (num_digits < 19) { mantissa = mantissa*10 + (*s - '0'); num_digits++; }
+        else exponent++;
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && *s >= '0' && *s <= '9'; s++, any = true) {
+            if (num_digits < 19) { mantissa = mantissa*10 + (*s - '0'); num_digits++; exponent--; }
+        }
+    }
+    if (!any)
+        return false;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        s++;
+        bool exp_negative = false;
+        if (s < end && (*s == '+' || *s == '-')) {
+            exp_negative = (*s == '-');
+            s++;
+        }
+        int32 e = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; s++)
+            e = e*10 + (*s - '0');
+        exponent += exp_negative ? -e : e;
+    }
+    if (s != end)
+        return false;
+
+    double x = scale_by_ten((double)mantissa, exponent);
+    *out = negative ? -x : x;
+    return true;
+}
+
+// TLE "assumed decimal point" fields, e.g. " 12345-4" = 0.12345e-4
+static bool parse_implied(const char* s, const char* end, double* out) {
+    while (s < end && *s == ' ') s++;
+    if (s == end) {
+        *out = 0.0;
+        return true;
+    }
+
+    bool negative = false;
+    if (*s == '+' || *s == '-') {
+        negative = (*s == '-');
+        s++;
+    }
+    uint64 mantissa = 0;
+    int32 num_digits = 0;
+    for (; s < end && *s >= '0' && *s <= '9'; s++, num_digits++)
+        mantissa = mantissa*10 + (*s - '0');
+    if (num_digits == 0)
+        return false;
+
+    int32 exponent = 0;
+    if (s < end && (*s == '+' || *s == '-')) {
+        bool exp_negative = (*s == '-');
+        s++;
+        if (s == end || *s < '0' || *s > '9')
+            return false;
+        exponent = exp_negative ? -(*s - '0') : (*s - '0');
+        s++;
+    }
+    while (s < end && *s == ' ') s++;
+    if (s != end)
+        return false;
+
+    double x = scale_by_ten((double)mantissa, exponent - num_digits);
+    *out = negative ? -x : x;
+    return true;
+}
+
+static bool parse_int(const char* s, const char* end, int32* out) {
+    while (s < end && *s == ' ') s++;
+    while (end > s && end[-1] == ' ') end--;
+    if (s == end)
+        return false;
+    int32 value = 0;
+    for (; s < end; s++) {
+        if (*s < '0' || *s > '9')
+            return false;
+        value = value*10 + (*s - '0');
+    }
+    *out = value;
+    return true;
+}
+
+// 5 digits, or Alpha-5 (a letter for the leading digits, I and O skipped)
+static bool parse_catalog_number(const char* s, uint32* out) {
+    int32 tail;
+    if (!parse_int(s + 1, s + 5, &tail) && memcmp(s + 1, "    ", 4) != 0)
+        return false;
+    if (memcmp(s + 1, "    ", 4) == 0)
+        tail = 0;
+
+    char c = s[0];
+    uint32 lead;
+    if (c >= '0' && c <= '9') {
+        lead = c - '0';
+    } else if (c == ' ') {
+        lead = 0;
+    } else if (c >= 'A' && c <= 'Z' && c != 'I' && c != 'O') {
+        lead = 10 + (c - 'A') - (c > 'I' ? 1 : 0) - (c > 'O' ? 1 : 0);
+    } else {
+        return false;
+    }
+    *out = lead*10000 + (uint32)tail;
+    return true;
+}
+
+static bool tle_checksum(const char* line) {
+    int32 sum = 0;
+    for (int n = 0; n < 68; n++) {
+        char c = line[n];
+        if (c >= '0' && c <= '9')
+            sum += c - '0';
+        else if (c == '-')
+            sum += 1;
+    }
+    return (line[68] - '0') == sum % 10;
+}
+
+static void set_name(sgp4_elements* out, const char* name, size_t length) {
+    while (length > 0 && (*name == ' ')) { name++; length--; }
+    while (length > 0 && (name[length - 1] == ' ' || name[length - 1] == '\r')) length--;
+    if (length > sizeof(out->name) - 1)
+        length = sizeof(out->name) - 1;
+    memcpy(out->name, name, length);
+    out->name[length] = 0;
+}
+
+// converts TLE/OMM units (deg, rev/day, rev/day^2, rev/day^3) in place
+static void convert_units(sgp4_elements* out, double mean_motion, double ndot, double nddot) {
+    const double d2r = twopi / 360.0;
+    out->inclination *= d2r;
+    out->raan *= d2r;
+    out->arg_perigee *= d2r;
+    out->mean_anomaly *= d2r;
+    out->mean_motion = mean_motion / xpdotp;
+    out->ndot = ndot / (xpdotp*minutes_per_day);
+    out->nddot = nddot / (xpdotp*minutes_per_day*minutes_per_day);
+}
+
+bool parse_tle(const char* line1, const char* line2, const char* name, size_t name_length, sgp4_elements* out) {
+    if (line1[0] != '1' || line2[0] != '2')
+        return false;
+    if (!tle_checksum(line1) || !tle_checksum(line2))
+        return false;
+
+    uint32 catalog_number2;
+    if (!parse_catalog_number(line1 + 2, &out->catalog_number) ||
+        !parse_catalog_number(line2 + 2, &catalog_number2) ||
+        out->catalog_number != catalog_number2)
+        return false;
+
+    int32 year;
+    double day, ndot, nddot, mean_motion;
+    bool ok = parse_int(line1 + 18, line1 + 20, &year) &&
+              parse_number(line1 + 20, line1 + 32, &day) &&
+              parse_number(line1 + 33, line1 + 43, &ndot) &&
+              parse_implied(line1 + 44, line1 + 52, &nddot) &&
+              parse_implied(line1 + 53, line1 + 61, &out->bstar) &&
+              parse_number(line2 + 8, line2 + 16, &out->inclination) &&
+              parse_number(line2 + 17, line2 + 25, &out->raan) &&
+              parse_implied(line2 + 26, line2 + 33, &out->eccentricity) &&
+              parse_number(line2 + 34, line2 + 42, &out->arg_perigee) &&
+              parse_number(line2 + 43, line2 + 51, &out->mean_anomaly) &&
+              parse_number(line2 + 52, line2 + 63, &mean_motion);
+    if (!ok)
+        return false;
+
+    // two digit years, 57-99 are 1900s
+    year += (year < 57) ? 2000 : 1900;
+    out->element_epoch = epoch::from_calendar(year, 1, 1, 0, 0, 0.0, TIME_SCALE_UTC);
+    out->element_epoch += (day - 1.0) * 86400.0;
+
+    convert_units(out, mean_motion, ndot, nddot);
+
+    if (name) {
+        // 3LE files may prefix the name line with "0 "
+        if (name_length >= 2 && name[0] == '0' && name[1] == ' ') {
+            name += 2;
+            name_length -= 2;
+        }
+        set_name(out, name, name_length);
+    } else {
+        out->name[0] = 0;
+    }
+    return true;
+}
+
+static const char* next_line(const char* p, const char* end, size_t* length) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    const char* line_end = newline ? newline : end;
+    *length = line_end - p;
+    if (*length > 0 && p[*length - 1] == '\r')
+        (*length)--;
+    return newline ? newline + 1 : end;
+}
+
+// first line boundary at or after offset. Chunks own the records whose first
+// line starts inside them, and may read past their end to finish one.
+static size_t chunk_start(const char* data, size_t size, size_t offset) {
+    if (offset == 0)
+        return 0;
+    if (offset >= size)
+        return size;
+    const char* newline = (const char*)memchr(data + offset - 1, '\n', size - (offset - 1));
+    return newline ? (newline - data) + 1 : size;
+}
+
+static void parse_tle_chunk(const char* data, size_t size, size_t begin, size_t end,
+                            std::vector<sgp4_elements>& out, uint32* num_rejected) {
+    // the previous line may hold the name of the first record
+    const char* prev_line = nullptr;
+    size_t prev_length = 0;
+    if (begin > 0) {
+        size_t n = begin - 1;
+        while (n > 0 && data[n - 1] != '\n') n--;
+        prev_line = data + n;
+        prev_length = (begin - 1) - n;
+        if (prev_length > 0 && prev_line[prev_length - 1] == '\r')
+            prev_length--;
+    }
+
+    const char* file_end = data + size;
+    const char* p = data + begin;
+    out.reserve((end - begin) / 140 + 1);
+
+    while (p < data + end) {
+        size_t length;
+        const char* line = p;
+        p = next_line(p, file_end, &length);
+
+        if (length >= 69 && line[0] == '1' && line[1] == ' ' && p < file_end) {
+            size_t length2;
+            const char* line2 = p;
+            const char* after = next_line(p, file_end, &length2);
+            if (length2 >= 69 && line2[0] == '2' && line2[1] == ' ') {
+                bool has_name = prev_line && prev_length > 0 &&
+                                !(prev_length >= 69 && (prev_line[0] == '1' || prev_line[0] == '2') && prev_line[1] == ' ');
+                sgp4_elements elements;
+                if (parse_tle(line, line2, has_name ? prev_line : nullptr, prev_length, &elements)) {
+                    out.push_back(elements);
+                } else {
+                    (*num_rejected)++;
+                }
+                prev_line = line2;
+                prev_length = length2;
+                p = after;
+                continue;
+            }
+        }
+
+        prev_line = line;
+        prev_length = length;
+    }
+}
+
+bool tle_catalog::load_tle(const char* filename) {
+    auto start = std::chrono::steady_clock::now();
+
+    mapped_file file;
+    if (!file.open(filename)) {
+        spdlog::warn("Could not open element file '{0}'", filename);
+        return false;
+    }
+    const char* data = (const char*)file.get_data();
+    size_t size = (size_t)file.get_size();
+
+    size_t num_chunks = (size + parse_chunk_bytes - 1) / parse_chunk_bytes;
+    std::vector<std::vector<sgp4_elements>> chunks(num_chunks);
+    std::atomic<uint32> num_rejected{0};
+
+    parallel_for(num_chunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t c = chunk_begin; c < chunk_end; c++) {
+            size_t begin = chunk_start(data, size, c*parse_chunk_bytes);
+            size_t end = chunk_start(data, size, (c + 1)*parse_chunk_bytes);
+            uint32 rejected = 0;
+            parse_tle_chunk(data, size, begin, end, chunks[c], &rejected);
+            num_rejected += rejected;
+        }
+    });
+
+    if (num_rejected > 0) {
+        spdlog::warn("Skipped {0} malformed element sets in '{1}'", num_rejected.load(), filename);
+    }
+
+    double parse_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    add_parsed(chunks, filename, parse_ms);
+    return true;
+}
+
+// OMM CSV columns we use
+enum omm_column : int {
+    OMM_OBJECT_NAME = 0,
+    OMM_EPOCH,
+    OMM_MEAN_MOTION,
+    OMM_ECCENTRICITY,
+    OMM_INCLINATION,
+    OMM_RA_OF_ASC_NODE,
+    OMM_ARG_OF_PERICENTER,
+    OMM_MEAN_ANOMALY,
+    OMM_NORAD_CAT_ID,
+    OMM_BSTAR,
+    OMM_MEAN_MOTION_DOT,
+    OMM_MEAN_MOTION_DDOT,
+    OMM_NUM_COLUMNS
+};
+
+static const char* omm_column_names[OMM_NUM_COLUMNS] = {
+    "OBJECT_NAME", "EPOCH", "MEAN_MOTION", "ECCENTRICITY", "INCLINATION", "RA_OF_ASC_NODE",
+    "ARG_OF_PERICENTER", "MEAN_ANOMALY", "NORAD_CAT_ID", "BSTAR", "MEAN_MOTION_DOT", "MEAN_MOTION_DDOT",
+};
+
+static const uint32 max_csv_fields = 64;
+
+// splits a row in place into up to max_csv_fields fields, quotes stripped
+static uint32 split_csv(const char* line, size_t length, const char** fields, const char** field_ends) {
+    const char* p = line;
+    const char* end = line + length;
+    uint32 count = 0;
+    while (count < max_csv_fields) {
+        if (p < end && *p == '"') {
+            const char* close = (const char*)memchr(p + 1, '"', end - (p + 1));
+            if (!close) close = end;
+            fields[count] = p + 1;
+            field_ends[count] = close;
+            count++;
+            p = close < end ? close + 1 : end;
+            if (p < end && *p == ',') p++;
+            else break;
+        } else {
+            const char* comma = (const char*)memchr(p, ',', end - p);
+            fields[count] = p;
+            field_ends[count] = comma ? comma : end;
+            count++;
+            if (!comma) break;
+            p = comma + 1;
+        }
+    }
+    return count;
+}
+
+// 2024-01-31T12:34:56.789
+static bool parse_iso_epoch(const char* s, const char* end, epoch* out) {
+    if (end - s < 19 || s[4] != '-' || s[7] != '-' || (s[10] != 'T' && s[10] != ' ') || s[13] != ':' || s[16] != ':')
+        return false;
+    int32 year, month, day, hour, minute;
+    double second;
+    if (!parse_int(s, s + 4, &year) || !parse_int(s + 5, s + 7, &month) || !parse_int(s + 8, s + 10, &day) ||
+        !parse_int(s + 11, s + 13, &hour) || !parse_int(s + 14, s + 16, &minute))
+        return false;
+    const char* sec_end = end;
+    if (sec_end > s + 17 && sec_end[-1] == 'Z')
+        sec_end--;
+    if (!parse_number(s + 17, sec_end, &second))
+        return false;
+    *out = epoch::from_calendar(year, month, day, hour, minute, second, TIME_SCALE_UTC);
+    return true;
+}
+
+static bool parse_omm_row(const char* line, size_t length, const int32* columns, sgp4_elements* out) {
+    const char* fields[max_csv_fields];
+    const char* field_ends[max_csv_fields];
+    uint32 count = split_csv(line, length, fields, field_ends);
+
+    auto field = [&](omm_column c, const char** s, const char** e) -> bool {
+        int32 index = columns[c];
+        if (index < 0 || (uint32)index >= count)
+            return false;
+        *s = fields[index];
+        *e = field_ends[index];
+        return true;
+    };
+    auto number = [&](omm_column c, double* value) -> bool {
+        const char *s, *e;
+        return field(c, &s, &e) && parse_number(s, e, value);
+    };
+
+    const char *s, *e;
+    int32 catalog_number;
+    if (!field(OMM_NORAD_CAT_ID, &s, &e) || !parse_int(s, e, &catalog_number))
+        return false;
+    out->catalog_number = (uint32)catalog_number;
+
+    if (!field(OMM_EPOCH, &s, &e) || !parse_iso_epoch(s, e, &out->element_epoch))
+        return false;
+
+    double mean_motion, ndot = 0.0, nddot = 0.0;
+    if (!number(OMM_MEAN_MOTION, &mean_motion) ||
+        !number(OMM_ECCENTRICITY, &out->eccentricity) ||
+        !number(OMM_INCLINATION, &out->inclination) ||
+        !number(OMM_RA_OF_ASC_NODE, &out->raan) ||
+        !number(OMM_ARG_OF_PERICENTER, &out->arg_perigee) ||
+        !number(OMM_MEAN_ANOMALY, &out->mean_anomaly) ||
+        !number(OMM_BSTAR, &out->bstar))
+        return false;
+    number(OMM_MEAN_MOTION_DOT, &ndot);
+    number(OMM_MEAN_MOTION_DDOT, &nddot);
+
+    convert_units(out, mean_motion, ndot, nddot);
+
+    if (field(OMM_OBJECT_NAME, &s, &e))
+        set_name(out, s, e - s);
+    else
+        out->name[0] = 0;
+    return true;
+}
+
+bool tle_catalog::load_omm_csv(const char* filename) {
+    auto start = std::chrono::steady_clock::now();
+
+    mapped_file file;
+    if (!file.open(filename)) {
+        spdlog::warn("Could not open OMM file '{0}'", filename);
+        return false;
+    }
+    const char* data = (const char*)file.get_data();
+    size_t size = (size_t)file.get_size();
+
+    // header
+    size_t header_length;
+    const char* body = next_line(data, data + size, &header_length);
+    const char* fields[max_csv_fields];
+    const char* field_ends[max_csv_fields];
+    uint32 num_fields = split_csv(data, header_length, fields, field_ends);
+
+    int32 columns[OMM_NUM_COLUMNS];
+    for (int c = 0; c < OMM_NUM_COLUMNS; c++) {
+        columns[c] = -1;
+        size_t name_length = strlen(omm_column_names[c]);
+        for (uint32 f = 0; f < num_fields; f++) {
+            if ((size_t)(field_ends[f] - fields[f]) == name_length && memcmp(fields[f], omm_column_names[c], name_length) == 0) {
+                columns[c] = (int32)f;
+                break;
+            }
+        }
+        if (columns[c] < 0 && c != OMM_OBJECT_NAME && c != OMM_MEAN_MOTION_DOT && c != OMM_MEAN_MOTION_DDOT) {
+            spdlog::error("OMM file '{0}' has no {1} column", filename, omm_column_names[c]);
+            return false;
+        }
+    }
+
+    size_t body_offset = body - data;
+    size_t body_size = size - body_offset;
+    size_t num_chunks = (body_size + parse_chunk_bytes - 1) / parse_chunk_bytes;
+    std::vector<std::vector<sgp4_elements>> chunks(num_chunks);
+    std::atomic<uint32> num_rejected{0};
+
+    parallel_for(num_chunks, 1, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t c = chunk_begin; c < chunk_end; c++) {
+            const char* p = body + chunk_start(body, body_size, c*parse_chunk_bytes);
+            const char* end = body + chunk_start(body, body_size, (c + 1)*parse_chunk_bytes);
+            std::vector<sgp4_elements>& out = chunks[c];
+            out.reserve((end - p) / 160 + 1);
+
+            uint32 rejected = 0;
+            while (p < end) {
+                size_t length;
+                const char* line = p;
+                p = next_line(p, end, &length);
+                if (length == 0)
+                    continue;
+
+                sgp4_elements elements;
+                if (parse_omm_row(line, length, columns, &elements))
+                    out.push_back(elements);
+                else
+                    rejected++;
+            }
+            num_rejected += rejected;
+        }
+    });
+
+    if (num_rejected > 0) {
+        spdlog::warn("Skipped {0} malformed rows in '{1}'", num_rejected.load(), filename);
+    }
+
+    double parse_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    add_parsed(chunks, filename, parse_ms);
+    return true;
+}
+
+void tle_catalog::add_parsed(std::vector<std::vector<sgp4_elements>>& chunks, const char* filename, double parse_ms) {
+    auto start = std::chrono::steady_clock::now();
+
+    size_t first = elements.size();
+    size_t total = first;
+    for (const auto& chunk : chunks)
+        total += chunk.size();
+
+    elements.reserve(total);
+    for (const auto& chunk : chunks)
+        elements.insert(elements.end(), chunk.begin(), chunk.end());
+
+    records.resize(total);
+    status.resize(total, SGP4_OK);
+    for (int c = 0; c < 3; c++) {
+        position[c].resize(total, 0.0);
+        velocity[c].resize(total, 0.0);
+    }
+
+    parallel_for(total - first, sgp4_chunk_size, [&](size_t begin, size_t end) {
+        for (size_t n = first + begin; n < first + end; n++) {
+            status[n] = records[n].init(elements[n]);
+        }
+    });
+
+    // drop anything SGP4 can't handle at its own epoch
+    size_t kept = first;
+    for (size_t n = first; n < total; n++) {
+        if (status[n] != SGP4_OK)
+            continue;
+        if (kept != n) {
+            elements[kept] = elements[n];
+            records[kept] = records[n];
+        }
+        kept++;
+    }
+    if (kept != total) {
+        spdlog::warn("{0} element sets in '{1}' failed SGP4 initialization", total - kept, filename);
+        elements.resize(kept);
+        records.resize(kept);
+        status.resize(kept);
+        for (int c = 0; c < 3; c++) {
+            position[c].resize(kept);
+            velocity[c].resize(kept);
+        }
+    }
+
+    double init_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("Loaded {0} element sets from '{1}' (parse {2:.1f} ms, init {3:.1f} ms)",
+                 kept - first, filename, parse_ms, init_ms);
+}
+
+void tle_catalog::clear() {
+    elements.clear();
+    records.clear();
+    status.clear();
+    for (int c = 0; c < 3; c++) {
+        position[c].clear();
+        velocity[c].clear();
+    }
+}
+
+int32 tle_catalog::find(uint32 catalog_number) const {
+    for (size_t n = 0; n < elements.size(); n++) {
+        if (elements[n].catalog_number == catalog_number)
+            return (int32)n;
+    }
+    return -1;
+}
+
+void tle_catalog::propagate_to(const epoch& when) {
+    parallel_for(size(), sgp4_chunk_size, [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            double tsince = (when - elements[n].element_epoch) / 60.0;
+            double r[3], v[3];
+            status[n] = records[n].propagate(tsince, r, v);
+            bool ok = (status[n] == SGP4_OK);
+            for (int c = 0; c < 3; c++) {
+                position[c][n] = ok ? r[c]*1000.0 : 0.0;
+                velocity[c][n] = ok ? v[c]*1000.0 : 0.0;
+            }
+        }
+    });
+}
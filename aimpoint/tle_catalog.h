@@ -0,0 +1,43 @@
+#pragma once
+#include "defines.h"
+
+#include "sgp4.h"
+
+#include <vector>
+
+// Parse one element set. Lines need at least 69 characters and valid
+// checksums; name may be null.
+bool parse_tle(const char* line1, const char* line2, const char* name, size_t name_length, sgp4_elements* out);
+
+// A catalog of SGP4 element sets, propagated together.
+//
+// Files are memory mapped and split into chunks that are parsed in parallel
+// straight out of the mapping, with no per-line allocation. Element sets
+// that fail to parse or initialize are logged and dropped.
+struct tle_catalog {
+    // two or three line element files (names optional, "0 " prefix allowed)
+    bool load_tle(const char* filename);
+    // CelesTrak style OMM CSV, columns found by name from the header
+    bool load_omm_csv(const char* filename);
+
+    void clear();
+    size_t size() const { return elements.size(); }
+
+    // index of a catalog number, or -1
+    int32 find(uint32 catalog_number) const;
+
+    // TEME position [m] and velocity [m/s] of every object. Objects that fail
+    // to propagate (decayed, etc.) get zeros and a nonzero status.
+    void propagate_to(const epoch& when);
+
+    std::vector<sgp4_elements> elements;
+    std::vector<sgp4_record> records;
+    std::vector<int32> status; // sgp4_error from the last propagation
+
+    std::vector<double> position[3];
+    std::vector<double> velocity[3];
+
+private:
+    // appends parsed chunks in file order and initializes their records
+    void add_parsed(std::vector<std::vector<sgp4_elements>>& chunks, const char* filename, double parse_ms);
+};
@@ -32,7 +32,7 @@ int spinning_rigid_body_demo::init() {
                    laml::Quat_highp(),
                    vec3d(0.1, 10.0, 0.1));
 
-    if (!mesh.load_from_mesh_file("data/t_bar.mesh", 0.5f)) 
+    if (!mesh.load_from_baked_file("data/t_bar.bmesh", 0.5f)) 
         return 4;
 
     tex.load_texture_file("data/blue.png");
@@ -0,0 +1,29 @@
+#include "render/baked_mesh.h"
+#include "log.h"
+
+#include <string.h>
+
+// Converts .mesh files to baked .bmesh files for triangle_mesh::load_from_baked_file.
+//
+//   bake_mesh [--full] input.mesh output.bmesh
+//
+// --full keeps float normals/texcoords and 32-bit indices.
+int main(int argc, char** argv) {
+    set_terminal_log_level(log_level::info);
+
+    baked_mesh_options options;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--full") == 0) {
+        options.pack_normals = false;
+        options.quantize_texcoords = false;
+        options.short_indices = false;
+        arg++;
+    }
+
+    if (argc - arg != 2) {
+        spdlog::error("usage: bake_mesh [--full] input.mesh output.bmesh");
+        return 1;
+    }
+
+    return bake_mesh_file(argv[arg], argv[arg + 1], options) ? 0 : 2;
+}